@@ -1,7 +1,7 @@
 #pragma once
 
 #include <karm-base/checked.h>
-#include <karm-base/map.h>
+#include <karm-base/hashmap.h>
 #include <karm-base/string.h>
 #include <karm-base/var.h>
 #include <karm-base/vec.h>
@@ -23,6 +23,10 @@ struct Pos {
     Ordr cmp(Pos const &o) const {
         return Karm::cmp(row, o.row) | Karm::cmp(col, o.col);
     }
+
+    u64 hash() const {
+        return hashCombine(Karm::hash(row), Karm::hash(col));
+    }
 };
 
 enum struct Wheight {
@@ -88,7 +92,7 @@ struct Sheet {
     usize freezedCols = 0;
     Vec<Row> rows = {{}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}};
     Vec<Col> cols = {{}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}, {}};
-    Map<Pos, Cell> cells = {};
+    HashMap<Pos, Cell> cells = {};
 
     void recompute() {
         i32 y = 0;
@@ -1,3 +1,4 @@
+#include <karm-logger/logger.h>
 #include <karm-main/main.h>
 #include <karm-ui/app.h>
 #include <karm-ui/dialog.h>
@@ -47,5 +48,17 @@ Res<> entryPoint(Ctx &ctx) {
                       Ui::grow(
                           Ui::vscroll(content)))));
 
-    return Ui::runApp(ctx, layout);
+    auto res = Ui::runApp(ctx, layout);
+
+#ifdef __ck_karm_base_string_stats__
+    auto &stats = stringStats();
+    logInfo(
+        "strings: {} heap allocations, {} inline, {} atoms ({} hits)",
+        stats.heapAllocs.load(),
+        stats.inlineAllocs.load(),
+        stats.atoms.load(),
+        stats.atomHits.load());
+#endif
+
+    return res;
 }
@@ -6,6 +6,8 @@
 #include <karm-sys/dir.h>
 #include <karm-sys/fd.h>
 #include <karm-sys/info.h>
+#include <karm-sys/mutex.h>
+#include <karm-sys/thread.h>
 #include <karm-sys/types.h>
 
 #include "defs.h"
@@ -56,6 +58,12 @@ Res<> populate(Sys::UserInfo &);
 
 Res<> populate(Vec<Sys::UserInfo> &);
 
+/* --- Threads -------------------------------------------------------------- */
+
+Res<Strong<Sys::Thread>> spawnThread(Func<void()> entry);
+
+Res<Strong<Sys::Sema>> createSema(usize count);
+
 /* --- Process Managment ---------------------------------------------------- */
 
 Res<> sleep(TimeSpan);
@@ -1,30 +1,31 @@
 #include <efi/base.h>
 #include <efi/spec.h>
+#include <karm-base/heap-prof.h>
 
 void *__attribute__((weak)) operator new(usize size) {
     void *res = nullptr;
-    Efi::bs()->allocatePool(Efi::MemoryType::BOOT_SERVICES_DATA, size, &res).unwrap("operator new failled");
-    return res;
+    Efi::bs()->allocatePool(Efi::MemoryType::BOOT_SERVICES_DATA, size + HEAP_PROF_HEADER, &res).unwrap("operator new failled");
+    return heapProfAlloc(res, size, __builtin_return_address(0));
 }
 
 void *__attribute__((weak)) operator new[](usize size) {
     void *res = nullptr;
-    Efi::bs()->allocatePool(Efi::MemoryType::BOOT_SERVICES_DATA, size, &res).unwrap("operator new[] failled");
-    return res;
+    Efi::bs()->allocatePool(Efi::MemoryType::BOOT_SERVICES_DATA, size + HEAP_PROF_HEADER, &res).unwrap("operator new[] failled");
+    return heapProfAlloc(res, size, __builtin_return_address(0));
 }
 
 void __attribute__((weak)) operator delete(void *ptr) {
-    Efi::bs()->freePool(ptr).unwrap("operator delete failled");
+    Efi::bs()->freePool(heapProfFree(ptr)).unwrap("operator delete failled");
 }
 
 void __attribute__((weak)) operator delete[](void *ptr) {
-    Efi::bs()->freePool(ptr).unwrap("operator delete[] failled");
+    Efi::bs()->freePool(heapProfFree(ptr)).unwrap("operator delete[] failled");
 }
 
 void __attribute__((weak)) operator delete(void *ptr, usize) {
-    Efi::bs()->freePool(ptr).unwrap("operator delete failled");
+    Efi::bs()->freePool(heapProfFree(ptr)).unwrap("operator delete failled");
 }
 
 void __attribute__((weak)) operator delete[](void *ptr, usize) {
-    Efi::bs()->freePool(ptr).unwrap("operator delete[] failled");
+    Efi::bs()->freePool(heapProfFree(ptr)).unwrap("operator delete[] failled");
 }
@@ -305,6 +305,14 @@ TimeStamp now() {
            TimeSpan::fromUSecs(t.nanosecond / 1000);
 }
 
+Res<Strong<Sys::Thread>> spawnThread(Func<void()>) {
+    return Error::notImplemented();
+}
+
+Res<Strong<Sys::Sema>> createSema(usize) {
+    return Error::notImplemented();
+}
+
 Res<> sleep(TimeSpan) {
     return Error::notImplemented();
 }
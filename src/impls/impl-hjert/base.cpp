@@ -35,7 +35,7 @@ usize getRbp() {
     Hjert::Arch::stopAll();
 }
 
-void relaxe() { Hjert::Arch::cpu().relaxe(); }
+void relaxe() { Hjert::Arch::cpu().pause(); }
 
 void enterCritical() { Hjert::Arch::cpu().retainInterrupts(); }
 
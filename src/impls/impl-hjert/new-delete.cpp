@@ -1,4 +1,5 @@
 #include <hjert-core/mem.h>
+#include <karm-base/heap-prof.h>
 #include <karm-base/lock.h>
 #include <karm-logger/logger.h>
 #include <libheap/libheap.h>
@@ -29,30 +30,32 @@ static Heap _heapImpl = {
 
 void *operator new(usize size) {
     LockScope scope(_heapLock);
-    return heap_calloc(&_heapImpl, size, 1);
+    void *raw = heap_calloc(&_heapImpl, size + HEAP_PROF_HEADER, 1);
+    return heapProfAlloc(raw, size, __builtin_return_address(0));
 }
 
 void *operator new[](usize size) {
     LockScope scope(_heapLock);
-    return heap_calloc(&_heapImpl, size, 1);
+    void *raw = heap_calloc(&_heapImpl, size + HEAP_PROF_HEADER, 1);
+    return heapProfAlloc(raw, size, __builtin_return_address(0));
 }
 
 void operator delete(void *ptr) {
     LockScope scope(_heapLock);
-    heap_free(&_heapImpl, ptr);
+    heap_free(&_heapImpl, heapProfFree(ptr));
 }
 
 void operator delete[](void *ptr) {
     LockScope scope(_heapLock);
-    heap_free(&_heapImpl, ptr);
+    heap_free(&_heapImpl, heapProfFree(ptr));
 }
 
 void operator delete(void *ptr, usize) {
     LockScope scope(_heapLock);
-    heap_free(&_heapImpl, ptr);
+    heap_free(&_heapImpl, heapProfFree(ptr));
 }
 
 void operator delete[](void *ptr, usize) {
     LockScope scope(_heapLock);
-    heap_free(&_heapImpl, ptr);
+    heap_free(&_heapImpl, heapProfFree(ptr));
 }
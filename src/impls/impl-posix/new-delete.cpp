@@ -0,0 +1,65 @@
+// The libc heap is used as is, operator new and delete are only replaced
+// when the target profiles the heap.
+#ifdef __ck_karm_base_heap_prof__
+
+#    include <karm-base/heap-prof.h>
+#    include <stdio.h>
+#    include <stdlib.h>
+
+/* --- Heap Profile Dump ---------------------------------------------------- */
+
+// Writes the profile to the file named by $KARM_HEAP_PROF when the process
+// exits.
+static void _dumpHeapProf() {
+    char const *path = getenv("KARM_HEAP_PROF");
+    if (not path)
+        return;
+
+    FILE *file = fopen(path, "wb");
+    if (not file)
+        return;
+
+    heapProf().dump([&](Bytes bytes) {
+        fwrite(bytes.buf(), 1, bytes.len(), file);
+    });
+
+    fclose(file);
+}
+
+[[gnu::constructor]] static void _registerHeapProf() {
+    atexit(_dumpHeapProf);
+}
+
+/* --- New/Delete Implementation -------------------------------------------- */
+
+void *operator new(usize size) {
+    void *raw = malloc(size + HEAP_PROF_HEADER);
+    if (not raw)
+        abort();
+    return heapProfAlloc(raw, size, __builtin_return_address(0));
+}
+
+void *operator new[](usize size) {
+    void *raw = malloc(size + HEAP_PROF_HEADER);
+    if (not raw)
+        abort();
+    return heapProfAlloc(raw, size, __builtin_return_address(0));
+}
+
+void operator delete(void *ptr) noexcept {
+    free(heapProfFree(ptr));
+}
+
+void operator delete[](void *ptr) noexcept {
+    free(heapProfFree(ptr));
+}
+
+void operator delete(void *ptr, usize) noexcept {
+    free(heapProfFree(ptr));
+}
+
+void operator delete[](void *ptr, usize) noexcept {
+    free(heapProfFree(ptr));
+}
+
+#endif
@@ -6,6 +6,7 @@
 #include <dirent.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <pthread.h>
 #include <stdlib.h>
 #include <sys/mman.h>
 #include <sys/utsname.h>
@@ -297,6 +298,97 @@ Res<> populate(Vec<Sys::UserInfo> &infos) {
     return Ok();
 }
 
+/* --- Threads -------------------------------------------------------------- */
+
+struct PosixThread : public Sys::Thread {
+    pthread_t _raw;
+    bool _joined = false;
+
+    PosixThread(pthread_t raw) : _raw(raw) {}
+
+    ~PosixThread() {
+        if (not _joined)
+            pthread_detach(_raw);
+    }
+
+    Res<> join() override {
+        if (_joined)
+            return Ok();
+
+        int err = pthread_join(_raw, nullptr);
+        if (err != 0)
+            return Posix::fromErrno(err);
+
+        _joined = true;
+        return Ok();
+    }
+};
+
+static void *_threadEntry(void *arg) {
+    auto *entry = static_cast<Func<void()> *>(arg);
+    (*entry)();
+    delete entry;
+    return nullptr;
+}
+
+Res<Strong<Sys::Thread>> spawnThread(Func<void()> entry) {
+    auto *boxed = new Func<void()>(std::move(entry));
+
+    pthread_t raw;
+    int err = pthread_create(&raw, nullptr, _threadEntry, boxed);
+    if (err != 0) {
+        delete boxed;
+        return Posix::fromErrno(err);
+    }
+
+    return Ok(makeStrong<PosixThread>(raw));
+}
+
+struct PosixSema : public Sys::Sema {
+    pthread_mutex_t _mutex = PTHREAD_MUTEX_INITIALIZER;
+    pthread_cond_t _cond = PTHREAD_COND_INITIALIZER;
+    usize _count;
+
+    PosixSema(usize count) : _count(count) {}
+
+    ~PosixSema() {
+        pthread_cond_destroy(&_cond);
+        pthread_mutex_destroy(&_mutex);
+    }
+
+    void wait() override {
+        pthread_mutex_lock(&_mutex);
+        while (_count == 0)
+            pthread_cond_wait(&_cond, &_mutex);
+        _count--;
+        pthread_mutex_unlock(&_mutex);
+    }
+
+    bool tryWait() override {
+        pthread_mutex_lock(&_mutex);
+        bool taken = _count > 0;
+        if (taken)
+            _count--;
+        pthread_mutex_unlock(&_mutex);
+        return taken;
+    }
+
+    void signal(usize n) override {
+        pthread_mutex_lock(&_mutex);
+        _count += n;
+        pthread_mutex_unlock(&_mutex);
+
+        if (n == 1)
+            pthread_cond_signal(&_cond);
+        else
+            pthread_cond_broadcast(&_cond);
+    }
+};
+
+Res<Strong<Sys::Sema>> createSema(usize count) {
+    return Ok(makeStrong<PosixSema>(count));
+}
+
 /* --- Process Managment ---------------------------------------------------- */
 
 Res<> sleep(TimeSpan span) {
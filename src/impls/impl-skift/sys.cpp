@@ -40,4 +40,14 @@ Res<> memUnmap(void const *, usize) {
     panic("not implemented");
 }
 
+/* --- Threads -------------------------------------------------------------- */
+
+Res<Strong<Sys::Thread>> spawnThread(Func<void()>) {
+    return Error::notImplemented();
+}
+
+Res<Strong<Sys::Sema>> createSema(usize) {
+    return Error::notImplemented();
+}
+
 } // namespace Embed
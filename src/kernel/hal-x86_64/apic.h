@@ -0,0 +1,132 @@
+#pragma once
+
+#include <karm-base/std.h>
+
+#include "asm.h"
+
+namespace x86_64 {
+
+struct Lapic {
+    usize _base = 0; // Virtual address of the register page
+
+    enum Reg : usize {
+        ID = 0x20,
+        EOI = 0xB0,
+        SPURIOUS = 0xF0,
+        ICR_LOW = 0x300,
+        ICR_HIGH = 0x310,
+        TIMER = 0x320,
+        TIMER_INIT = 0x380,
+        TIMER_CURR = 0x390,
+        TIMER_DIV = 0x3E0,
+    };
+
+    static constexpr u32 SOFTWARE_ENABLE = 1 << 8;
+
+    static constexpr u32 ICR_FIXED = 0b000 << 8;
+    static constexpr u32 ICR_INIT = 0b101 << 8;
+    static constexpr u32 ICR_STARTUP = 0b110 << 8;
+    static constexpr u32 ICR_ASSERT = 1 << 14;
+    static constexpr u32 ICR_PENDING = 1 << 12;
+
+    static constexpr u32 TIMER_MASKED = 1 << 16;
+    static constexpr u32 TIMER_PERIODIC = 1 << 17;
+    static constexpr u32 TIMER_TSC_DEADLINE = 1 << 18;
+    static constexpr u32 TIMER_DIV16 = 0b0011;
+
+    static Lapic at(usize base) {
+        return {base};
+    }
+
+    bool present() const {
+        return _base != 0;
+    }
+
+    u32 read(Reg reg) const {
+        return *reinterpret_cast<u32 volatile *>(_base + reg);
+    }
+
+    void write(Reg reg, u32 value) {
+        *reinterpret_cast<u32 volatile *>(_base + reg) = value;
+    }
+
+    u8 id() const {
+        return read(ID) >> 24;
+    }
+
+    void enable(u8 spurious) {
+        write(SPURIOUS, SOFTWARE_ENABLE | spurious);
+    }
+
+    void eoi() {
+        write(EOI, 0);
+    }
+
+    /* --- Inter Processor Interrupts --------------------------------------- */
+
+    void _icr(u8 dest, u32 cmd) {
+        write(ICR_HIGH, (u32)dest << 24);
+        write(ICR_LOW, cmd);
+        while (read(ICR_LOW) & ICR_PENDING)
+            pause();
+    }
+
+    void sendInit(u8 dest) {
+        _icr(dest, ICR_INIT | ICR_ASSERT);
+    }
+
+    // Starts the processor in real mode at `page`, which must be page
+    // aligned and below 1MiB.
+    void sendStartup(u8 dest, usize page) {
+        _icr(dest, ICR_STARTUP | ICR_ASSERT | (page >> 12));
+    }
+
+    void sendIpi(u8 dest, u8 vector) {
+        _icr(dest, ICR_FIXED | ICR_ASSERT | vector);
+    }
+
+    /* --- Timer ------------------------------------------------------------ */
+
+    // Counts down from the largest value without raising interrupts, used
+    // to measure the timer frequency.
+    void timerStart() {
+        write(TIMER_DIV, TIMER_DIV16);
+        write(TIMER, TIMER_MASKED);
+        write(TIMER_INIT, ~0u);
+    }
+
+    u32 timerElapsed() const {
+        return ~0u - read(TIMER_CURR);
+    }
+
+    // Raises `vector` once, `timerArm()` ticks after it's called.
+    void timerOneShot(u8 vector) {
+        write(TIMER_DIV, TIMER_DIV16);
+        write(TIMER, vector);
+    }
+
+    // Zero disarms the timer.
+    void timerArm(u32 ticks) {
+        write(TIMER_INIT, ticks);
+    }
+
+    // Raises `vector` once the tsc reaches the value given to
+    // `timerArmDeadline()`.
+    void timerDeadline(u8 vector) {
+        write(TIMER, TIMER_TSC_DEADLINE | vector);
+        // The mode switch has to land before the msr is written.
+        asm volatile("mfence" ::: "memory");
+    }
+
+    // Zero disarms the timer.
+    void timerArmDeadline(u64 tsc) {
+        wrmsr(Msrs::TSC_DEADLINE, tsc);
+    }
+
+    void timerStop() {
+        write(TIMER, TIMER_MASKED);
+        write(TIMER_INIT, 0);
+    }
+};
+
+} // namespace x86_64
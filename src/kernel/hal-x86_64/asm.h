@@ -12,11 +12,35 @@ inline void hlt(void) { asm volatile("hlt"); }
 
 inline void pause(void) { asm volatile("pause"); }
 
+inline u64 rdtsc(void) {
+    u32 low, high;
+    asm volatile("rdtsc"
+                 : "=a"(low), "=d"(high));
+    return ((u64)high << 32) | low;
+}
+
 inline void invlpg(usize addr) {
     asm volatile("invlpg (%0)" ::"r"(addr)
                  : "memory");
 }
 
+enum struct Invpcid : u64 {
+    ADDRESS = 0, // One address of one pcid
+    CONTEXT = 1, // Every non-global entry of one pcid
+    ALL = 2,     // Every entry, global ones included
+    ALL_LOCAL = 3,
+};
+
+inline void invpcid(Invpcid type, u16 pcid, usize addr = 0) {
+    struct {
+        u64 pcid;
+        u64 addr;
+    } desc = {pcid, addr};
+
+    asm volatile("invpcid %0, %1" ::"m"(desc), "r"((u64)type)
+                 : "memory");
+}
+
 /* --- CRs ------------------------------------------------------------------ */
 
 enum cr0_bit {
@@ -113,12 +137,22 @@ inline void wrxcr(u32 i, u64 value) {
                  : "memory");
 }
 
-inline void xsave(void *region) {
-    asm volatile("xsave (%0)" ::"a"(region));
+// The xsave family only touches the components set in both `mask` and
+// xcr0, the region must be 64 bytes aligned.
+inline void xsave(void *region, u64 mask = ~0uLL) {
+    asm volatile("xsave (%0)" ::"r"(region), "a"((u32)mask), "d"((u32)(mask >> 32))
+                 : "memory");
 }
 
-inline void xrstor(void const *region) {
-    asm volatile("xrstor (%0)" ::"a"(region));
+// Skips the components left untouched since the last xrstor from `region`.
+inline void xsaveopt(void *region, u64 mask = ~0uLL) {
+    asm volatile("xsaveopt (%0)" ::"r"(region), "a"((u32)mask), "d"((u32)(mask >> 32))
+                 : "memory");
+}
+
+inline void xrstor(void const *region, u64 mask = ~0uLL) {
+    asm volatile("xrstor (%0)" ::"r"(region), "a"((u32)mask), "d"((u32)(mask >> 32))
+                 : "memory");
 }
 
 inline void fninit(void) {
@@ -126,17 +160,24 @@ inline void fninit(void) {
 }
 
 inline void fxsave(void *region) {
-    asm volatile("fxsave (%0)" ::"a"(region));
+    asm volatile("fxsave (%0)" ::"r"(region)
+                 : "memory");
 }
 
 inline void fxrstor(void const *region) {
-    asm volatile("fxrstor (%0)" ::"a"(region));
+    asm volatile("fxrstor (%0)" ::"r"(region)
+                 : "memory");
+}
+
+inline void clts(void) {
+    asm volatile("clts");
 }
 
 /* --- Msrs ----------------------------------------------------------------- */
 
 enum struct Msrs : u64 {
     APIC = 0x1B,
+    TSC_DEADLINE = 0x6E0,
     EFER = 0xC0000080,
     STAR = 0xC0000081,
     LSTAR = 0xC0000082,
@@ -94,8 +94,43 @@ union Cpuid {
         return cpuid(0x7, 0).ebx & (1 << 16);
     }
 
-    static bool xsaveSize() {
-        return cpuid(0x0d, 0).ecx;
+    static bool hasTscDeadline() {
+        return cpuid(0x01, 0x00).ecx & (1 << 24);
+    }
+
+    // The tsc runs at the same rate in every power state.
+    static bool hasInvariantTsc() {
+        if (cpuid(0x80000000).eax < 0x80000007)
+            return false;
+        return cpuid(0x80000007).edx & (1 << 8);
+    }
+
+    static bool hasGlobalPages() {
+        return cpuid(0x01, 0x00).edx & (1 << 13);
+    }
+
+    static bool hasPcid() {
+        return cpuid(0x01, 0x00).ecx & (1 << 17);
+    }
+
+    static bool hasInvpcid() {
+        return cpuid(0x7, 0).ebx & (1 << 10);
+    }
+
+    // Page directory pointer entries can map 1GiB pages.
+    static bool hasGibPages() {
+        if (cpuid(0x80000000).eax < 0x80000001)
+            return false;
+        return cpuid(0x80000001).edx & (1 << 26);
+    }
+
+    static bool hasXsaveopt() {
+        return cpuid(0x0d, 1).eax & (1 << 0);
+    }
+
+    // Size of the xsave area for the components enabled in xcr0.
+    static usize xsaveSize() {
+        return cpuid(0x0d, 0).ebx;
     }
 };
 }; // namespace x86_64
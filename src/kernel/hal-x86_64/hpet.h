@@ -0,0 +1,72 @@
+#pragma once
+
+#include <hal/clock.h>
+#include <hal/io.h>
+
+#include "asm.h"
+
+namespace x86_64 {
+
+struct Hpet : public Hal::Clock {
+    Hal::Io _io;
+    u64 _period = 0;    // Femtoseconds per tick
+    u64 _base = 0;      // Ticks at the epoch
+    u64 _usPerTick = 0; // 32.32 fixed point
+
+    // Registers
+    static constexpr auto CAPS = 0x00;
+    static constexpr auto CONFIG = 0x10;
+    static constexpr auto COUNTER = 0xF0;
+
+    static constexpr u64 CAPS_64BIT = 1 << 13;
+    static constexpr u64 CONFIG_ENABLE = 1 << 0;
+
+    static constexpr u64 FS_PER_US = 1000000000;
+
+    Hpet(Hal::Io io) : _io(io) {}
+
+    static Hpet at(usize base) {
+        return {Hal::Io::dma({base, 0x400})};
+    }
+
+    u64 caps() {
+        return _io.read64(CAPS);
+    }
+
+    // Whether the counter is wide enough to never wrap, a 32-bit one does
+    // in a few minutes.
+    bool is64Bit() {
+        return caps() & CAPS_64BIT;
+    }
+
+    void enable() {
+        _period = caps() >> 32;
+        _usPerTick = (_period << 32) / FS_PER_US;
+        _io.write64(CONFIG, _io.read64(CONFIG) | CONFIG_ENABLE);
+        _base = counter();
+    }
+
+    u64 counter() {
+        return _io.read64(COUNTER);
+    }
+
+    // Ticks per second.
+    u64 freq() const {
+        return (FS_PER_US * 1000000) / _period;
+    }
+
+    TimeStamp now() override {
+        u64 ticks = counter() - _base;
+        return (u64)(((u128)ticks * _usPerTick) >> 32);
+    }
+
+    // Spins for `us` microseconds.
+    void wait(u64 us) {
+        u64 start = counter();
+        u64 ticks = (us * FS_PER_US) / _period;
+        while (counter() - start < ticks)
+            pause();
+    }
+};
+
+} // namespace x86_64
@@ -41,6 +41,9 @@ struct [[gnu::packed]] Entry {
     void flags(u64 flags) { _raw = (flags & FLAGS_MASK) | paddr(); }
 
     bool present() const { return _raw & PRESENT; }
+
+    // Maps a large page instead of pointing to a lower table.
+    bool huge() const { return _raw & HUGE_PAGE; }
 };
 
 static_assert(sizeof(Entry) == 8);
@@ -49,6 +52,7 @@ template <usize L>
 struct [[gnu::packed]] Pml {
     constexpr static usize LEVEL = L;
     constexpr static usize LEN = 512;
+    constexpr static usize SPAN = 1uz << (12 + (L - 1) * 9); // Bytes mapped by an entry
 
     using Lower = Pml<L - 1>;
 
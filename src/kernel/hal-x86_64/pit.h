@@ -20,6 +20,7 @@ struct Pit {
     static constexpr auto CHANNEL1 = 1 << 5;
     static constexpr auto LOWBYTE = 1 << 4;
     static constexpr auto SQUARE_WAVE = 6;
+    static constexpr auto ONE_SHOT = 0;
 
     static Pit pit() {
         return {Hal::Io::port({0x40, 4})};
@@ -33,6 +34,31 @@ struct Pit {
         _io.write8(PORT0, (div >> 8) & 0xFF);
     }
 
+    // Raises irq0 once after `ticks`, the counter then keeps going down
+    // from 0xFFFF without raising it again.
+    void oneShot(u16 ticks) {
+        _io.write8(CMD, CHANNEL1 | LOWBYTE | ONE_SHOT);
+        _io.write8(PORT0, ticks & 0xFF);
+        _io.write8(PORT0, (ticks >> 8) & 0xFF);
+    }
+
+    // The counter only starts once it's given a count.
+    void stop() {
+        _io.write8(CMD, CHANNEL1 | LOWBYTE | ONE_SHOT);
+    }
+
+    // Spins for `ticks`, without relying on interrupts.
+    void wait(u16 ticks) {
+        oneShot(ticks);
+        u32 last = ticks;
+        while (true) {
+            u32 curr = readCount();
+            if (curr == 0 or curr > last)
+                break;
+            last = curr;
+        }
+    }
+
     u32 readCount() {
         _io.write8(CMD, 0x00);
         u32 low = _io.read8(PORT0);
@@ -1,10 +1,21 @@
 #pragma once
 
+#include <karm-base/slice.h>
+
 #include "asm.h"
 #include "cpuid.h"
 
 namespace x86_64 {
 
+// How the simd state is saved, the same on every cpu.
+enum struct SimdSave {
+    FXSAVE,
+    XSAVE,
+    XSAVEOPT,
+};
+
+inline SimdSave _simdSave = SimdSave::FXSAVE;
+
 inline void simdInit() {
     wrcr0(rdcr0() & ~((u64)CR0_EMULATION));
     wrcr0(rdcr0() | CR0_MONITOR_CO_PROCESSOR);
@@ -32,13 +43,15 @@ inline void simdInit() {
         }
 
         wrxcr(0, xcr0);
+
+        _simdSave = Cpuid::hasXsaveopt() ? SimdSave::XSAVEOPT : SimdSave::XSAVE;
     }
 
     fninit();
 }
 
 inline usize simdCtxSize() {
-    if (Cpuid::hasXsave()) {
+    if (_simdSave != SimdSave::FXSAVE) {
         return Cpuid::xsaveSize();
     }
 
@@ -46,24 +59,46 @@ inline usize simdCtxSize() {
 }
 
 inline void simdSaveCtx(void *ptr) {
-    if (Cpuid::hasXsave()) {
-        xsave(ptr);
-    } else {
+    switch (_simdSave) {
+    case SimdSave::FXSAVE:
         fxsave(ptr);
+        break;
+
+    case SimdSave::XSAVE:
+        xsave(ptr);
+        break;
+
+    case SimdSave::XSAVEOPT:
+        xsaveopt(ptr);
+        break;
     }
 }
 
 inline void simdLoadCtx(void *ptr) {
-    if (Cpuid::hasXsave()) {
+    if (_simdSave != SimdSave::FXSAVE) {
         xrstor(ptr);
     } else {
         fxrstor(ptr);
     }
 }
 
-inline void simdInitCtx(void *ptr) {
-    fninit();
-    simdSaveCtx(ptr);
+// Fills `buf` with the state of a fresh task, without touching the
+// registers, which might hold the state of another one. Components left out
+// of the xsave header start in their initial state.
+inline void simdInitCtx(MutBytes buf) {
+    zeroFill(buf);
+    *reinterpret_cast<u16 *>(buf.buf()) = 0x37f;       // fcw, every x87 exception masked
+    *reinterpret_cast<u32 *>(buf.buf() + 24) = 0x1f80; // mxcsr, every sse exception masked
+}
+
+// Makes the next simd instruction raise a device-not-available exception,
+// until `simdUntrap()`.
+inline void simdTrap() {
+    wrcr0(rdcr0() | CR0_TASK_SWITCHED);
+}
+
+inline void simdUntrap() {
+    clts();
 }
 
 } // namespace x86_64
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <hal/clock.h>
+
+#include "asm.h"
+
+namespace x86_64 {
+
+// The time stamp counter, converted to microseconds with 32.32 fixed point
+// factors so reading it is a multiplication and a shift.
+struct Tsc : public Hal::Clock {
+    u64 _freq = 0; // Ticks per second
+    u64 _base = 0; // Ticks at the epoch
+    u64 _usPerTick = 0;
+    u64 _ticksPerUs = 0;
+
+    static Tsc calibrated(u64 freq) {
+        Tsc tsc;
+        tsc._freq = freq;
+        tsc._base = rdtsc();
+        tsc._usPerTick = (1000000uLL << 32) / freq;
+        tsc._ticksPerUs = ((freq / 1000000) << 32) |
+                          (((freq % 1000000) << 32) / 1000000);
+        return tsc;
+    }
+
+    u64 freq() const {
+        return _freq;
+    }
+
+    TimeStamp now() override {
+        u64 ticks = rdtsc() - _base;
+        return (u64)(((u128)ticks * _usPerTick) >> 32);
+    }
+
+    // The counter value at `stamp`.
+    u64 ticksAt(TimeStamp stamp) const {
+        if (stamp.isEndOfTime())
+            return ~0uLL;
+        return _base + (u64)(((u128)stamp.val() * _ticksPerUs) >> 32);
+    }
+};
+
+} // namespace x86_64
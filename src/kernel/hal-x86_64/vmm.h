@@ -3,13 +3,48 @@
 #include <hal/mem.h>
 #include <hal/pmm.h>
 #include <hal/vmm.h>
+#include <karm-base/align.h>
+#include <karm-base/clamp.h>
 #include <karm-logger/logger.h>
 
 #include "asm.h"
+#include "cpuid.h"
 #include "paging.h"
 
 namespace x86_64 {
 
+// Above this many pages, reloading cr3 is cheaper than invalidating them one
+// by one.
+static constexpr usize FLUSH_PAGES = 32;
+
+// The low bits of cr3 hold the pcid of the space when pcids are enabled,
+// loading it with CR3_NOFLUSH keeps the entries already tagged with it.
+static constexpr u64 CR3_PCID_MASK = 0xfff;
+static constexpr u64 CR3_NOFLUSH = 1uLL << 63;
+
+// Drops the tlb entries for `range` in the active space. Global entries
+// survive the cr3 reload, only invlpg drops them.
+inline void flushRange(Hal::VmmRange range) {
+    if (range.size > FLUSH_PAGES * Hal::PAGE_SIZE) {
+        wrcr3(rdcr3());
+        return;
+    }
+
+    for (usize i = 0; i < range.size; i += Hal::PAGE_SIZE)
+        invlpg(range.start + i);
+}
+
+// Drops every tlb entry, of every pcid, global ones included.
+inline void flushAll() {
+    u64 cr4 = rdcr4();
+    if (cr4 & CR4_PAGE_GLOBAL_ENABLE) {
+        wrcr4(cr4 & ~CR4_PAGE_GLOBAL_ENABLE);
+        wrcr4(cr4);
+    } else {
+        wrcr3(rdcr3());
+    }
+}
+
 template <typename Mapper = Hal::IdentityMapper>
 struct Vmm : public Hal::Vmm {
     Hal::Pmm &_pmm;
@@ -21,60 +56,113 @@ struct Vmm : public Hal::Vmm {
           _pml4(pml4),
           _mapper(mapper) {}
 
-    template <usize L>
-    Res<Pml<L - 1> *> pml(Pml<L> &upper, usize vaddr) {
-        auto page = upper.pageAt(vaddr);
-
-        if (not page.present()) {
-            return Error::invalidInput("page not present");
-        }
-
-        return Ok(_mapper.map(page.template as<Pml<L - 1>>()));
+    bool _gibPages = Cpuid::hasGibPages();
+
+    Entry _leaf(usize paddr, Hal::VmmFlags flags) {
+        u64 bits = Entry::PRESENT;
+        if ((flags & Hal::VmmFlags::WRITE) == Hal::VmmFlags::WRITE)
+            bits |= Entry::WRITE;
+        if ((flags & Hal::VmmFlags::USER) == Hal::VmmFlags::USER)
+            bits |= Entry::USER;
+        if ((flags & Hal::VmmFlags::GLOBAL) == Hal::VmmFlags::GLOBAL)
+            bits |= Entry::GLOBAL;
+        return {paddr, bits};
     }
 
+    // The table below `vaddr`, allocated if missing. A large page in the
+    // way is split into a table mapping the same memory.
     template <usize L>
     Res<Pml<L - 1> *> pmlOrAlloc(Pml<L> &upper, usize vaddr) {
         auto page = upper.pageAt(vaddr);
 
-        if (page.present()) {
+        if (page.present() and not page.huge()) {
             return Ok(_mapper.map(page.template as<Pml<L - 1>>()));
         }
 
         usize lower = try$(_pmm.allocRange(Hal::PAGE_SIZE, Hal::PmmFlags::NONE)).start;
-        memset(_mapper.map((void *)lower), 0, Hal::PAGE_SIZE);
+        auto *pml = _mapper.map((Pml<L - 1> *)lower);
+
+        if (page.present()) {
+            // Bit 7 selects the pat in the entries of the last level.
+            u64 flags = L - 1 == 1 ? page.flags() & ~Entry::HUGE_PAGE : page.flags();
+            for (usize i = 0; i < Pml<L - 1>::LEN; i++)
+                (*pml)[i] = {page.paddr() + i * Pml<L - 1>::SPAN, flags};
+        } else {
+            memset(pml, 0, Hal::PAGE_SIZE);
+        }
+
         upper.putPage(vaddr, {lower, Entry::WRITE | Entry::PRESENT | Entry::USER});
-        return Ok(_mapper.map((Pml<L - 1> *)lower));
+        return Ok(pml);
     }
 
-    Res<> allocPage(usize vaddr, usize paddr, Hal::VmmFlags) {
-        auto pml3 = try$(pmlOrAlloc(*_pml4, vaddr));
-        auto pml2 = try$(pmlOrAlloc(*pml3, vaddr));
-        auto pml1 = try$(pmlOrAlloc(*pml2, vaddr));
-
-        pml1->putPage(vaddr, {paddr, Entry::WRITE | Entry::PRESENT | Entry::USER});
+    template <usize L>
+    bool _canMapHuge(usize vaddr, usize paddr, usize size) {
+        if constexpr (L == 3) {
+            if (not _gibPages)
+                return false;
+        } else if constexpr (L != 2) {
+            return false;
+        }
 
-        return Ok();
+        return size == Pml<L>::SPAN and
+               isAlign(vaddr, Pml<L>::SPAN) and
+               isAlign(paddr, Pml<L>::SPAN);
     }
 
-    Res<> freePage(usize vaddr) {
-        auto pml3 = try$(pml(*_pml4, vaddr));
-        auto pml2 = try$(pml(*pml3, vaddr));
-        auto pml1 = try$(pml(*pml2, vaddr));
-        pml1->putPage(vaddr, {});
+    // Maps `size` bytes at `vaddr`, all of them under `pml`. Each table is
+    // visited once and its entries are filled in a row, using large pages
+    // wherever the addresses allow it.
+    template <usize L>
+    Res<> _mapRange(Pml<L> &pml, usize vaddr, usize paddr, usize size, Hal::VmmFlags flags) {
+        while (size) {
+            usize span = min(Pml<L>::SPAN - (vaddr & (Pml<L>::SPAN - 1)), size);
+            auto &entry = pml[pml.virt2index(vaddr)];
 
-        if (pml1->empty()) {
-            pml2->putPage(vaddr, {});
-            try$(_pmm.free({_mapper.unmap((usize)pml1), Hal::PAGE_SIZE}));
-        }
+            if constexpr (L == 1) {
+                entry = _leaf(paddr, flags);
+            } else if (not entry.present() and _canMapHuge<L>(vaddr, paddr, span)) {
+                entry = _leaf(paddr, flags);
+                entry._raw |= Entry::HUGE_PAGE;
+            } else {
+                auto *lower = try$(pmlOrAlloc(pml, vaddr));
+                try$(_mapRange(*lower, vaddr, paddr, span, flags));
+            }
 
-        if (pml2->empty()) {
-            pml3->putPage(vaddr, {});
-            try$(_pmm.free({_mapper.unmap((usize)pml2), Hal::PAGE_SIZE}));
+            vaddr += span;
+            paddr += span;
+            size -= span;
         }
 
-        if (pml3->empty()) {
-            _pml4->putPage(vaddr, {});
-            try$(_pmm.free({_mapper.unmap((usize)pml3), Hal::PAGE_SIZE}));
+        return Ok();
+    }
+
+    // Unmaps `size` bytes at `vaddr`, all of them under `pml`, and frees
+    // the tables left empty. Holes are skipped, pages mapped on demand may
+    // never have been touched.
+    template <usize L>
+    Res<> _freeRange(Pml<L> &pml, usize vaddr, usize size) {
+        while (size) {
+            usize span = min(Pml<L>::SPAN - (vaddr & (Pml<L>::SPAN - 1)), size);
+            auto &entry = pml[pml.virt2index(vaddr)];
+
+            if (not entry.present()) {
+                // Nothing to unmap here.
+            } else if constexpr (L == 1) {
+                entry = {};
+            } else if (entry.huge() and span == Pml<L>::SPAN) {
+                entry = {};
+            } else {
+                auto *lower = try$(pmlOrAlloc(pml, vaddr));
+                try$(_freeRange(*lower, vaddr, span));
+
+                if (lower->empty()) {
+                    entry = {};
+                    try$(_pmm.free({_mapper.unmap((usize)lower), Hal::PAGE_SIZE}));
+                }
+            }
+
+            vaddr += span;
+            size -= span;
         }
 
         return Ok();
@@ -85,17 +173,12 @@ struct Vmm : public Hal::Vmm {
             return Error::invalidInput();
         }
 
-        for (usize page = 0; page < vaddr.size; page += Hal::PAGE_SIZE) {
-            try$(allocPage(vaddr.start + page, paddr.start + page, flags));
-        }
+        try$(_mapRange(*_pml4, vaddr.start, paddr.start, vaddr.size, flags));
         return Ok(vaddr);
     }
 
     Res<> free(Hal::VmmRange vaddr) override {
-        for (usize page = 0; page < vaddr.size; page += Hal::PAGE_SIZE) {
-            try$(freePage(vaddr.start + page));
-        }
-        return Ok();
+        return _freeRange(*_pml4, vaddr.start, vaddr.size);
     }
 
     Res<> update(Hal::VmmRange, Hal::VmmFlags) override {
@@ -103,9 +186,7 @@ struct Vmm : public Hal::Vmm {
     }
 
     Res<> flush(Hal::VmmRange vaddr) override {
-        for (usize i = 0; i < vaddr.size; i += Hal::PAGE_SIZE) {
-            x86_64::invlpg(vaddr.start + i);
-        }
+        flushRange(vaddr);
         return Ok();
     }
 
@@ -122,6 +203,8 @@ struct Vmm : public Hal::Vmm {
                 if (page.present()) {
                     logInfo("x86_64: vmm: {x} {x}", curr, page._raw);
                 }
+            } else if (page.present() and page.huge()) {
+                logInfo("x86_64: vmm: {x} {x} (large)", curr, page._raw);
             } else if (page.present()) {
                 auto &lower = *_mapper.map(page.template as<Pml<L - 1>>());
                 _dumpPml(lower, curr);
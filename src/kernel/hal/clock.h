@@ -0,0 +1,26 @@
+#pragma once
+
+#include <karm-base/time.h>
+
+namespace Hal {
+
+// A monotonic counter, time is counted from when it was set up.
+struct Clock {
+    virtual ~Clock() = default;
+
+    virtual TimeStamp now() = 0;
+};
+
+// A timer raising a single interrupt at a given time.
+struct ClockEvent {
+    virtual ~ClockEvent() = default;
+
+    // Replaces the pending deadline, if `deadline` already passed the
+    // interrupt is raised right away. Deadlines too far away for the
+    // hardware fire early, the handler is expected to arm again.
+    virtual void arm(TimeStamp deadline) = 0;
+
+    virtual void disarm() = 0;
+};
+
+} // namespace Hal
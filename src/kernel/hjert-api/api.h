@@ -108,6 +108,14 @@ struct Vmo : public Object {
     static Res<Vmo> create(Cap dest, usize phys, usize len, VmoFlags flags = VmoFlags::NONE) {
         return create<Vmo>(dest, phys, len, flags);
     }
+
+    // A copy of the vmo, its pages are shared until either side writes
+    // them. Only vmos backed on demand can be cloned.
+    Res<Vmo> clone(Cap dest) {
+        Cap c;
+        try$(_clone(dest, &c, _cap));
+        return Ok(Vmo{c});
+    }
 };
 
 struct Space : public Object {
@@ -142,6 +150,12 @@ struct Space : public Object {
     Res<> unmap(USizeRange range) {
         return _unmap(_cap, range.start, range.size);
     }
+
+    Res<SpaceStat> stat() {
+        SpaceStat stat;
+        try$(_stat(_cap, &stat));
+        return Ok(stat);
+    }
 };
 
 struct Mapped {
@@ -220,6 +234,12 @@ struct Channel : public Object {
     Res<> send(Msg *msg, Domain &fo) {
         return _send(_cap, msg, fo);
     }
+
+    Res<Msg> recv(Domain &to) {
+        Msg msg{0};
+        try$(_recv(_cap, &msg, to));
+        return Ok(msg);
+    }
 };
 
 struct Irq : public Object {
@@ -0,0 +1,255 @@
+#pragma once
+
+#include <karm-base/align.h>
+#include <karm-base/atomic.h>
+
+#include "api.h"
+
+namespace Hj {
+
+/* --- Shared Ring ---------------------------------------------------------- */
+
+// Messages flow from a producer to a consumer through a vmo mapped by both
+// of them, without going through the kernel. The vmo starts with a header,
+// followed by the descriptors and then the area holding the payloads. A
+// channel is only used as a doorbell, to wake up a side that went to sleep
+// waiting on the other.
+
+static constexpr Sigs RING_FILLED = Sigs::USER0;  // The producer published descriptors
+static constexpr Sigs RING_DRAINED = Sigs::USER1; // The consumer released descriptors
+
+struct RingDesc {
+    Arg label;
+    u64 pos; // Position of the payload in the data area, before wrapping
+    u64 len;
+};
+
+struct RingHeader {
+    static constexpr u64 MAGIC = 0x676e69526a48; // "HjRing"
+
+    u64 magic;
+    u64 slots;    // Number of descriptors, a power of two
+    u64 dataSize; // Size of the data area, a power of two
+
+    // Written by the producer, on its own cache line.
+    alignas(64) Atomic<u64> head;
+    Atomic<u32> producerWaiting;
+
+    // Written by the consumer.
+    alignas(64) Atomic<u64> tail;
+    Atomic<u64> dataTail;
+    Atomic<u32> consumerWaiting;
+};
+
+struct RingMsg {
+    Arg label;
+    Bytes payload;
+};
+
+// One end of a shared ring. Only one side pushes and only the other one
+// pops, neither needs a lock.
+struct Ring {
+    static constexpr usize PAGE = 4096;
+
+    Vmo _vmo;
+    Channel _bell;
+    Listener _listener;
+    Mapped _mem;
+    bool _watching = false;
+
+    // Producer side, descriptors pushed but not flushed yet are past the
+    // head of the header.
+    u64 _head = 0;
+    u64 _dataHead = 0;
+
+    // Consumer side, descriptors popped but not released yet are past the
+    // tail of the header.
+    u64 _tail = 0;
+    u64 _dataTail = 0;
+
+    static usize _descsOff() {
+        return alignUp(sizeof(RingHeader), 64);
+    }
+
+    static usize _dataOff(usize slots) {
+        return alignUp(_descsOff() + slots * sizeof(RingDesc), PAGE);
+    }
+
+    static Res<Ring> _open(Vmo vmo, Channel bell) {
+        auto mem = try$(map(vmo, MapFlags::READ | MapFlags::WRITE));
+        auto listener = try$(Listener::create(ROOT));
+        return Ok(Ring{std::move(vmo), std::move(bell), std::move(listener), std::move(mem)});
+    }
+
+    // Sets up a ring holding `slots` descriptors and `dataSize` bytes of
+    // payload, both powers of two. The vmo and the bell are then handed to
+    // the other end, which opens it.
+    static Res<Ring> create(usize slots, usize dataSize) {
+        if (slots == 0 or (slots & (slots - 1)) or
+            dataSize < PAGE or (dataSize & (dataSize - 1)))
+            return Error::invalidInput("ring sizes must be powers of two");
+
+        auto vmo = try$(Vmo::create(ROOT, 0, _dataOff(slots) + dataSize, VmoFlags::UPPER));
+        auto bell = try$(Channel::create(ROOT, 1));
+        auto ring = try$(_open(std::move(vmo), std::move(bell)));
+
+        auto &header = ring._header();
+        header.slots = slots;
+        header.dataSize = dataSize;
+        header.magic = RingHeader::MAGIC;
+
+        return Ok(std::move(ring));
+    }
+
+    static Res<Ring> open(Vmo vmo, Channel bell) {
+        auto ring = try$(_open(std::move(vmo), std::move(bell)));
+
+        auto &header = ring._header();
+        usize size = ring._mem.range().size;
+        if (header.magic != RingHeader::MAGIC or
+            _dataOff(header.slots) + header.dataSize > size)
+            return Error::invalidData("not a ring");
+
+        return Ok(std::move(ring));
+    }
+
+    Ring(Vmo vmo, Channel bell, Listener listener, Mapped mem)
+        : _vmo(std::move(vmo)),
+          _bell(std::move(bell)),
+          _listener(std::move(listener)),
+          _mem(std::move(mem)) {}
+
+    Ring(Ring &&) = default;
+
+    Vmo &vmo() { return _vmo; }
+
+    Channel &bell() { return _bell; }
+
+    RingHeader &_header() {
+        return *reinterpret_cast<RingHeader *>(_mem._addr);
+    }
+
+    RingDesc &_desc(u64 i) {
+        auto *descs = reinterpret_cast<RingDesc *>(_mem._addr + _descsOff());
+        return descs[i & (_header().slots - 1)];
+    }
+
+    MutBytes _payload(u64 pos, u64 len) {
+        auto *data = reinterpret_cast<u8 *>(_mem._addr + _dataOff(_header().slots));
+        return {data + (pos & (_header().dataSize - 1)), len};
+    }
+
+    // Sleeps until `ready()` or the deadline, `waiting` tells the other side
+    // to ring the bell with `sig`.
+    Res<> _wait(Atomic<u32> &waiting, Sigs sig, auto ready, TimeStamp deadline) {
+        if (not _watching) {
+            try$(_listener.watch(_bell, sig, Sigs::NONE));
+            _watching = true;
+        }
+
+        // Pairs with the barrier in flush() and release(), either we see
+        // what the other side did, or it sees we are waiting.
+        waiting.store(1, SEQ_CST);
+        memoryBarier();
+        if (ready()) {
+            waiting.store(0, RELAXED);
+            return Ok();
+        }
+
+        auto res = _listener.listen(deadline);
+        waiting.store(0, RELAXED);
+        try$(_bell.signal(Sigs::NONE, sig));
+        return res;
+    }
+
+    /* --- Producer --------------------------------------------------------- */
+
+    // Adds a message with room for `len` bytes of payload, filled in place.
+    // The consumer sees it after the next flush().
+    Res<MutBytes> push(Arg label, usize len) {
+        auto &header = _header();
+        if (_head - header.tail.load(ACQUIRE) == header.slots)
+            return Error::wouldBlock("ring full");
+
+        // Payloads don't wrap around, what's left at the end is skipped.
+        u64 pos = _dataHead;
+        u64 off = pos & (header.dataSize - 1);
+        if (off + len > header.dataSize)
+            pos += header.dataSize - off;
+
+        if (len > header.dataSize or
+            pos + len - header.dataTail.load(ACQUIRE) > header.dataSize)
+            return Error::wouldBlock("ring data full");
+
+        _desc(_head) = {label, pos, len};
+        _head++;
+        _dataHead = pos + len;
+        return Ok(_payload(pos, len));
+    }
+
+    // Publishes everything pushed so far at once, entering the kernel only
+    // if the consumer is asleep.
+    Res<> flush() {
+        auto &header = _header();
+        header.head.store(_head, RELEASE);
+        memoryBarier();
+        if (header.consumerWaiting.load(RELAXED))
+            return _bell.signal(RING_FILLED, Sigs::NONE);
+        return Ok();
+    }
+
+    // Waits for the consumer to release some descriptors.
+    Res<> waitDrained(TimeStamp deadline = TimeStamp::endOfTime()) {
+        auto &header = _header();
+        u64 tail = header.tail.load(ACQUIRE);
+        if (_head - tail < header.slots and
+            _dataHead - header.dataTail.load(ACQUIRE) < header.dataSize)
+            return Ok();
+
+        auto drained = [&] {
+            return header.tail.load(ACQUIRE) != tail;
+        };
+        return _wait(header.producerWaiting, RING_DRAINED, drained, deadline);
+    }
+
+    /* --- Consumer --------------------------------------------------------- */
+
+    // The next message, its payload stays valid until release().
+    Res<RingMsg> pop() {
+        auto &header = _header();
+        if (_tail == header.head.load(ACQUIRE))
+            return Error::wouldBlock("ring empty");
+
+        RingDesc desc = _desc(_tail);
+        u64 off = desc.pos & (header.dataSize - 1);
+        if (desc.len > header.dataSize - off)
+            return Error::invalidData("bad ring descriptor");
+
+        _tail++;
+        _dataTail = desc.pos + desc.len;
+        return Ok(RingMsg{desc.label, _payload(desc.pos, desc.len)});
+    }
+
+    // Hands the messages popped so far back to the producer, entering the
+    // kernel only if it is asleep.
+    Res<> release() {
+        auto &header = _header();
+        header.dataTail.store(_dataTail, RELAXED);
+        header.tail.store(_tail, RELEASE);
+        memoryBarier();
+        if (header.producerWaiting.load(RELAXED))
+            return _bell.signal(RING_DRAINED, Sigs::NONE);
+        return Ok();
+    }
+
+    // Waits for the producer to publish some descriptors.
+    Res<> waitFilled(TimeStamp deadline = TimeStamp::endOfTime()) {
+        auto &header = _header();
+        auto filled = [&] {
+            return header.head.load(ACQUIRE) != _tail;
+        };
+        return _wait(header.consumerWaiting, RING_FILLED, filled, deadline);
+    }
+};
+
+} // namespace Hj
@@ -90,4 +90,12 @@ Res<> _listen(Cap cap, Event *ev, usize evLen, TimeStamp deadline) {
     return _syscall(Syscall::LISTEN, cap.raw(), (Arg)ev, evLen, deadline.val());
 }
 
+Res<> _clone(Cap node, Cap *dst, Cap src) {
+    return _syscall(Syscall::CLONE, node.raw(), (Arg)dst, src.raw());
+}
+
+Res<> _stat(Cap cap, SpaceStat *stat) {
+    return _syscall(Syscall::STAT, cap.raw(), (Arg)stat);
+}
+
 } //  namespace Hj
@@ -36,4 +36,8 @@ Res<> _watch(Cap cap, Cap target, Flags<Sigs> set, Flags<Sigs> unset);
 
 Res<> _listen(Cap cap, Event *ev, usize evLen, TimeStamp deadline);
 
+Res<> _clone(Cap node, Cap *dst, Cap src);
+
+Res<> _stat(Cap cap, SpaceStat *stat);
+
 } // namespace Hj
@@ -58,7 +58,9 @@ static inline char const *toStr(Type type) {
     SYSCALL(CLOSE)               \
     SYSCALL(SIGNAL)              \
     SYSCALL(WATCH)               \
-    SYSCALL(LISTEN)
+    SYSCALL(LISTEN)              \
+    SYSCALL(CLONE)               \
+    SYSCALL(STAT)
 
 // clang-format off
 
@@ -229,6 +231,15 @@ struct SpaceProps {
     static constexpr Type TYPE = Type::SPACE;
 };
 
+// Paging activity of a space, for profiling.
+struct SpaceStat {
+    usize faults; // Page faults served
+    usize zero;   // Pages mapped to the shared zero page
+    usize fills;  // Pages populated with zeros on a write
+    usize copies; // Shared pages copied on a write
+    usize around; // Populated pages mapped along with a fault
+};
+
 struct VmoProps {
     static constexpr Type TYPE = Type::VMO;
     usize phys;
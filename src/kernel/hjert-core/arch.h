@@ -1,5 +1,6 @@
 #pragma once
 
+#include <hal/clock.h>
 #include <hal/vmm.h>
 #include <handover/spec.h>
 #include <hjert-api/types.h>
@@ -25,6 +26,33 @@ Core::Cpu &cpu();
 
 Res<> init(Handover::Payload &);
 
+/* --- Time ----------------------------------------------------------------- */
+
+// Calibrates the clock and sets up the timer of the bootstrap processor,
+// the memory has to be mapped already.
+Res<> initTime(Handover::Payload &);
+
+// Counts from boot, the same on every processor.
+Hal::Clock &clock();
+
+// The timer of the processor running it, it calls into the scheduler when
+// it fires.
+Hal::ClockEvent &clockEvent();
+
+/* --- Smp ------------------------------------------------------------------ */
+
+// Starts the other processors, each of them calls `entry` once it runs on
+// its own stack, GDT and TSS. `entry` never returns.
+Res<> startCpus(Handover::Payload &, void (*entry)());
+
+usize cpuCount();
+
+// The processor with index `id`, or nullptr if there is none.
+Core::Cpu *cpu(usize id);
+
+// Interrupts processor `cpu` so it goes through the scheduler.
+void reschedule(usize cpu);
+
 Hal::Vmm &vmm();
 
 Io::TextWriter &loggerOut();
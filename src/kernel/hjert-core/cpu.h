@@ -11,12 +11,20 @@
 #include <karm-base/vec.h>
 
 #include "arch.h"
+#include "mem.h"
 
 namespace Hjert::Core {
 
+struct Space;
+
 struct Cpu {
+    static constexpr usize MAX = 64;
+
+    usize _id = 0; // Index of the processor, the bootstrap one is 0
     bool _retainEnabled = false;
     isize _depth = 0;
+    Space *_userAccess = nullptr; // Locked space whose user memory is accessed
+    PageCache _pageCache;
 
     void beginInterrupt() {
         _retainEnabled = false;
@@ -50,11 +58,19 @@ struct Cpu {
         }
     }
 
+    usize id() const {
+        return _id;
+    }
+
     virtual void enableInterrupts() = 0;
 
     virtual void disableInterrupts() = 0;
 
+    // Waits for the next interrupt, used by the idle loop.
     virtual void relaxe() = 0;
+
+    // Called while spinning on a lock, interrupts might be disabled.
+    virtual void pause() = 0;
 };
 
 struct InterruptRetainer : public Meta::Static {
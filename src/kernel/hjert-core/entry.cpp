@@ -115,6 +115,22 @@ Res<> enterUserspace(Handover::Payload &payload) {
     return Ok();
 }
 
+[[noreturn]] void idle() {
+    logInfo("entry: entering idle loop...");
+    Task::self().label("idle");
+    Task::self().enterIdleMode();
+    while (true)
+        Arch::cpu().relaxe();
+}
+
+// Entry point of the other processors, once the arch layer brought them up.
+void initCpu() {
+    Sched::initCpu().unwrap("failed to initialize the scheduler");
+    Arch::cpu().retainEnable();
+    Arch::cpu().enableInterrupts();
+    idle();
+}
+
 Res<> init(u64 magic, Handover::Payload &payload) {
     try$(Arch::init(payload));
 
@@ -122,20 +138,21 @@ Res<> init(u64 magic, Handover::Payload &payload) {
     try$(validateAndDump(magic, payload));
 
     try$(Mem::init(payload));
+    try$(Arch::initTime(payload));
     try$(Sched::init(payload));
 
     logInfo("entry: everything is ready, enabling interrupts...");
     Arch::cpu().retainEnable();
     Arch::cpu().enableInterrupts();
 
+    logInfo("entry: starting the other cpus...");
+    if (auto res = Arch::startCpus(payload, initCpu); not res)
+        logError("entry: failed to start the other cpus: {}", res.none().msg());
+
     logInfo("entry: entering userspace...");
     try$(enterUserspace(payload));
 
-    logInfo("entry: entering idle loop...");
-    Task::self().label("idle");
-    Task::self().enterIdleMode();
-    while (true)
-        Arch::cpu().relaxe();
+    idle();
 }
 
 } // namespace Hjert::Core
@@ -145,7 +162,8 @@ Res<> init(u64 magic, Handover::Payload &payload) {
 HandoverRequests$(
     Handover::requestStack(),
     Handover::requestFb(),
-    Handover::requestFiles());
+    Handover::requestFiles(),
+    Handover::requestRsdp());
 
 Res<> entryPoint(u64 magic, Handover::Payload &payload) {
     return Hjert::Core::init(magic, payload);
@@ -4,14 +4,24 @@
 #include <karm-logger/logger.h>
 
 #include "arch.h"
+#include "cpu.h"
 #include "mem.h"
 
 namespace Hjert::Core {
 
+// Visits the page cache of every processor.
+static void _eachPageCache(auto f) {
+    for (usize i = 0; i < Cpu::MAX; i++) {
+        if (auto *cpu = Arch::cpu(i))
+            f(cpu->_pageCache);
+    }
+}
+
 struct Pmm : public Hal::Pmm {
     Hal::PmmRange _usable;
     Bits _bits;
     Lock _lock;
+    usize _hint = 0; // Where the last lower allocation ended
 
     Pmm(Hal::PmmRange usable, Bits bits)
         : _usable(usable),
@@ -19,12 +29,49 @@ struct Pmm : public Hal::Pmm {
         clear();
     }
 
+    // Both expect the lock of the cache and of the pmm to be held, in that
+    // order.
+    void _refillUnlock(PageCache &cache) {
+        while (cache._len < PageCache::CAP / 2) {
+            auto page = _bits.alloc(1, _hint, false);
+            if (not page and _hint != 0) {
+                _hint = 0;
+                continue;
+            }
+            if (not page)
+                break;
+            _hint = page->end();
+            cache.push(page->start);
+        }
+    }
+
+    void _flushUnlock(PageCache &cache, usize keep = PageCache::CAP / 2) {
+        while (cache._len > keep)
+            _bits.set(BitsRange{cache.pop(), 1}, false);
+    }
+
     Res<Hal::PmmRange> allocRange(usize size, Hal::PmmFlags flags) override {
-        LockScope scope(_lock);
         auto upper = (flags & Hal::PmmFlags::UPPER) == Hal::PmmFlags::UPPER;
 
         try$(ensureAlign(size, Hal::PAGE_SIZE));
         size /= Hal::PAGE_SIZE;
+
+        if (size == 1 and not upper) {
+            // Being moved to another processor meanwhile is fine, its
+            // cache is locked all the same.
+            auto &cache = Arch::cpu()._pageCache;
+            LockScope cacheScope(cache._lock);
+            if (not cache.empty())
+                return Ok(bits2Pmm({cache.pop(), 1}));
+
+            LockScope scope(_lock);
+            _refillUnlock(cache);
+            if (not cache.empty())
+                return Ok(bits2Pmm({cache.pop(), 1}));
+            return Ok(bits2Pmm(try$(_bits.alloc(size, 0, false))));
+        }
+
+        LockScope scope(_lock);
         return Ok(bits2Pmm(try$(_bits.alloc(size, upper ? -1 : 0, upper))));
     }
 
@@ -33,8 +80,16 @@ struct Pmm : public Hal::Pmm {
             return Ok();
         }
 
-        LockScope scope(_lock);
         try$(range.ensureAligned(Hal::PAGE_SIZE));
+
+        // The range might be sitting in a cache.
+        _eachPageCache([&](PageCache &cache) {
+            LockScope cacheScope(cache._lock);
+            LockScope scope(_lock);
+            _flushUnlock(cache, 0);
+        });
+
+        LockScope scope(_lock);
         _bits.set(pmm2Bits(range), true);
         return Ok();
     }
@@ -44,13 +99,31 @@ struct Pmm : public Hal::Pmm {
             return Error::invalidInput("range is not in usable memory");
         }
 
-        LockScope scope(_lock);
         try$(range.ensureAligned(Hal::PAGE_SIZE));
-        _bits.set(pmm2Bits(range), false);
+        auto bits = pmm2Bits(range);
+
+        if (bits.size == 1) {
+            auto &cache = Arch::cpu()._pageCache;
+            LockScope cacheScope(cache._lock);
+            if (cache.full()) {
+                LockScope scope(_lock);
+                _flushUnlock(cache);
+            }
+            cache.push(bits.start);
+            return Ok();
+        }
+
+        LockScope scope(_lock);
+        _bits.set(bits, false);
         return Ok();
     }
 
     void clear() {
+        _eachPageCache([](PageCache &cache) {
+            LockScope cacheScope(cache._lock);
+            cache._len = 0;
+        });
+
         LockScope scope(_lock);
         _bits.fill(true);
     }
@@ -120,7 +193,8 @@ Res<> init(Handover::Payload &payload) {
 
     logInfo("mem: usable range: {x}-{x}", usableRange.start, usableRange.end());
 
-    usize bitsSize = usableRange.size / Hal::PAGE_SIZE / 8;
+    usize pages = usableRange.size / Hal::PAGE_SIZE;
+    usize bitsSize = alignUp(Bits::storageLen(pages) * sizeof(u64), Hal::PAGE_SIZE);
 
     auto pmmBits = payload.find(bitsSize);
 
@@ -132,9 +206,12 @@ Res<> init(Handover::Payload &payload) {
     logInfo("mem: pmm bitmap range: {x}-{x}", pmmBits.start, pmmBits.end());
 
     _pmm.emplace(usableRange,
-                 MutSlice{
-                     reinterpret_cast<u8 *>(pmmBits.start + Hal::UPPER_HALF),
-                     pmmBits.size,
+                 Bits{
+                     MutSlice{
+                         reinterpret_cast<u64 *>(pmmBits.start + Hal::UPPER_HALF),
+                         pmmBits.size / sizeof(u64),
+                     },
+                     pages,
                  });
 
     _kmm.emplace(_pmm.unwrap());
@@ -152,13 +229,13 @@ Res<> init(Handover::Payload &payload) {
     try$(vmm().mapRange(
         {Handover::KERNEL_BASE + Hal::PAGE_SIZE, gib(2) - Hal::PAGE_SIZE - Hal::PAGE_SIZE},
         {Hal::PAGE_SIZE, gib(2) - Hal::PAGE_SIZE - Hal::PAGE_SIZE},
-        Hal::Vmm::READ | Hal::Vmm::WRITE));
+        Hal::Vmm::READ | Hal::Vmm::WRITE | Hal::Vmm::GLOBAL));
 
     logInfo("mem: mapping upper half...");
     try$(vmm().mapRange(
         {Handover::UPPER_HALF + Hal::PAGE_SIZE, gib(4) - Hal::PAGE_SIZE},
         {Hal::PAGE_SIZE, gib(4) - Hal::PAGE_SIZE},
-        Hal::Vmm::READ | Hal::Vmm::WRITE));
+        Hal::Vmm::READ | Hal::Vmm::WRITE | Hal::Vmm::GLOBAL));
 
     vmm().activate();
 
@@ -4,9 +4,31 @@
 #include <hal/pmm.h>
 #include <hal/vmm.h>
 #include <handover/spec.h>
+#include <karm-base/array.h>
+#include <karm-base/lock.h>
 
 namespace Hjert::Core {
 
+// Single pages are by far the most common allocation (page tables, kernel
+// heap blocks), each processor serves them from a small stack of pages
+// taken from the pmm bitmap in batches. The lock is only contended when
+// the pmm drains the caches of every processor.
+struct PageCache {
+    static constexpr usize CAP = 64;
+
+    Lock _lock;
+    Array<usize, CAP> _pages{};
+    usize _len = 0;
+
+    bool empty() const { return _len == 0; }
+
+    bool full() const { return _len == CAP; }
+
+    usize pop() { return _pages[--_len]; }
+
+    void push(usize page) { _pages[_len++] = page; }
+};
+
 namespace Mem {
 Res<> init(Handover::Payload &);
 } // namespace Mem
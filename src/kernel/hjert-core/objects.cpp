@@ -10,6 +10,13 @@ namespace Hjert::Core {
 
 Atomic<usize> Object::_counter = 0;
 
+// Waking takes the lock of a scheduler, which evaluates blockers that might
+// need the lock of an object, it's done once they are released.
+static void _wake(Vec<Strong<Task>> &woken) {
+    for (auto &task : woken)
+        Sched::wake(task);
+}
+
 void Object::label(Str label) {
     LockScope scope(_lock);
     _label = String(label);
@@ -19,9 +26,12 @@ Str Object::label() const {
     return _label ? *_label : "<no label>";
 }
 
-void Object::_signalUnlock(Flags<Hj::Sigs> set, Flags<Hj::Sigs> unset) {
+void Object::_signalUnlock(Flags<Hj::Sigs> set, Flags<Hj::Sigs> unset, Vec<Strong<Task>> &woken) {
     _signals |= set;
     _signals &= ~unset;
+
+    for (auto *watch : _watchers)
+        watch->listener._notify(*watch, _signals, woken);
 }
 
 Flags<Hj::Sigs> Object::_pollUnlock() {
@@ -29,8 +39,12 @@ Flags<Hj::Sigs> Object::_pollUnlock() {
 }
 
 void Object::signal(Flags<Hj::Sigs> set, Flags<Hj::Sigs> unset) {
-    LockScope scope(_lock);
-    _signalUnlock(set, unset);
+    Vec<Strong<Task>> woken;
+    {
+        LockScope scope(_lock);
+        _signalUnlock(set, unset, woken);
+    }
+    _wake(woken);
 }
 
 Flags<Hj::Sigs> Object::poll() {
@@ -44,55 +58,93 @@ Res<Strong<Domain>> Domain::create() {
     return Ok(makeStrong<Domain>());
 }
 
-Res<Hj::Cap> Domain::add(Hj::Cap dest, Strong<Object> obj) {
-    ObjectLockScope scope(*this);
-
-    auto c = dest.raw();
-
-    if (c != 0)
-        return try$(get<Domain>(c & MASK))->add(c >> SHIFT, obj);
+Res<Strong<Domain>> Domain::_child(Hj::Cap cap) {
+    return get<Domain>(cap.raw() & HOP_MASK);
+}
 
-    for (c = 1; c < _slots.len(); c++) {
-        if (not _slots[c]) {
-            _slots[c] = obj;
-            return Ok(c);
-        }
+Res<> Domain::_ensurePath(Hj::Cap cap) {
+    if constexpr (MAX_HOPS * HOP_BITS < sizeof(Hj::Arg) * 8) {
+        if (cap.raw() >> (MAX_HOPS * HOP_BITS))
+            return Error::invalidHandle("cap is too deep");
     }
-
-    return Error::invalidHandle("no free slots");
+    return Ok();
 }
 
-Res<Strong<Object>> Domain::get(Hj::Cap cap) {
-    ObjectLockScope scope(*this);
+Res<Hj::Cap> Domain::add(Hj::Cap dest, Strong<Object> obj) {
+    try$(_ensurePath(dest));
+    if (not dest.isRoot())
+        return try$(_child(dest))->add(dest.raw() >> HOP_BITS, obj);
 
-    auto c = cap.raw();
+    ObjectLockScope scope(*this);
+    auto handle = _slots.add(obj);
+    if (not handle)
+        return Error::invalidHandle("no free slots");
+    return Ok(*handle);
+}
 
-    if (c & ~MASK)
-        return try$(get<Domain>(c & MASK))->get(c >> SHIFT);
+Res<Strong<Object>> Domain::get(Hj::Cap cap) {
+    try$(_ensurePath(cap));
+    if (cap.raw() >> HOP_BITS)
+        return try$(_child(cap))->get(cap.raw() >> HOP_BITS);
 
-    if (not _slots[c])
+    ObjectLockScope scope(*this);
+    auto *obj = _slots.access(cap.raw());
+    if (not obj)
         return Error::invalidHandle("slot is empty");
-
-    return Ok(*_slots[c]);
+    return Ok(*obj);
 }
 
 Res<> Domain::drop(Hj::Cap cap) {
-    ObjectLockScope scope(*this);
-
-    auto c = cap.raw();
-
-    if (c & ~MASK)
-        return try$(get<Domain>(c & MASK))->drop(c >> SHIFT);
+    try$(_ensurePath(cap));
+    if (cap.raw() >> HOP_BITS)
+        return try$(_child(cap))->drop(cap.raw() >> HOP_BITS);
+
+    // The object is released once the lock is, its destructor may have to
+    // take other locks.
+    Opt<Strong<Object>> obj = NONE;
+    {
+        ObjectLockScope scope(*this);
+        obj = _slots.take(cap.raw());
+    }
 
-    if (not _slots[c])
+    if (not obj)
         return Error::invalidHandle("slot is empty");
-
-    _slots[c] = NONE;
     return Ok();
 }
 
 /* --- Vmo ------------------------------------------------------------------ */
 
+static Lock _zeroLock{};
+static Opt<Hal::PmmRange> _zero = NONE;
+
+// The page every empty page of every paged vmo is read from.
+static Res<Hal::PmmRange> _zeroPage() {
+    LockScope scope{_zeroLock};
+    if (not _zero) {
+        auto range = try$(pmm().allocRange(Hal::PAGE_SIZE, Hal::PmmFlags::UPPER));
+        zeroFill(try$(kmm().pmm2Kmm(range)).mutBytes());
+        _zero = range;
+    }
+    return Ok(*_zero);
+}
+
+static Res<Rc<Frame>> _allocFrame(Opt<Hal::PmmRange> from = NONE) {
+    auto mem = try$(pmm().allocOwned(Hal::PAGE_SIZE, Hal::PmmFlags::UPPER));
+    auto dst = try$(kmm().pmm2Kmm(mem.range())).mutBytes();
+    if (from)
+        copy(try$(kmm().pmm2Kmm(*from)).bytes(), dst);
+    else
+        zeroFill(dst);
+    return Ok(makeRc<Frame>(std::move(mem)));
+}
+
+// A shared frame is mapped read-only, writing it faults and copies it.
+static Hj::MapFlags _frameFlags(Hj::MapFlags flags, Frame &frame) {
+    if (frame.shared())
+        return flags & ~Hj::MapFlags::WRITE;
+    return flags;
+}
+
 Res<Strong<VNode>> VNode::alloc(usize size, Hj::VmoFlags) {
     if (size == 0) {
         return Error::invalidInput("size is zero");
@@ -100,7 +152,18 @@ Res<Strong<VNode>> VNode::alloc(usize size, Hj::VmoFlags) {
 
     try$(ensureAlign(size, Hal::PAGE_SIZE));
     Hal::PmmMem mem = try$(pmm().allocOwned(size, Hal::PmmFlags::UPPER));
-    return Ok(makeStrong<VNode>(std::move(mem)));
+    return Ok(makeStrong<VNode>(std::move(mem), size));
+}
+
+Res<Strong<VNode>> VNode::create(usize size, Hj::VmoFlags) {
+    if (size == 0) {
+        return Error::invalidInput("size is zero");
+    }
+
+    try$(ensureAlign(size, Hal::PAGE_SIZE));
+    Pages pages;
+    pages.resize(size / Hal::PAGE_SIZE, NONE);
+    return Ok(makeStrong<VNode>(std::move(pages), size));
 }
 
 Res<Strong<VNode>> VNode::makeDma(Hal::DmaRange prange) {
@@ -109,7 +172,7 @@ Res<Strong<VNode>> VNode::makeDma(Hal::DmaRange prange) {
     }
 
     try$(prange.ensureAligned(Hal::PAGE_SIZE));
-    return Ok(makeStrong<VNode>(prange));
+    return Ok(makeStrong<VNode>(prange, prange.size));
 }
 
 Hal::PmmRange VNode::range() {
@@ -121,9 +184,122 @@ Hal::PmmRange VNode::range() {
             [](Hal::DmaRange const &range) {
                 return range.as<Hal::PmmRange>();
             },
+            [](Pages const &) -> Hal::PmmRange {
+                panic("paged vmos have no range");
+            },
         });
 }
 
+Res<Strong<VNode>> VNode::clone() {
+    ObjectLockScope scope(*this);
+
+    if (not isPaged()) {
+        return Error::invalidInput("only paged vmos can be cloned");
+    }
+
+    auto &pages = _mem.unwrap<Pages>();
+    Pages shared = pages;
+
+    // The pages are now shared, mappings that could write them lose that
+    // right until they copy them.
+    for (auto &mapping : _mappings) {
+        if ((mapping.flags & Hj::MapFlags::WRITE) != Hj::MapFlags::WRITE)
+            continue;
+
+        usize first = mapping.off / Hal::PAGE_SIZE;
+        usize last = first + mapping.vrange.size / Hal::PAGE_SIZE;
+        for (usize i = first; i < last; i++) {
+            if (not pages[i])
+                continue;
+            try$(mapping.space->_mapPage(mapping.vaddr(i), (*pages[i])->range(), mapping.flags & ~Hj::MapFlags::WRITE));
+        }
+        try$(mapping.space->_flush(mapping.vrange));
+    }
+
+    return Ok(makeStrong<VNode>(std::move(shared), _size));
+}
+
+void VNode::_attach(Mapping mapping) {
+    ObjectLockScope scope(*this);
+    _mappings.pushBack(mapping);
+}
+
+void VNode::_detach(Space &space, Hal::VmmRange vrange) {
+    ObjectLockScope scope(*this);
+    for (usize i = 0; i < _mappings.len(); i++) {
+        auto &mapping = _mappings[i];
+        if (mapping.space == &space and Op::eq(mapping.vrange, vrange)) {
+            _mappings.removeAt(i);
+            return;
+        }
+    }
+}
+
+Res<> VNode::_repoint(usize index) {
+    auto &frame = *_mem.unwrap<Pages>()[index];
+    for (auto &mapping : _mappings) {
+        usize first = mapping.off / Hal::PAGE_SIZE;
+        if (index < first or index >= first + mapping.vrange.size / Hal::PAGE_SIZE)
+            continue;
+
+        usize vaddr = mapping.vaddr(index);
+        try$(mapping.space->_mapPage(vaddr, frame->range(), _frameFlags(mapping.flags, *frame)));
+        try$(mapping.space->_flush({vaddr, Hal::PAGE_SIZE}));
+    }
+    return Ok();
+}
+
+void VNode::_faultAround(Mapping const &at, usize index, Hj::SpaceStat &stat) {
+    auto &pages = _mem.unwrap<Pages>();
+    usize base = alignDown(index, FAULT_AROUND);
+    usize first = max(base, at.off / Hal::PAGE_SIZE);
+    usize last = min(base + FAULT_AROUND, (at.off + at.vrange.size) / Hal::PAGE_SIZE);
+
+    for (usize i = first; i < last; i++) {
+        if (i == index or not pages[i])
+            continue;
+
+        // Best effort, the page is mapped on its own fault otherwise.
+        auto &frame = *pages[i];
+        if (at.space->_mapPage(at.vaddr(i), frame->range(), _frameFlags(at.flags, *frame)))
+            stat.around++;
+    }
+}
+
+Res<> VNode::fault(Mapping const &at, usize vaddr, bool write) {
+    auto &stat = at.space->_stat;
+    ObjectLockScope scope(*this);
+
+    auto &pages = _mem.unwrap<Pages>();
+    usize index = (vaddr - at.vrange.start + at.off) / Hal::PAGE_SIZE;
+    auto &page = pages[index];
+
+    if (write and not page) {
+        page = try$(_allocFrame());
+        stat.fills++;
+        try$(_repoint(index));
+    } else if (write and (*page)->shared()) {
+        page = try$(_allocFrame((*page)->range()));
+        stat.copies++;
+        try$(_repoint(index));
+    } else if (write) {
+        // Mapped read-only while it was shared.
+        try$(at.space->_mapPage(vaddr, (*page)->range(), at.flags));
+        try$(at.space->_flush({vaddr, Hal::PAGE_SIZE}));
+    } else if (page) {
+        try$(at.space->_mapPage(vaddr, (*page)->range(), _frameFlags(at.flags, **page)));
+    } else {
+        try$(at.space->_mapPage(vaddr, try$(_zeroPage()), at.flags & ~Hj::MapFlags::WRITE));
+        stat.zero++;
+    }
+
+    // Writes go one page at a time, their neighbours are either empty or
+    // already mapped by the writes before them.
+    if (not write)
+        _faultAround(at, index, stat);
+    return Ok();
+}
+
 /* --- Space ---------------------------------------------------------------- */
 
 Res<Strong<Space>> Space::create() {
@@ -152,18 +328,85 @@ Res<usize> Space::_lookup(Hal::VmmRange vrange) {
     return Error::invalidInput("no such mapping");
 }
 
+Space::Map *Space::_find(Hal::VmmRange vrange) {
+    for (auto &map : _maps) {
+        if (map.vrange.contains(vrange)) {
+            return &map;
+        }
+    }
+
+    return nullptr;
+}
+
+Res<> Space::_validate(Hal::VmmRange vrange, bool write) {
+    auto *map = _find(vrange);
+    if (not map) {
+        return Error::invalidInput("bad address");
+    }
+
+    if (write and (map->flags & Hj::MapFlags::WRITE) != Hj::MapFlags::WRITE) {
+        return Error::invalidInput("read-only address");
+    }
+
+    if (not map->vmo->isPaged() or vrange.size == 0) {
+        return Ok();
+    }
+
+    usize start = alignDown(vrange.start, Hal::PAGE_SIZE);
+    for (usize vaddr = start; vaddr < vrange.end(); vaddr += Hal::PAGE_SIZE)
+        try$(_fault(*map, vaddr, write));
+
+    return Ok();
+}
+
+Res<> Space::_fault(Map &map, usize vaddr, bool write) {
+    VNode::Mapping at{this, map.vrange, map.off, map.flags};
+    return map.vmo->fault(at, alignDown(vaddr, Hal::PAGE_SIZE), write);
+}
+
+Res<> Space::fault(usize vaddr, bool write) {
+    ObjectLockScope scope(*this);
+    return _faultUnlock(vaddr, write);
+}
+
+Res<> Space::_faultUnlock(usize vaddr, bool write) {
+    auto *map = _find({vaddr, 1});
+    if (not map or not map->vmo->isPaged()) {
+        return Error::invalidInput("bad address");
+    }
+
+    if (write and (map->flags & Hj::MapFlags::WRITE) != Hj::MapFlags::WRITE) {
+        return Error::invalidInput("read-only address");
+    }
+
+    _stat.faults++;
+    return _fault(*map, vaddr, write);
+}
+
+Res<> Space::_mapPage(usize vaddr, Hal::PmmRange frame, Hj::MapFlags flags) {
+    LockScope scope(_vmmLock);
+    try$(vmm().mapRange({vaddr, Hal::PAGE_SIZE}, frame, flags | Hal::VmmFlags::USER));
+    return Ok();
+}
+
+Res<> Space::_flush(Hal::VmmRange vrange) {
+    LockScope scope(_vmmLock);
+    return vmm().flush(vrange);
+}
+
 Res<Hal::VmmRange> Space::map(Hal::VmmRange vrange, Strong<VNode> vmo, usize off, Hj::MapFlags flags) {
     ObjectLockScope scope(*this);
 
     try$(vrange.ensureAligned(Hal::PAGE_SIZE));
+    try$(ensureAlign(off, Hal::PAGE_SIZE));
 
     if (vrange.size == 0) {
-        vrange.size = vmo->range().size;
+        vrange.size = vmo->size();
     }
 
     auto end = try$(checkedAdd(off, vrange.size));
 
-    if (end > vmo->range().size) {
+    if (end > vmo->size()) {
         return Error::invalidInput("mapping too large");
     }
 
@@ -173,10 +416,16 @@ Res<Hal::VmmRange> Space::map(Hal::VmmRange vrange, Strong<VNode> vmo, usize off
         _alloc.used(vrange);
     }
 
-    auto map = Map{vrange, off, std::move(vmo)};
+    auto map = Map{vrange, off, flags, std::move(vmo)};
 
-    try$(vmm().mapRange(map.vrange, {map.vmo->range().start + map.off, vrange.size}, flags | Hal::VmmFlags::USER));
-    try$(vmm().flush(map.vrange));
+    // Paged vmos are mapped page by page as they are accessed.
+    if (map.vmo->isPaged()) {
+        map.vmo->_attach({this, vrange, off, flags});
+    } else {
+        LockScope vmmScope(_vmmLock);
+        try$(vmm().mapRange(map.vrange, {map.vmo->range().start + map.off, vrange.size}, flags | Hal::VmmFlags::USER));
+        try$(vmm().flush(map.vrange));
+    }
 
     _maps.pushBack(std::move(map));
 
@@ -191,14 +440,26 @@ Res<> Space::unmap(Hal::VmmRange vrange) {
     auto id = try$(_lookup(vrange));
     auto &map = _maps[id];
 
-    try$(vmm().free(map.vrange));
-    try$(vmm().flush(map.vrange));
+    // Detached first, so the vmo doesn't map pages back in behind us.
+    if (map.vmo->isPaged())
+        map.vmo->_detach(*this, map.vrange);
+
+    {
+        LockScope vmmScope(_vmmLock);
+        try$(vmm().free(map.vrange));
+        try$(vmm().flush(map.vrange));
+    }
 
     _alloc.unused(map.vrange);
     _maps.removeAt(id);
     return Ok();
 }
 
+Hj::SpaceStat Space::stat() {
+    ObjectLockScope scope(*this);
+    return _stat;
+}
+
 void Space::activate() {
     vmm().activate();
 }
@@ -248,8 +509,9 @@ Res<Strong<Channel>> Channel::create(usize cap) {
     return Ok(makeStrong<Channel>(cap));
 }
 
-Channel::Channel(usize cap) {
-    _cap = cap;
+Channel::Channel(usize cap)
+    : _ring(cap), _cap(cap) {
+    _signals = Hj::Sigs::WRITABLE;
 }
 
 Res<> Channel::_ensureNoEmpty() {
@@ -273,31 +535,52 @@ Res<> Channel::_ensureOpen() {
     return Ok();
 }
 
-void Channel::_updateSignalsUnlock() {
-    _signalUnlock(
-        _closed ? Hj::Sigs::CLOSED : Hj::Sigs::NONE,
-        _closed ? Hj::Sigs::NONE : Hj::Sigs::CLOSED);
+void Channel::_updateSignalsUnlock(Vec<Strong<Task>> &woken) {
+    Flags<Hj::Sigs> set = Hj::Sigs::NONE;
+    Flags<Hj::Sigs> unset = Hj::Sigs::NONE;
+
+    (_ring.len() > 0 ? set : unset) |= Hj::Sigs::READABLE;
+    (_ring.len() < _cap ? set : unset) |= Hj::Sigs::WRITABLE;
+    (_closed ? set : unset) |= Hj::Sigs::CLOSED;
+
+    _signalUnlock(set, unset, woken);
 }
 
 Res<> Channel::send(Domain &dom, Hj::Msg msg) {
-    ObjectLockScope scope{*this};
-    try$(_ensureOpen());
-    try$(_ensureNoFull());
-    _ring.pushBack(try$(Parcel::fromMsg(dom, msg)));
+    Vec<Strong<Task>> woken;
+    {
+        ObjectLockScope scope{*this};
+        try$(_ensureOpen());
+        try$(_ensureNoFull());
+        _ring.pushBack(try$(Parcel::fromMsg(dom, msg)));
+        _updateSignalsUnlock(woken);
+    }
+    _wake(woken);
     return Ok();
 }
 
 Res<Hj::Msg> Channel::recv(Domain &dom) {
-    ObjectLockScope scope{*this};
-    try$(_ensureOpen());
-    try$(_ensureNoEmpty());
-    auto parcel = _ring.popBack();
-    return parcel.toMsg(dom);
+    Vec<Strong<Task>> woken;
+    Res<Hj::Msg> msg = Error::wouldBlock("channel empty");
+    {
+        ObjectLockScope scope{*this};
+        try$(_ensureOpen());
+        try$(_ensureNoEmpty());
+        msg = _ring.dequeue().toMsg(dom);
+        _updateSignalsUnlock(woken);
+    }
+    _wake(woken);
+    return msg;
 }
 
 Res<> Channel::close() {
-    ObjectLockScope scope{*this};
-    _closed = true;
+    Vec<Strong<Task>> woken;
+    {
+        ObjectLockScope scope{*this};
+        _closed = true;
+        _updateSignalsUnlock(woken);
+    }
+    _wake(woken);
     return Ok();
 }
 
@@ -307,45 +590,129 @@ Res<Strong<Listener>> Listener::create() {
     return Ok(makeStrong<Listener>());
 }
 
+Listener::~Listener() {
+    // The objects must not be left pointing at our watches. Nobody else can
+    // reach the listener anymore, the ready lock isn't needed.
+    for (auto &watch : _watches) {
+        ObjectLockScope scope{*watch->obj};
+        watch->obj->_watchers.removeAll(&*watch);
+    }
+}
+
 Res<> Listener::watch(Hj::Cap cap, Strong<Object> obj, Flags<Hj::Sigs> set, Flags<Hj::Sigs> unset) {
-    ObjectLockScope scope{*this};
-
-    for (usize i = 0; i < _listened.len(); ++i) {
-        if (_listened[i].cap == cap) {
-            auto &listened = _listened[i];
-            listened.set = set;
-            listened.unset = unset;
-
-            if (listened.set.empty() and
-                listened.unset.empty()) {
-                _listened.removeAt(i);
-                logInfo("listener: stopped listening to cap {}", cap.raw());
-                return Ok();
-            }
-        }
+    // The cap might name another object by now, start over.
+    _unwatch(cap);
+
+    if (set.empty() and unset.empty()) {
+        logInfo("listener: stopped listening to cap {}", cap.raw());
+        return Ok();
     }
 
-    _listened.pushBack(Listened{cap, obj, set, unset});
+    Vec<Strong<Task>> woken;
+    {
+        ObjectLockScope objScope{*obj};
+        auto watch = makeBox<Watch>(Watch{*this, cap, obj, set, unset});
+        obj->_watchers.pushBack(&*watch);
+        _notify(*watch, obj->_signals, woken);
+
+        LockScope scope{_readyLock};
+        _watches.pushBack(std::move(watch));
+    }
+    _wake(woken);
+
     logInfo("listener: started listening to cap {}", cap.raw());
     return Ok();
 }
 
-Slice<Hj::Event> Listener::listen() {
-    ObjectLockScope scope{*this};
-    _events.clear();
-
-    for (auto &l : _listened) {
-        auto sigs = l.obj->poll();
-        if (sigs & l.set) {
-            _events.pushBack(Hj::Event{l.cap, sigs & l.set, true});
+void Listener::_unwatch(Hj::Cap cap) {
+    Opt<Strong<Object>> obj = NONE;
+    {
+        LockScope scope{_readyLock};
+        for (auto &watch : _watches) {
+            if (watch->cap == cap) {
+                obj = watch->obj;
+                break;
+            }
         }
+    }
+
+    if (not obj)
+        return;
+
+    ObjectLockScope objScope{**obj};
+    LockScope scope{_readyLock};
+
+    for (usize i = 0; i < _watches.len(); i++) {
+        auto &watch = *_watches[i];
+        if (watch.cap != cap or watch.obj._cell != (*obj)._cell)
+            continue;
 
-        if (~sigs & l.unset) {
-            _events.pushBack(Hj::Event{l.cap, sigs & l.unset, false});
+        (*obj)->_watchers.removeAll(&watch);
+        if (watch.ready)
+            _ready.removeAll(&watch);
+        _watches.removeAt(i);
+        return;
+    }
+}
+
+void Listener::_notify(Watch &watch, Flags<Hj::Sigs> sigs, Vec<Strong<Task>> &woken) {
+    LockScope scope{_readyLock};
+
+    watch.sigs = sigs;
+    bool ready = watch.matches();
+    if (ready == watch.ready)
+        return;
+
+    watch.ready = ready;
+    if (not ready) {
+        _ready.removeAll(&watch);
+        return;
+    }
+
+    _ready.pushBack(&watch);
+    while (_waiters.len())
+        woken.pushBack(_waiters.popBack());
+}
+
+bool Listener::ready() {
+    LockScope scope{_readyLock};
+    return _ready.len() > 0;
+}
+
+bool Listener::wait(Strong<Task> task) {
+    LockScope scope{_readyLock};
+    if (_ready.len() > 0)
+        return false;
+    _waiters.pushBack(std::move(task));
+    return true;
+}
+
+void Listener::unwait(Task &task) {
+    LockScope scope{_readyLock};
+    for (usize i = 0; i < _waiters.len(); i++) {
+        if (&*_waiters[i] == &task) {
+            _waiters.removeAt(i);
+            return;
         }
     }
+}
+
+usize Listener::collect(MutSlice<Hj::Event> events) {
+    LockScope scope{_readyLock};
+
+    usize len = 0;
+    for (auto *watch : _ready) {
+        if ((watch->sigs & watch->set) and len < events.len())
+            events[len++] = {watch->cap, watch->sigs & watch->set, true};
+
+        if ((~watch->sigs & watch->unset) and len < events.len())
+            events[len++] = {watch->cap, watch->sigs & watch->unset, false};
+    }
+
+    for (usize i = len; i < events.len(); i++)
+        events[i] = {};
 
-    return _events;
+    return len;
 }
 
 /* --- Task ----------------------------------------------------------------- */
@@ -376,17 +743,18 @@ Res<> Task::block(Blocker blocker) {
     return Ok();
 }
 
-bool Task::unblock(TimeStamp now) {
+Opt<TimeStamp> Task::blockedUntil(TimeStamp now) {
     ObjectLockScope scope(*this);
 
     if (_block) {
-        if (Op::gt((*_block)(), now)) {
-            return false;
+        auto deadline = (*_block)();
+        if (Op::gt(deadline, now)) {
+            return deadline;
         }
         _block = NONE;
     }
 
-    return false;
+    return NONE;
 }
 
 void Task::crash() {
@@ -10,6 +10,8 @@
 #include <karm-base/range-alloc.h>
 #include <karm-base/rc.h>
 #include <karm-base/ring.h>
+#include <karm-base/slot-table.h>
+#include <karm-base/vec.h>
 #include <karm-fmt/case.h>
 #include <karm-logger/logger.h>
 
@@ -19,6 +21,10 @@ namespace Hjert::Core {
 
 /* --- Object --------------------------------------------------------------- */
 
+struct Task;
+
+struct Watch;
+
 struct Object : public Meta::Static {
     static Atomic<usize> _counter;
 
@@ -26,6 +32,7 @@ struct Object : public Meta::Static {
     usize _id = _counter.fetchAdd(1);
     Opt<String> _label;
     Flags<Hj::Sigs> _signals;
+    Vec<Watch *> _watchers; // Listeners to tell when the signals change
 
     virtual ~Object() = default;
 
@@ -37,7 +44,9 @@ struct Object : public Meta::Static {
 
     Str label() const;
 
-    void _signalUnlock(Flags<Hj::Sigs> set, Flags<Hj::Sigs> unset);
+    // Tasks waiting on the listeners of this object are added to `woken`,
+    // they can only be woken once the lock is released.
+    void _signalUnlock(Flags<Hj::Sigs> set, Flags<Hj::Sigs> unset, Vec<Strong<Task>> &woken);
 
     Flags<Hj::Sigs> _pollUnlock();
 
@@ -66,13 +75,20 @@ struct ObjectLockScope : public LockScope {
 /* --- Domain --------------------------------------------------------------- */
 
 struct Domain : public BaseObject<Domain, Hj::Type::DOMAIN> {
-    using Slot = Opt<Strong<Object>>;
+    // A cap is a path of hops through nested domains, each hop is the
+    // handle of a slot of the domain reached by the previous ones. Hops are
+    // kept narrow so a cap reaches five domains deep, which leaves room for
+    // 1023 slots per domain and a small generation.
+    static constexpr usize HOP_INDEX_BITS = 10;
+    static constexpr usize HOP_GEN_BITS = 2;
 
-    static constexpr usize SHIFT = 11;
-    static constexpr usize LEN = 2 << 11;
-    static constexpr usize MASK = LEN - 1;
+    using Slots = SlotTable<Strong<Object>, HOP_INDEX_BITS, HOP_GEN_BITS>;
 
-    Array<Slot, LEN> _slots;
+    static constexpr usize HOP_BITS = Slots::BITS;
+    static constexpr usize HOP_MASK = (1uz << HOP_BITS) - 1;
+    static constexpr usize MAX_HOPS = (sizeof(Hj::Arg) * 8) / HOP_BITS;
+
+    Slots _slots;
 
     static Res<Strong<Domain>> create();
 
@@ -90,25 +106,96 @@ struct Domain : public BaseObject<Domain, Hj::Type::DOMAIN> {
     }
 
     Res<> drop(Hj::Cap cap);
+
+    // The domain named by the first hop of `cap`.
+    Res<Strong<Domain>> _child(Hj::Cap cap);
+
+    // Rejects caps with bits past the last hop, they would otherwise be
+    // resolved as a shorter path.
+    static Res<> _ensurePath(Hj::Cap cap);
 };
 
 /* --- Vmo ------------------------------------------------------------------ */
 
+struct Space;
+
+// A page of a paged vmo. Clones share their frames, a frame referenced more
+// than once is copied before being written to.
+struct Frame : public RefCounted<Frame> {
+    Hal::PmmMem _mem;
+
+    Frame(Hal::PmmMem mem) : _mem(std::move(mem)) {}
+
+    Hal::PmmRange range() const { return _mem.range(); }
+
+    bool shared() { return _refs.load(ACQUIRE) > 1; }
+};
+
 struct VNode : public BaseObject<VNode, Hj::Type::VMO> {
-    using _Mem = Var<Hal::PmmMem, Hal::DmaRange>;
+    // Pages populated on the first access, empty ones read as zeros.
+    using Pages = Vec<Opt<Rc<Frame>>>;
+    using _Mem = Var<Hal::PmmMem, Hal::DmaRange, Pages>;
+
+    // Where a paged vmo is mapped, the entries of every mapping are updated
+    // when one of its pages is populated or copied.
+    struct Mapping {
+        Space *space;
+        Hal::VmmRange vrange;
+        usize off;
+        Hj::MapFlags flags;
+
+        usize vaddr(usize index) const {
+            return vrange.start + index * Hal::PAGE_SIZE - off;
+        }
+    };
+
+    // Pages around a read fault that are mapped along with it if they are
+    // already populated.
+    static constexpr usize FAULT_AROUND = 16;
+
     _Mem _mem;
+    usize _size;
+    Vec<Mapping> _mappings;
 
+    // Backed by physical memory right away, for the kernel to fill it.
     static Res<Strong<VNode>> alloc(usize size, Hj::VmoFlags);
 
+    // Backed page by page as it's accessed.
+    static Res<Strong<VNode>> create(usize size, Hj::VmoFlags);
+
     static Res<Strong<VNode>> makeDma(Hal::DmaRange prange);
 
-    VNode(_Mem mem) : _mem(std::move(mem)) {}
+    VNode(_Mem mem, usize size) : _mem(std::move(mem)), _size(size) {}
 
+    usize size() const { return _size; }
+
+    // Physical memory of a vmo that isn't paged.
     Hal::PmmRange range();
 
     bool isDma() {
         return _mem.is<Hal::DmaRange>();
     }
+
+    bool isPaged() {
+        return _mem.is<Pages>();
+    }
+
+    // A paged vmo sharing the pages of this one until either writes them.
+    Res<Strong<VNode>> clone();
+
+    void _attach(Mapping mapping);
+
+    void _detach(Space &space, Hal::VmmRange vrange);
+
+    // Maps the page at `vaddr` in `at`, populating it or breaking its
+    // sharing first if `write`. Called with the lock of the space held,
+    // which guards its counters.
+    Res<> fault(Mapping const &at, usize vaddr, bool write);
+
+    // Points every mapping of page `index` to its current frame.
+    Res<> _repoint(usize index);
+
+    void _faultAround(Mapping const &at, usize index, Hj::SpaceStat &stat);
 };
 
 /* --- Space ---------------------------------------------------------------- */
@@ -117,12 +204,18 @@ struct Space : public BaseObject<Space, Hj::Type::SPACE> {
     struct Map {
         Hal::VmmRange vrange;
         usize off;
+        Hj::MapFlags flags;
         Strong<VNode> vmo;
     };
 
     Strong<Hal::Vmm> _vmm;
     RangeAlloc<Hal::VmmRange> _alloc;
     Vec<Map> _maps;
+    Hj::SpaceStat _stat{};
+
+    // Guards the page tables. Vmos update them holding only their own lock,
+    // so no object lock can be taken while holding it.
+    Lock _vmmLock;
 
     static Res<Strong<Space>> create();
 
@@ -130,22 +223,35 @@ struct Space : public BaseObject<Space, Hj::Type::SPACE> {
 
     ~Space() override;
 
+    Hal::Vmm &vmm() { return *_vmm; }
+
     Res<usize> _lookup(Hal::VmmRange vrange);
 
-    Res<> _validate(Hal::VmmRange vrange) {
-        for (auto &map : _maps) {
-            if (map.vrange.contains(vrange)) {
-                return Ok();
-            }
-        }
+    Map *_find(Hal::VmmRange vrange);
 
-        return Error::invalidInput("bad address");
-    }
+    // Checks `vrange` is mapped and populates its pages, so the kernel can
+    // access it without faulting.
+    Res<> _validate(Hal::VmmRange vrange, bool write = false);
+
+    Res<> _fault(Map &map, usize vaddr, bool write);
+
+    // Serves a page fault of a task running in this space, fails if the
+    // access isn't allowed.
+    Res<> fault(usize vaddr, bool write);
+
+    // Same as fault(), for faults taken while the lock is already held.
+    Res<> _faultUnlock(usize vaddr, bool write);
+
+    Res<> _mapPage(usize vaddr, Hal::PmmRange frame, Hj::MapFlags flags);
+
+    Res<> _flush(Hal::VmmRange vrange);
 
     Res<Hal::VmmRange> map(Hal::VmmRange vrange, Strong<VNode> vmo, usize off, Hj::MapFlags flags);
 
     Res<> unmap(Hal::VmmRange vrange);
 
+    Hj::SpaceStat stat();
+
     void activate();
 };
 
@@ -179,7 +285,7 @@ struct Channel :
 
     Res<> _ensureOpen();
 
-    void _updateSignalsUnlock();
+    void _updateSignalsUnlock(Vec<Strong<Task>> &woken);
 
     Res<> send(Domain &dom, Hj::Msg msg);
 
@@ -190,29 +296,60 @@ struct Channel :
 
 /* --- Listener ------------------------------------------------------------- */
 
+struct Listener;
+
+// An object watched by a listener, linked from both so signaling the object
+// only touches the listeners that care about it.
+struct Watch {
+    Listener &listener;
+    Hj::Cap cap;
+    Strong<Object> obj;
+
+    Flags<Hj::Sigs> set;
+    Flags<Hj::Sigs> unset;
+
+    Flags<Hj::Sigs> sigs{}; // Signals of the object when it last changed
+    bool ready = false;     // In the ready queue of the listener
+
+    bool matches() const {
+        return (sigs & set) or (~sigs & unset);
+    }
+};
+
 struct Listener :
     public BaseObject<Listener, Hj::Type::LISTENER> {
 
-    struct Listened {
-        Hj::Cap cap;
-        Strong<Object> obj;
-
-        Flags<Hj::Sigs> set;
-        Flags<Hj::Sigs> unset;
-    };
+    // Guards everything below. It's taken with the lock of a watched object
+    // held, so no other lock can be taken while holding it.
+    Lock _readyLock;
 
-    Vec<Listened> _listened;
-    Vec<Hj::Event> _events;
+    Vec<Box<Watch>> _watches;
+    Vec<Watch *> _ready;
+    Vec<Strong<Task>> _waiters;
 
     static Res<Strong<Listener>> create();
 
+    ~Listener() override;
+
     Res<> watch(Hj::Cap cap, Strong<Object> obj, Flags<Hj::Sigs> set, Flags<Hj::Sigs> unset);
 
-    Slice<Hj::Event> listen();
+    void _unwatch(Hj::Cap cap);
 
-    Slice<Hj::Event> events() {
-        return _events;
-    }
+    // Called by the watched object with its lock held.
+    void _notify(Watch &watch, Flags<Hj::Sigs> sigs, Vec<Strong<Task>> &woken);
+
+    // Whether a watched object is in a state it's watched for.
+    bool ready();
+
+    // Has `task` woken once a watched object gets in a state it's watched
+    // for, returns false without registering it if one already is.
+    bool wait(Strong<Task> task);
+
+    void unwait(Task &task);
+
+    // Fills `events` with the objects ready so far, the entries left are
+    // cleared. Returns how many were filled.
+    usize collect(MutSlice<Hj::Event> events);
 };
 
 /* --- Task ----------------------------------------------------------------- */
@@ -228,6 +365,9 @@ using Blocker = Func<TimeStamp()>;
 struct Task :
     public BaseObject<Task, Hj::Type::TASK> {
 
+    static constexpr usize PRIOS = 32;
+    static constexpr usize DEFAULT_PRIO = PRIOS / 2;
+
     TaskMode _mode;
     Stack _stack;
     Box<Ctx> _ctx;
@@ -236,8 +376,16 @@ struct Task :
     Opt<Strong<Domain>> _domain;
     Opt<Blocker> _block;
 
+    usize _prio = DEFAULT_PRIO;
     TimeStamp _sliceEnd = 0;
 
+    // The processor whose sleep queue holds the task, guarded by its lock.
+    static constexpr usize AWAKE = ~0uz;
+    Atomic<usize> _sleepsOn{AWAKE};
+
+    // Set by Sched::wake(), its blocker has to be looked at again.
+    Atomic<bool> _woken{};
+
     bool _hasRetUnlock() {
         return _signals.has(Hj::Sigs::EXITED) and
                _mode == TaskMode::USER;
@@ -282,6 +430,8 @@ struct Task :
 
     bool blocked() const { return _block; }
 
+    usize prio() const { return _prio; }
+
     void saveCtx(usize sp) {
         _stack.saveSp(sp);
         _ctx->save();
@@ -297,7 +447,9 @@ struct Task :
 
     Res<> block(Blocker blocker);
 
-    bool unblock(TimeStamp now);
+    // Evaluates the blocker, returns NONE and clears it once the task can
+    // run again, or the deadline at which it should be looked at again.
+    Opt<TimeStamp> blockedUntil(TimeStamp now);
 
     void crash();
 
@@ -1,54 +1,245 @@
 #include <karm-logger/logger.h>
 
 #include "arch.h"
+#include "cpu.h"
 #include "mem.h"
 #include "sched.h"
 
 namespace Hjert::Core {
 
-static Opt<Sched> _sched;
+// Published once a processor has its scheduler, indexed by processor.
+static Array<Atomic<Sched *>, Cpu::MAX> _scheds{};
+
+static Sched *_schedOf(usize cpu) {
+    return _scheds[cpu].load(ACQUIRE);
+}
 
 Res<> Sched::init(Handover::Payload &) {
     logInfo("sched: initializing...");
-    _sched.emplace(try$(Task::create(TaskMode::SUPER, try$(Space::create()))));
+    return initCpu();
+}
+
+Res<> Sched::initCpu() {
+    auto cpu = Arch::cpu().id();
+    auto bootTask = try$(Task::create(TaskMode::SUPER, try$(Space::create())));
+    _scheds[cpu].store(new Sched(cpu, bootTask), RELEASE);
     return Ok();
 }
 
 Sched &Sched::instance() {
-    return *_sched;
+    return *_schedOf(Arch::cpu().id());
+}
+
+void Sched::wake(Strong<Task> task) {
+    // Pairs with the barrier in _enqueue(), either this sees the task in a
+    // sleep queue, or the scheduler putting it there sees it was woken.
+    task->_woken.store(true, SEQ_CST);
+    memoryBarier();
+
+    usize cpu = task->_sleepsOn.load(SEQ_CST);
+    if (cpu == Task::AWAKE)
+        return;
+
+    auto *sched = _schedOf(cpu);
+    {
+        LockScope scope{sched->_lock};
+        sched->_wakeups.pushBack(std::move(task));
+    }
+    Arch::reschedule(cpu);
+}
+
+Sched &Sched::_leastLoaded() {
+    Sched *best = this;
+    for (usize i = 0; i < Arch::cpuCount(); i++) {
+        auto *sched = _schedOf(i);
+        if (sched and sched->_load() < best->_load())
+            best = sched;
+    }
+    return *best;
 }
 
 Res<> Sched::start(Strong<Task> task, usize ip, usize sp, Hj::Args args) {
     logInfo("sched: starting task (ip: {x}, sp: {x})...", ip, sp);
 
-    LockScope scope{_lock};
     Arch::start(*task, ip, sp, args);
-    _tasks.pushBack(std::move(task));
+
+    auto &target = _leastLoaded();
+    bool wake = false;
+    {
+        LockScope scope{target._lock};
+        wake = target._isIdle();
+        auto prio = task->prio();
+        target._ready.push(prio, std::move(task));
+        target._publish();
+    }
+
+    // An idle processor has no timer armed, it wouldn't notice the task.
+    if (wake)
+        Arch::reschedule(target._cpu);
+
     return Ok();
 }
 
-void Sched::schedule(TimeSpan span) {
-    LockScope scope{_lock};
+// Puts a task that stopped running where it belongs: back in its ready
+// queue, in the sleep queue if it's blocked, or nowhere if it returned.
+void Sched::_enqueue(Strong<Task> task) {
+    if (task->hasRet()) {
+        logInfo("sched: {} has returned", *task);
+        return;
+    }
 
-    _stamp += span;
-    _curr->_sliceEnd = _stamp;
-    auto next = _idle;
+    // Wakeups from here on are seen below.
+    task->_woken.store(false, SEQ_CST);
 
-    for (usize i = 0; i < _tasks.len(); ++i) {
-        auto &t = _tasks[i];
+    if (auto deadline = task->blockedUntil(_stamp)) {
+        task->_sleepsOn.store(_cpu, SEQ_CST);
+        memoryBarier();
+        if (task->_woken.load(SEQ_CST))
+            _wakeups.pushBack(task);
+        _sleeping.push(*deadline, std::move(task));
+        return;
+    }
 
-        if (t->hasRet()) {
-            logInfo("sched: {} has returned", *t);
-            _tasks.removeAt(i--);
+    auto prio = task->prio();
+    _ready.push(prio, std::move(task));
+}
+
+// Takes a woken task out of the sleep queue and looks at its blocker again.
+void Sched::_wake(Strong<Task> task) {
+    // Woken twice, or its deadline passed in the meantime.
+    if (task->_sleepsOn.load(RELAXED) != _cpu)
+        return;
+
+    auto sleeper = _sleeping.remove([&](Strong<Task> &t) {
+        return t._cell == task._cell;
+    });
+    if (not sleeper)
+        return;
+
+    task->_sleepsOn.store(Task::AWAKE, RELAXED);
+    _enqueue(sleeper.take());
+}
+
+// Takes a ready task from the busiest other processor. Only tasks that were
+// preempted in user mode move, a task interrupted in the kernel might be
+// relying on the processor it's on.
+Opt<Strong<Task>> Sched::_steal() {
+    Sched *victim = nullptr;
+    for (usize i = 0; i < Arch::cpuCount(); i++) {
+        auto *sched = _schedOf(i);
+        if (not sched or sched == this)
             continue;
-        }
+        usize ready = sched->_readyHint.load(RELAXED);
+        if (ready and (not victim or ready > victim->_readyHint.load(RELAXED)))
+            victim = sched;
+    }
+
+    // Two processors could be stealing from each other, never wait on the
+    // lock while holding ours.
+    if (not victim or not victim->_lock.tryAcquire())
+        return NONE;
+
+    auto task = victim->_ready.steal([&](Strong<Task> &task) {
+        bool switching = victim->_prev and (*victim->_prev)._cell == task._cell;
+        return task->mode() == TaskMode::USER and not switching;
+    });
+    victim->_publish();
+
+    victim->_lock.release();
+    return task;
+}
+
+Strong<Task> Sched::_pickNext() {
+    while (auto task = _ready.pop()) {
+        // The task might have exited while it was waiting.
+        if (not (*task)->hasRet())
+            return task.take();
+        logInfo("sched: {} has returned", **task);
+    }
+
+    while (auto task = _steal()) {
+        if (not (*task)->hasRet())
+            return task.take();
+        logInfo("sched: {} has returned", **task);
+    }
+
+    return _idle;
+}
+
+// Programs the timer for the next time this processor has anything to do:
+// the end of the slice of the current task, or the earliest sleeper.
+void Sched::_arm() {
+    auto deadline = TimeStamp::endOfTime();
+    if (not _isIdle())
+        deadline = _curr->_sliceEnd;
+
+    if (auto next = _sleeping.next(); next and Op::lt(*next, deadline))
+        deadline = *next;
+
+    // A task went to sleep as it was being woken.
+    if (_wakeups.len())
+        deadline = _stamp;
 
-        if (Op::lteq(t->_sliceEnd, _stamp)) {
-            next = t;
+    // Ready tasks this processor doesn't get to soon, an idle one can take
+    // them.
+    if (_ready.len()) {
+        for (usize i = 0; i < Arch::cpuCount(); i++) {
+            auto *sched = _schedOf(i);
+            if (sched and sched != this and sched->_idleHint.load(RELAXED)) {
+                Arch::reschedule(i);
+                break;
+            }
         }
     }
 
-    _curr = next;
+    auto &event = Arch::clockEvent();
+    if (deadline.isEndOfTime())
+        event.disarm();
+    else
+        event.arm(deadline);
+}
+
+void Sched::schedule(bool yielded) {
+    LockScope scope{_lock};
+
+    // This runs on the stack of the current task, the previous switch is
+    // over.
+    _prev = NONE;
+    _stamp = Arch::clock().now();
+
+    auto wakeups = std::move(_wakeups);
+    for (auto &task : wakeups)
+        _wake(task);
+
+    while (auto task = _sleeping.popExpired(_stamp)) {
+        (*task)->_sleepsOn.store(Task::AWAKE, RELAXED);
+        _enqueue(task.take());
+    }
+
+    bool idle = _isIdle();
+    auto top = _ready.top();
+
+    // Let the current task finish its slice unless it yielded or something
+    // more important became ready.
+    if (not idle and
+        not yielded and
+        Op::lt(_stamp, _curr->_sliceEnd) and
+        (not top or *top <= _curr->prio()) and
+        _curr->runable()) {
+        _publish();
+        _arm();
+        return;
+    }
+
+    if (not idle) {
+        _prev = _curr;
+        _enqueue(std::move(_curr));
+    }
+
+    _curr = _pickNext();
+    _curr->_sliceEnd = _stamp + SLICE;
+    _publish();
+    _arm();
 }
 
 void Sched::yield() {
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <handover/spec.h>
+#include <karm-base/run-queue.h>
 #include <karm-base/time.h>
 
 #include "objects.h"
@@ -9,35 +10,92 @@ namespace Hjert::Core {
 
 /* --- Sched ---------------------------------------------------------------- */
 
+// One scheduler per processor. Tasks stay where they are put, an idle
+// processor steals ready tasks from the busiest one. There is no periodic
+// tick, the timer is armed for the end of the slice or the next sleeper.
 struct Sched {
+    static constexpr TimeSpan SLICE = TimeSpan::fromMSecs(10);
+
+    usize _cpu;
     TimeStamp _stamp{};
     Lock _lock{};
 
-    Vec<Strong<Task>> _tasks;
+    RunQueue<Strong<Task>, Task::PRIOS> _ready;
+    SleepQueue<Strong<Task>> _sleeping;
+
+    // Sleeping tasks whose blocker might now let them run.
+    Vec<Strong<Task>> _wakeups;
     Strong<Task> _curr;
     Strong<Task> _idle;
 
+    // The task switched out by the last schedule, its kernel stack is in
+    // use until the switch is over, so it can't be stolen or released
+    // before the next one.
+    Opt<Strong<Task>> _prev;
+
+    // Copies of the length of `_ready` and of whether the processor is
+    // idle, published under the lock for the other processors, which read
+    // them without it to place and steal tasks.
+    Atomic<usize> _readyHint{};
+    Atomic<bool> _idleHint{true};
+
     static Res<> init(Handover::Payload &);
 
+    // Sets up the scheduler of the processor running it.
+    static Res<> initCpu();
+
     static Sched &instance();
 
     static Lock &lock() {
         return instance()._lock;
     }
 
-    Sched(Strong<Task> bootTask)
-        : _tasks{bootTask},
+    // Has the scheduler of a sleeping task look at its blocker again. Must
+    // not be called with the lock of an object held.
+    static void wake(Strong<Task> task);
+
+    Sched(usize cpu, Strong<Task> bootTask)
+        : _cpu(cpu),
           _curr(bootTask),
           _idle(bootTask) {
     }
 
+    bool _isIdle() const {
+        return _curr._cell == _idle._cell;
+    }
+
+    // Must be called with the lock held, after `_ready` or `_curr` changed.
+    void _publish() {
+        _readyHint.store(_ready.len(), RELAXED);
+        _idleHint.store(_isIdle(), RELAXED);
+    }
+
+    // Tasks running or waiting to run, only a hint.
+    usize _load() {
+        return _readyHint.load(RELAXED) + (_idleHint.load(RELAXED) ? 0 : 1);
+    }
+
     Res<> start(Strong<Task> task, usize ip, Hj::Args args) {
         return start(task, ip, task->stack().loadSp(), args);
     }
 
     Res<> start(Strong<Task> task, usize ip, usize sp, Hj::Args args);
 
-    void schedule(TimeSpan span);
+    Sched &_leastLoaded();
+
+    void _enqueue(Strong<Task> task);
+
+    void _wake(Strong<Task> task);
+
+    Opt<Strong<Task>> _steal();
+
+    Strong<Task> _pickNext();
+
+    void _arm();
+
+    // Called from the timer and from interrupts that might wake a task,
+    // `yielded` when the current task gave up the rest of its slice.
+    void schedule(bool yielded);
 
     void yield();
 };
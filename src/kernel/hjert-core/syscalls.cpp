@@ -52,7 +52,7 @@ Res<> doCreate(Task &self, Hj::Cap dest, User<Hj::Cap> cap, User<Hj::Props> p) {
                 bool isDma = (props.flags & Hj::VmoFlags::DMA) == Hj::VmoFlags::DMA;
                 return Ok(try$(isDma
                                    ? VNode::makeDma({props.phys, props.len})
-                                   : VNode::alloc(props.len, props.flags)));
+                                   : VNode::create(props.len, props.flags)));
             },
             [&](Hj::IoProps &props) -> Res<Strong<Object>> {
                 return Ok(try$(IoNode::create({props.base, props.len})));
@@ -175,26 +175,40 @@ Res<> doWatch(Task &self, Hj::Cap cap, Hj::Cap target, Flags<Hj::Sigs> set, Flag
 Res<> doListen(Task &self, Hj::Cap cap, UserSlice<Hj::Event> events, TimeStamp deadline) {
     auto obj = try$(self.domain().get<Listener>(cap));
 
-    try$(self.block([&]() {
-        auto events = obj->listen();
+    if (obj->wait(Sched::instance()._curr)) {
+        try$(self.block([&]() {
+            if (obj->ready()) {
+                return TimeStamp::epoch();
+            }
 
-        if (events.len() > 0) {
-            return TimeStamp::epoch();
-        }
+            return deadline;
+        }));
 
-        return deadline;
-    }));
+        // Still there if the deadline passed first.
+        obj->unwait(self);
+    }
 
     try$(events.with<MutSlice<Hj::Event>>(self.space(), [&](auto events) {
-        for (usize i = 0; i < events.len(); ++i) {
-            events[i] = obj->listen()[i];
-        }
+        obj->collect(events);
         return Ok();
     }));
 
     return Ok();
 }
 
+Res<> doClone(Task &self, Hj::Cap node, User<Hj::Cap> dst, Hj::Cap src) {
+    auto obj = try$(self.domain().get<VNode>(src));
+    auto clone = try$(obj->clone());
+    return dst.store(self.space(), try$(self.domain().add(node, clone)));
+}
+
+Res<> doStat(Task &self, Hj::Cap cap, User<Hj::SpaceStat> stat) {
+    auto obj = cap.isRoot()
+                   ? try$(self._space)
+                   : try$(self.domain().get<Space>(cap));
+    return stat.store(self.space(), obj->stat());
+}
+
 Res<> dispatchSyscall(Task &self, Hj::Syscall id, Hj::Args args) {
     switch (id) {
     case Hj::Syscall::LOG:
@@ -245,6 +259,12 @@ Res<> dispatchSyscall(Task &self, Hj::Syscall id, Hj::Args args) {
     case Hj::Syscall::LISTEN:
         return doListen(self, args[0], {args[1], args[2]}, args[3]);
 
+    case Hj::Syscall::CLONE:
+        return doClone(self, args[0], args[1], args[2]);
+
+    case Hj::Syscall::STAT:
+        return doStat(self, args[0], args[1]);
+
     default:
         return Error::invalidInput("invalid syscall id");
     }
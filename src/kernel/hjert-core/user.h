@@ -1,9 +1,27 @@
 #pragma once
 
+#include "cpu.h"
 #include "objects.h"
 
 namespace Hjert::Core {
 
+// Locks the space for the duration of an access to its user memory. Pages
+// can still fault, a write to a page shared since it was validated for
+// example, the fault handler finds the space, already locked, on the cpu.
+// Interrupts are held off by the lock, so the task can't move to another one.
+struct UserAccessScope : public ObjectLockScope {
+    Space *_prev;
+
+    UserAccessScope(Space &space)
+        : ObjectLockScope(space),
+          _prev(std::exchange(Arch::cpu()._userAccess, &space)) {
+    }
+
+    ~UserAccessScope() {
+        Arch::cpu()._userAccess = _prev;
+    }
+};
+
 template <typename T>
 struct User {
     usize _addr;
@@ -21,7 +39,7 @@ struct User {
             return Error::invalidInput("null pointer");
         }
 
-        ObjectLockScope scope(space);
+        UserAccessScope scope(space);
         try$(space._validate(vrange()));
         return Ok(*reinterpret_cast<T *>(_addr));
     }
@@ -31,8 +49,8 @@ struct User {
             return Error::invalidInput("null pointer");
         }
 
-        ObjectLockScope scope(space);
-        try$(space._validate(vrange()));
+        UserAccessScope scope(space);
+        try$(space._validate(vrange(), true));
         *reinterpret_cast<T *>(_addr) = val;
         return Ok();
     }
@@ -62,8 +80,10 @@ struct UserSlice {
             return Error::invalidInput("null pointer");
         }
 
-        ObjectLockScope scope(space);
-        try$(space._validate(vrange()));
+        // A mutable slice is written through, its pages are made private to
+        // the space first.
+        UserAccessScope scope(space);
+        try$(space._validate(vrange(), not Meta::Const<T>));
         return f(R{reinterpret_cast<T *>(_addr), _len});
     }
 };
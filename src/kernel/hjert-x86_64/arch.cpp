@@ -1,3 +1,4 @@
+#include <acpi/spec.h>
 #include <hjert-core/arch.h>
 #include <hjert-core/cpu.h>
 #include <hjert-core/mem.h>
@@ -6,17 +7,21 @@
 #include <karm-logger/logger.h>
 #include <karm-text/witty.h>
 
+#include <hal-x86_64/apic.h>
 #include <hal-x86_64/com.h>
 #include <hal-x86_64/cpuid.h>
 #include <hal-x86_64/gdt.h>
+#include <hal-x86_64/hpet.h>
 #include <hal-x86_64/idt.h>
 #include <hal-x86_64/pic.h>
 #include <hal-x86_64/pit.h>
 #include <hal-x86_64/simd.h>
 #include <hal-x86_64/sys.h>
+#include <hal-x86_64/tsc.h>
 #include <hal-x86_64/vmm.h>
 
 #include "ints.h"
+#include "smp.h"
 
 namespace Hjert::Arch {
 
@@ -24,73 +29,238 @@ static x86_64::Com _com1 = x86_64::Com::com1();
 
 static x86_64::DualPic _pic = x86_64::DualPic::dualPic();
 static x86_64::Pit _pit = x86_64::Pit::pit();
-
-static Array<Byte, Hal::PAGE_SIZE> _kstackRsp{};
-static Array<Byte, Hal::PAGE_SIZE> _kstackIst{};
-static x86_64::Tss _tss{};
-
-static x86_64::Gdt _gdt{_tss};
-static x86_64::GdtDesc _gdtDesc{_gdt};
+static x86_64::Lapic _lapic{};
 
 static x86_64::Idt _idt{};
 static x86_64::IdtDesc _idtDesc{_idt};
 
-Res<> init(Handover::Payload &) {
+// Vectors above the range of the legacy pic, raised by the local apics.
+static constexpr usize TIMER_VECTOR = 0xE0;
+static constexpr usize RESCHED_VECTOR = 0xE1;
+static constexpr usize SHOOTDOWN_VECTOR = 0xE2;
+static constexpr usize SPURIOUS_VECTOR = 0xFF;
+
+// Raised by simd instructions while cr0.ts is set.
+static constexpr usize DEVICE_NOT_AVAILABLE = 7;
+
+// Raised by accesses to pages that are missing or read-only, cr2 holds the
+// address. The error code tells which of the two and the kind of access.
+static constexpr usize PAGE_FAULT = 14;
+static constexpr usize PF_PRESENT = 1 << 0;
+static constexpr usize PF_WRITE = 1 << 1;
+
+static void _serviceShootdown();
+
+static void _serviceSimdTrap();
+
+// Pages of the space are populated and unshared on demand, reads of pages
+// already mapped can't be served that way. The kernel faults on user pages
+// too, when it writes to a page a clone has just shared for example, it
+// holds the lock of the space then.
+static bool _servicePageFault(usize err, bool user) {
+    usize vaddr = x86_64::rdcr2();
+    bool write = err & PF_WRITE;
+    if ((err & PF_PRESENT) and not write)
+        return false;
+
+    if (user)
+        return (bool)Core::Task::self().space().fault(vaddr, write);
+
+    auto *space = cpu()._userAccess;
+    if (not space or vaddr >= Hal::UPPER_HALF)
+        return false;
+    return (bool)space->_faultUnlock(vaddr, write);
+}
 
-    _com1.init();
+// Set on the bootstrap processor, before any other one starts.
+static bool _pcids = false;
+static bool _invpcid = false;
 
-    _gdtDesc.load();
-    _tss = {};
-    _tss._rsp[0] = (u64)_kstackRsp.bytes().end();
-    _tss._ist[0] = (u64)_kstackIst.bytes().end();
-    x86_64::_tssUpdate();
+/* --- Cpu ------------------------------------------------------------------ */
 
-    for (usize i = 0; i < x86_64::Idt::LEN; i++) {
-        _idt.entries[i] = x86_64::IdtEntry{_intVec[i], 0, x86_64::IdtEntry::GATE};
+struct Ctx;
+
+struct Cpu : public Core::Cpu {
+    u8 _lapicId = 0;
+    Atomic<bool> _online{};
+    Atomic<bool> _shootdown{}; // A TLB shootdown is waiting on this cpu
+    u64 _pcidGen = 0;          // Generation of the pcids in the TLB
+    Ctx *_ctx = nullptr;       // Context of the running task
+    Ctx *_simdOwner = nullptr; // Context whose simd state is in the registers
+    bool _simdTrapped = false; // The next simd instruction traps
+
+    Array<Byte, Hal::PAGE_SIZE> _kstackRsp{};
+    Array<Byte, Hal::PAGE_SIZE> _kstackIst{};
+    x86_64::Tss _tss{};
+
+    x86_64::Gdt _gdt{_tss};
+    x86_64::GdtDesc _gdtDesc{_gdt};
+
+    void load() {
+        _gdtDesc.load();
+        _tss = {};
+        _tss._rsp[0] = (u64)_kstackRsp.bytes().end();
+        _tss._ist[0] = (u64)_kstackIst.bytes().end();
+        x86_64::_tssUpdate();
+
+        _idtDesc.load();
+
+        x86_64::simdInit();
+        x86_64::sysInit(_sysHandler);
+
+        // Read-only pages are read-only for the kernel too, copy-on-write
+        // relies on writes to shared frames faulting.
+        x86_64::wrcr0(x86_64::rdcr0() | x86_64::CR0_WRITE_PROTECT_ENABLE);
+
+        // Kernel mappings are global, they stay in the TLB across spaces.
+        if (x86_64::Cpuid::hasGlobalPages())
+            x86_64::wrcr4(x86_64::rdcr4() | x86_64::CR4_PAGE_GLOBAL_ENABLE);
+        if (_pcids)
+            x86_64::wrcr4(x86_64::rdcr4() | x86_64::CR4_PCID_ENABLE);
     }
 
-    _idtDesc.load();
+    void enableInterrupts() override {
+        x86_64::sti();
+    }
 
-    _pic.init();
-    _pit.init(1000);
+    void disableInterrupts() override {
+        x86_64::cli();
+    }
 
-    x86_64::simdInit();
-    x86_64::sysInit(_sysHandler);
+    void relaxe() override {
+        x86_64::hlt();
+    }
 
-    return Ok();
+    void pause() override {
+        // The lock might be held by a processor waiting for this one to
+        // flush its TLB, with interrupts disabled the IPI never arrives.
+        _serviceShootdown();
+        x86_64::pause();
+    }
+};
+
+static Cpu _bsp{};
+static Array<Cpu *, Core::Cpu::MAX> _cpus{&_bsp};
+static Array<Cpu *, 256> _byLapicId{};
+static Atomic<usize> _cpuCount{1};
+
+static Cpu &_self() {
+    // Until the local apic is up, only the bootstrap processor is running.
+    if (not _lapic.present())
+        return _bsp;
+    return *_byLapicId[_lapic.id()];
 }
 
-Io::TextWriter &loggerOut() {
-    return _com1;
+Core::Cpu &cpu() {
+    return _self();
 }
 
-void stopAll() {
-    while (true) {
-        x86_64::cli();
-        x86_64::hlt();
+usize cpuCount() {
+    return _cpuCount.load(RELAXED);
+}
+
+Core::Cpu *cpu(usize id) {
+    return _cpus[id];
+}
+
+void reschedule(usize cpu) {
+    Core::InterruptRetainer retainer;
+
+    // Without a local apic there is no one else to interrupt.
+    if (_cpus[cpu] == &_self()) {
+        clockEvent().arm(TimeStamp::epoch());
+        return;
     }
+
+    _lapic.sendIpi(_cpus[cpu]->_lapicId, RESCHED_VECTOR);
 }
 
-/* --- Cpu ------------------------------------------------------------------ */
+/* --- TLB Shootdown -------------------------------------------------------- */
 
-struct Cpu : public Core::Cpu {
-    void enableInterrupts() override {
-        x86_64::sti();
+struct ManagedVmm;
+
+static void _flushLocal(ManagedVmm &vmm, Hal::VmmRange range);
+
+static Lock _shootdownLock{};
+static ManagedVmm *_shootdownVmm = nullptr;
+static Hal::VmmRange _shootdownRange{};
+static Atomic<usize> _shootdownPending{};
+
+static void _serviceShootdown() {
+    if (_cpuCount.load(RELAXED) == 1)
+        return;
+
+    auto &self = _self();
+    if (not self._shootdown.xchg(false, ACQUIRE))
+        return;
+
+    _flushLocal(*_shootdownVmm, _shootdownRange);
+    _shootdownPending.dec(RELEASE);
+}
+
+// Makes the other processors drop their entries for `range` in `vmm`, and
+// waits for all of them to be done.
+static void _shootdown(ManagedVmm &vmm, Hal::VmmRange range) {
+    if (_cpuCount.load(RELAXED) == 1)
+        return;
+
+    LockScope scope{_shootdownLock};
+    auto &self = _self();
+
+    _shootdownVmm = &vmm;
+    _shootdownRange = range;
+
+    u64 targets = 0;
+    usize count = _cpuCount.load(ACQUIRE);
+    for (usize i = 0; i < count; i++) {
+        if (_cpus[i] != &self and _cpus[i]->_online.load(ACQUIRE))
+            targets |= 1uLL << i;
     }
 
-    void disableInterrupts() override {
-        x86_64::cli();
+    _shootdownPending.store(__builtin_popcountll(targets), RELEASE);
+
+    for (usize i = 0; i < count; i++) {
+        if (not(targets & (1uLL << i)))
+            continue;
+        _cpus[i]->_shootdown.store(true, RELEASE);
+        _lapic.sendIpi(_cpus[i]->_lapicId, SHOOTDOWN_VECTOR);
     }
 
-    void relaxe() override {
-        x86_64::hlt();
+    while (_shootdownPending.load(ACQUIRE))
+        x86_64::pause();
+}
+
+/* --- Init ----------------------------------------------------------------- */
+
+Res<> init(Handover::Payload &) {
+
+    _com1.init();
+
+    for (usize i = 0; i < x86_64::Idt::LEN; i++) {
+        _idt.entries[i] = x86_64::IdtEntry{_intVec[i], 0, x86_64::IdtEntry::GATE};
     }
-};
 
-static Cpu _cpu{};
+    // Flushing every pcid at once relies on toggling global pages.
+    _pcids = x86_64::Cpuid::hasPcid() and x86_64::Cpuid::hasGlobalPages();
+    _invpcid = _pcids and x86_64::Cpuid::hasInvpcid();
+    logInfo("x86_64: pcids {}, invpcid {}", _pcids ? "enabled" : "disabled", _invpcid ? "enabled" : "disabled");
 
-Core::Cpu &cpu() {
-    return _cpu;
+    _bsp.load();
+
+    _pic.init();
+
+    return Ok();
+}
+
+Io::TextWriter &loggerOut() {
+    return _com1;
+}
+
+void stopAll() {
+    while (true) {
+        x86_64::cli();
+        x86_64::hlt();
+    }
 }
 
 /* --- Interrupts ----------------------------------------------------------- */
@@ -145,9 +315,9 @@ void backtrace(usize rbp) {
 
 auto const *CLOSE_LINE = "-----------------------------------------------------------";
 
-usize switchTask(TimeSpan span, usize sp) {
+usize switchTask(bool yielded, usize sp) {
     Core::Task::self().saveCtx(sp);
-    Core::Sched::instance().schedule(span);
+    Core::Sched::instance().schedule(yielded);
     return Core::Task::self().loadCtx();
 }
 
@@ -156,12 +326,18 @@ extern "C" usize _intDispatch(usize sp) {
 
     cpu().beginInterrupt();
 
-    if (frame->intNo < 32) {
-        if (frame->cs == (x86_64::Gdt::UCODE * 8 | 3)) {
+    bool user = frame->cs == (x86_64::Gdt::UCODE * 8 | 3);
+
+    if (frame->intNo == DEVICE_NOT_AVAILABLE and user) {
+        _serviceSimdTrap();
+    } else if (frame->intNo == PAGE_FAULT and _servicePageFault(frame->errNo, user)) {
+        // The page is mapped now, the access is retried.
+    } else if (frame->intNo < 32) {
+        if (user) {
             logPrint("userspace fault:'{}'", _faultMsg[frame->intNo]);
             logPrint("int={} err={} rip={p} rsp={p} cr2={p} cr3={p}", frame->intNo, frame->errNo, frame->rip, frame->rsp, x86_64::rdcr2(), x86_64::rdcr3());
             Core::Task::self().crash();
-            sp = switchTask(TimeSpan::fromMSecs(0), sp);
+            sp = switchTask(true, sp);
         } else {
             logPrint("{}--- {} {}----------------------------------------------------", Cli::style(Cli::YELLOW_LIGHT), Cli::styled("!!!", Cli::Style(Cli::Color::RED).bold()), Cli::style(Cli::YELLOW_LIGHT));
             logPrint("");
@@ -186,12 +362,23 @@ extern "C" usize _intDispatch(usize sp) {
             panic("cpu exception");
         }
     } else if (frame->intNo == 100) {
-        sp = switchTask(TimeSpan::fromMSecs(0), sp);
+        sp = switchTask(true, sp);
+    } else if (frame->intNo == TIMER_VECTOR) {
+        sp = switchTask(false, sp);
+        _lapic.eoi();
+    } else if (frame->intNo == RESCHED_VECTOR) {
+        sp = switchTask(false, sp);
+        _lapic.eoi();
+    } else if (frame->intNo == SHOOTDOWN_VECTOR) {
+        _serviceShootdown();
+        _lapic.eoi();
+    } else if (frame->intNo == SPURIOUS_VECTOR) {
+        // Spurious interrupts must not be acknowledged.
     } else {
         isize irq = frame->intNo - 32;
 
         if (irq == 0) {
-            sp = switchTask(TimeSpan::fromMSecs(1), sp);
+            sp = switchTask(false, sp);
         } else {
             logInfo("x86_64: irq: {}", irq);
         }
@@ -234,6 +421,315 @@ Hal::Vmm &vmm() {
     return *_vmm;
 }
 
+/* --- Acpi ----------------------------------------------------------------- */
+
+template <typename T>
+static T const *_findSdt(Handover::Payload &payload, Str signature) {
+    auto const *record = payload.findTag(Handover::RSDP);
+    if (not record)
+        return nullptr;
+
+    auto const *rsdp = reinterpret_cast<Acpi::Rsdp const *>(record->start + Hal::UPPER_HALF);
+    auto const *rsdt = reinterpret_cast<Acpi::Rsdt const *>(rsdp->rsdt + Hal::UPPER_HALF);
+    usize len = (rsdt->len - sizeof(Acpi::Sdth)) / sizeof(u32);
+
+    for (usize i = 0; i < len; i++) {
+        auto const *sdt = reinterpret_cast<Acpi::Sdth const *>(rsdt->children[i] + Hal::UPPER_HALF);
+        if (Op::eq(Str{sdt->signature.buf(), 4}, signature))
+            return static_cast<T const *>(sdt);
+    }
+
+    return nullptr;
+}
+
+static Acpi::Madt const *_findMadt(Handover::Payload &payload) {
+    return _findSdt<Acpi::Madt>(payload, "APIC");
+}
+
+/* --- Time ----------------------------------------------------------------- */
+
+// Timer deadlines further away than this fire early, the scheduler arms the
+// timer again when they do.
+static constexpr usize MAX_TIMER_US = 1000000;
+
+static x86_64::Tsc _tsc{};
+static Opt<x86_64::Hpet> _hpet = NONE;
+static Hal::Clock *_clock = &_tsc;
+
+static bool _tscDeadline = false;
+static u64 _lapicTicksPerMs = 0;
+
+Hal::Clock &clock() {
+    return *_clock;
+}
+
+static usize _usUntil(TimeStamp deadline) {
+    auto now = _clock->now();
+    if (not Op::gt(deadline, now))
+        return 0;
+    return min((deadline - now).val(), MAX_TIMER_US);
+}
+
+// Spins on the clock, interrupts are not needed.
+static void _delay(TimeSpan span) {
+    auto end = _clock->now() + span;
+    while (Op::lt(_clock->now(), end))
+        x86_64::pause();
+}
+
+// Spins for 10ms on the most precise reference there is, before the clock
+// can be used.
+static void _calibrationDelay() {
+    if (_hpet)
+        _hpet->wait(10000);
+    else
+        _pit.wait(x86_64::Pit::FREQ / 100);
+}
+
+struct LapicTimer : public Hal::ClockEvent {
+    void arm(TimeStamp deadline) override {
+        if (_tscDeadline) {
+            // A deadline in the past fires right away, zero would disarm.
+            _lapic.timerArmDeadline(max(_tsc.ticksAt(deadline), 1uLL));
+            return;
+        }
+
+        u64 ticks = _usUntil(deadline) * _lapicTicksPerMs / 1000;
+        _lapic.timerArm(clamp(ticks, 1uLL, (u64)~0u));
+    }
+
+    void disarm() override {
+        if (_tscDeadline)
+            _lapic.timerArmDeadline(0);
+        else
+            _lapic.timerArm(0);
+    }
+};
+
+// Only used when there is no local apic, so a single processor.
+struct PitTimer : public Hal::ClockEvent {
+    void arm(TimeStamp deadline) override {
+        u64 ticks = _usUntil(deadline) * x86_64::Pit::FREQ / 1000000;
+        _pit.oneShot(clamp(ticks, 1uLL, 0xFFFFuLL));
+    }
+
+    void disarm() override {
+        _pit.stop();
+    }
+};
+
+static LapicTimer _lapicTimer{};
+static PitTimer _pitTimer{};
+
+Hal::ClockEvent &clockEvent() {
+    if (_lapic.present())
+        return _lapicTimer;
+    return _pitTimer;
+}
+
+// The timer registers of each processor are its own, they have to be set
+// up on all of them.
+static void _setupLapicTimer() {
+    if (_tscDeadline)
+        _lapic.timerDeadline(TIMER_VECTOR);
+    else
+        _lapic.timerOneShot(TIMER_VECTOR);
+    _lapicTimer.disarm();
+}
+
+Res<> initTime(Handover::Payload &payload) {
+    if (auto const *hpet = _findSdt<Acpi::Hpet>(payload, "HPET")) {
+        _hpet = x86_64::Hpet::at(hpet->address + Hal::UPPER_HALF);
+        _hpet->enable();
+        logInfo("x86_64: time: hpet at {} hz", _hpet->freq());
+    }
+
+    if (auto const *madt = _findMadt(payload)) {
+        _lapic = x86_64::Lapic::at(madt->lapic + Hal::UPPER_HALF);
+        _bsp._lapicId = _lapic.id();
+        _byLapicId[_bsp._lapicId] = &_bsp;
+        _lapic.enable(SPURIOUS_VECTOR);
+    }
+
+    // Both the tsc and the local apic timer run at a rate that has to be
+    // measured, against the hpet if there is one, or else the pit.
+    if (_lapic.present())
+        _lapic.timerStart();
+    u64 start = x86_64::rdtsc();
+    _calibrationDelay();
+    u64 tscFreq = (x86_64::rdtsc() - start) * 100;
+    if (_lapic.present()) {
+        _lapicTicksPerMs = _lapic.timerElapsed() / 10;
+        _lapic.timerStop();
+    }
+
+    _tsc = x86_64::Tsc::calibrated(tscFreq);
+    logInfo("x86_64: time: tsc at {} hz", _tsc.freq());
+
+    // The tsc is cheap to read, but without the invariant tsc it changes
+    // pace with the frequency of the processor.
+    bool invariant = x86_64::Cpuid::hasInvariantTsc();
+    if (not invariant and _hpet and _hpet->is64Bit()) {
+        _clock = &*_hpet;
+        logInfo("x86_64: time: tsc is not invariant, using the hpet");
+    } else if (not invariant) {
+        logWarn("x86_64: time: tsc is not invariant, time might drift");
+    }
+
+    if (_lapic.present()) {
+        _tscDeadline = invariant and x86_64::Cpuid::hasTscDeadline();
+        logInfo("x86_64: time: lapic timer in {} mode", _tscDeadline ? "tsc-deadline" : "one-shot");
+        _setupLapicTimer();
+    } else {
+        logInfo("x86_64: time: no lapic, using the pit timer");
+        _pitTimer.disarm();
+    }
+
+    return Ok();
+}
+
+/* --- Smp ------------------------------------------------------------------ */
+
+static constexpr usize SMP_STACK = kib(16);
+
+static void (*_cpuEntry)() = nullptr;
+
+[[noreturn]] static void _smpEntry(Cpu *self) {
+    vmm().activate();
+    self->load();
+
+    _lapic.enable(SPURIOUS_VECTOR);
+    _setupLapicTimer();
+
+    self->_online.store(true, RELEASE);
+    _cpuEntry();
+    panic("smp: cpu entry returned");
+}
+
+// The trampoline page is followed by the page tables it runs on: the kernel
+// half of the kernel space, and an identity mapping of the first 2MiB for
+// the trampoline itself.
+static Res<Hal::PmmRange> _setupTrampoline() {
+    auto range = try$(Core::pmm().allocRange(4 * Hal::PAGE_SIZE, Hal::PmmFlags::LOWER));
+    if (range.end() > mib(1)) {
+        try$(Core::pmm().free(range));
+        return Error::outOfMemory("no memory below 1MiB for the smp trampoline");
+    }
+
+    auto *base = reinterpret_cast<u8 *>(range.start + Hal::UPPER_HALF);
+    zeroFill(MutBytes{base, range.size});
+    copy(Bytes{_smpTrampoline, _smpTrampolineEnd}, MutBytes{base, Hal::PAGE_SIZE});
+
+    auto *pml4 = reinterpret_cast<x86_64::Pml<4> *>(base + Hal::PAGE_SIZE);
+    auto *pml3 = reinterpret_cast<x86_64::Pml<3> *>(base + 2 * Hal::PAGE_SIZE);
+    auto *pml2 = reinterpret_cast<x86_64::Pml<2> *>(base + 3 * Hal::PAGE_SIZE);
+    auto flags = x86_64::Entry::PRESENT | x86_64::Entry::WRITE;
+
+    for (usize i = _pml4->LEN / 2; i < _pml4->LEN; i++)
+        pml4->pages[i] = _pml4->pages[i];
+    pml4->pages[0] = {range.start + 2 * Hal::PAGE_SIZE, flags};
+    pml3->pages[0] = {range.start + 3 * Hal::PAGE_SIZE, flags};
+    pml2->pages[0] = {0, flags | x86_64::Entry::HUGE_PAGE};
+
+    auto &params = *reinterpret_cast<SmpParams *>(base + (reinterpret_cast<u8 *>(&_smpParams) - _smpTrampoline));
+    params.cr3 = range.start + Hal::PAGE_SIZE;
+    params.efer = x86_64::rdmsr(x86_64::Msrs::EFER) & ((1 << 0) | (1 << 8) | (1 << 11)); // sce, lme, nxe
+    params.entry = reinterpret_cast<usize>(_smpEntry);
+
+    return Ok(range);
+}
+
+static Res<> _startCpu(Hal::PmmRange trampoline, u8 lapicId) {
+    auto stack = try$(Core::kmm().allocRange(SMP_STACK));
+
+    auto *cpu = new Cpu();
+    cpu->_id = _cpuCount.load(RELAXED);
+    cpu->_lapicId = lapicId;
+    _cpus[cpu->_id] = cpu;
+    _byLapicId[lapicId] = cpu;
+
+    auto *base = reinterpret_cast<u8 *>(trampoline.start + Hal::UPPER_HALF);
+    auto &params = *reinterpret_cast<SmpParams *>(base + (reinterpret_cast<u8 *>(&_smpParams) - _smpTrampoline));
+    params.stack = stack.end();
+    params.arg = reinterpret_cast<usize>(cpu);
+
+    _lapic.sendInit(lapicId);
+    _delay(TimeSpan::fromMSecs(10));
+    _lapic.sendStartup(lapicId, trampoline.start);
+
+    // Some processors miss the first startup IPI, the MP spec sends two.
+    _delay(TimeSpan::fromMSecs(1));
+    if (not cpu->_online.load(ACQUIRE))
+        _lapic.sendStartup(lapicId, trampoline.start);
+
+    for (usize i = 0; i < 100 and not cpu->_online.load(ACQUIRE); i++)
+        _delay(TimeSpan::fromMSecs(1));
+
+    if (not cpu->_online.load(ACQUIRE)) {
+        // Park it again so it can't run the trampoline of the next one.
+        _lapic.sendInit(lapicId);
+        _byLapicId[lapicId] = nullptr;
+        _cpus[cpu->_id] = nullptr;
+        return Error::timedOut("cpu did not start");
+    }
+
+    _cpuCount.inc(RELEASE);
+    return Ok();
+}
+
+// Application processors are only started on targets with the hjert-smp
+// prop, the bring-up hasn't been booted under qemu -smp yet.
+#ifdef __ck_hjert_smp__
+static constexpr bool SMP = true;
+#else
+static constexpr bool SMP = false;
+#endif
+
+Res<> startCpus(Handover::Payload &payload, void (*entry)()) {
+    if (not SMP) {
+        logInfo("x86_64: smp: disabled, running on one cpu");
+        return Ok();
+    }
+
+    auto const *madt = _findMadt(payload);
+    if (not madt or not _lapic.present()) {
+        logInfo("x86_64: smp: no madt, running on one cpu");
+        return Ok();
+    }
+
+    _cpuEntry = entry;
+    auto trampoline = try$(_setupTrampoline());
+
+    auto const *end = reinterpret_cast<u8 const *>(madt) + madt->len;
+    auto const *record = reinterpret_cast<u8 const *>(madt->records);
+    while (record < end) {
+        auto const *r = reinterpret_cast<Acpi::Madt::Record const *>(record);
+        record += r->len;
+
+        if (r->type != (u8)Acpi::Madt::Type::LAPIC)
+            continue;
+
+        auto const *l = static_cast<Acpi::Madt::LapicRecord const *>(r);
+        bool enabled = l->flags & 1;
+        if (not enabled or l->id == _bsp._lapicId)
+            continue;
+
+        if (cpuCount() == Core::Cpu::MAX) {
+            logWarn("x86_64: smp: too many cpus, ignoring the others");
+            break;
+        }
+
+        auto res = _startCpu(trampoline, l->id);
+        if (not res)
+            logError("x86_64: smp: cpu with lapic {} failed to start: {}", l->id, res.none().msg());
+    }
+
+    try$(Core::pmm().free(trampoline));
+    logInfo("x86_64: smp: {} cpus online", cpuCount());
+
+    return Ok();
+}
+
 void start(Core::Task &task, usize ip, usize sp, Hj::Args args) {
     Frame frame{
         .r8 = args[4],
@@ -260,30 +756,87 @@ void start(Core::Task &task, usize ip, usize sp, Hj::Args args) {
         .push(frame);
 }
 
+// The simd state is switched lazily: a task starts each slice with simd
+// instructions trapping, and its state is only restored on the first one.
+// A task that used simd during its slice saves it when switched out, so the
+// state never has to be fetched from another cpu, and the registers are
+// left as they are until someone else needs them.
 struct Ctx : public Core::Ctx {
     usize _ksp;
     usize _usp;
-    Array<Byte, Hal::PAGE_SIZE> simd __attribute__((aligned(16)));
+    Hal::KmmMem _simd;
+    Cpu *_simdCpu = nullptr; // Where the registers last held our state
 
-    Ctx(usize ksp) : _ksp(ksp), _usp(0) {
-        x86_64::simdInitCtx(simd.buf());
+    Ctx(usize ksp, Hal::KmmMem simd)
+        : _ksp(ksp), _usp(0), _simd(std::move(simd)) {
+        x86_64::simdInitCtx(_simd.range().mutBytes());
+    }
+
+    void *_simdBuf() {
+        return _simd.range().as<void>();
     }
 
     virtual void save() {
-        x86_64::simdSaveCtx(simd.buf());
-        x86_64::sysSetGs((usize)&_ksp);
+        auto &self = _self();
+        if (not self._simdTrapped and self._simdOwner == this)
+            x86_64::simdSaveCtx(_simdBuf());
     }
 
     virtual void load() {
-        x86_64::simdLoadCtx(simd.buf());
+        auto &self = _self();
+        self._ctx = this;
+        if (not self._simdTrapped) {
+            x86_64::simdTrap();
+            self._simdTrapped = true;
+        }
+
+        x86_64::sysSetGs((usize)&_ksp);
+
+        // Interrupts from user mode land on the kernel stack of the task,
+        // a shared one would be overwritten by the next task to run.
+        self._tss._rsp[0] = _ksp;
+    }
+
+    // Called on the first simd instruction of the slice.
+    void simdTrapped() {
+        auto &self = _self();
+        x86_64::simdUntrap();
+        self._simdTrapped = false;
+
+        // The owner saved its state when it was switched out.
+        if (self._simdOwner != this or _simdCpu != &self) {
+            x86_64::simdLoadCtx(_simdBuf());
+            self._simdOwner = this;
+            _simdCpu = &self;
+        }
     }
 };
 
+static void _serviceSimdTrap() {
+    _self()._ctx->simdTrapped();
+}
+
 Res<Box<Core::Ctx>> createCtx(usize ksp) {
-    return Ok<Box<Core::Ctx>>(makeBox<Ctx>(ksp));
+    auto simd = try$(Core::kmm().allocOwned(alignUp(x86_64::simdCtxSize(), Hal::PAGE_SIZE)));
+    return Ok<Box<Core::Ctx>>(makeBox<Ctx>(ksp, std::move(simd)));
 }
 
+/* --- Address Spaces ------------------------------------------------------- */
+
+// Each space is tagged with a pcid, so switching to it keeps the entries it
+// left in the TLB. Pcids are handed out in order, when they run out a new
+// generation starts: each cpu flushes its whole TLB the first time it sees
+// it, and spaces get a new pcid the next time they are activated.
+static constexpr u64 PCID_COUNT = 4096;
+
+static Lock _pcidLock{};
+static Atomic<u64> _pcidGen{1};
+static u64 _pcidNext = 1; // Pcid 0 is the kernel space's
+
 struct ManagedVmm : public x86_64::Vmm<Hal::UpperHalfMapper> {
+    Atomic<u64> _tag{};   // Generation and pcid, `gen * PCID_COUNT + pcid`
+    Atomic<u64> _stale{}; // Cpus that must flush the pcid before using it
+
     ManagedVmm(x86_64::Pml<4> *pml4)
         : x86_64::Vmm<Hal::UpperHalfMapper>{Core::pmm(), pml4} {}
 
@@ -294,8 +847,83 @@ struct ManagedVmm : public x86_64::Vmm<Hal::UpperHalfMapper> {
         auto range = Hal::PmmRange{_mapper.unmap((usize)_pml4), Hal::PAGE_SIZE};
         _pmm.free(range).unwrap();
     }
+
+    u64 _allocPcid() {
+        LockScope scope{_pcidLock};
+
+        u64 gen = _pcidGen.load(RELAXED);
+        u64 tag = _tag.load(RELAXED);
+        if (tag / PCID_COUNT == gen)
+            return tag;
+
+        if (_pcidNext == PCID_COUNT) {
+            _pcidGen.store(++gen, RELEASE);
+            _pcidNext = 1;
+        }
+
+        tag = gen * PCID_COUNT + _pcidNext++;
+        _tag.store(tag, RELEASE);
+        return tag;
+    }
+
+    bool active() {
+        return (x86_64::rdcr3() & x86_64::Entry::PADDR_MASK) == root();
+    }
+
+    Res<> flush(Hal::VmmRange vaddr) override {
+        _flushLocal(*this, vaddr);
+        _shootdown(*this, vaddr);
+        return Ok();
+    }
+
+    void activate() override {
+        if (not _pcids)
+            return x86_64::Vmm<Hal::UpperHalfMapper>::activate();
+
+        auto &self = _self();
+        u64 tag = _tag.load(ACQUIRE);
+        if (tag / PCID_COUNT != _pcidGen.load(ACQUIRE))
+            tag = _allocPcid();
+
+        if (self._pcidGen != tag / PCID_COUNT) {
+            x86_64::flushAll();
+            self._pcidGen = tag / PCID_COUNT;
+        }
+
+        u64 bit = 1uLL << self.id();
+        bool stale = _stale.load(ACQUIRE) & bit;
+        if (stale)
+            _stale.fetchAnd(~bit, ACQ_REL);
+
+        x86_64::wrcr3(root() | (tag % PCID_COUNT) | (stale ? 0 : x86_64::CR3_NOFLUSH));
+    }
 };
 
+// Drops the entries of this cpu for `range` in `vmm`.
+static void _flushLocal(ManagedVmm &vmm, Hal::VmmRange range) {
+    if (vmm.active()) {
+        x86_64::flushRange(range);
+        return;
+    }
+
+    // Without pcids, the entries of a space that isn't active went away
+    // with the last cr3 switch.
+    if (not _pcids)
+        return;
+
+    auto &self = _self();
+    u64 tag = vmm._tag.load(ACQUIRE);
+    if (_invpcid and tag / PCID_COUNT == self._pcidGen and
+        range.size <= x86_64::FLUSH_PAGES * Hal::PAGE_SIZE) {
+        for (usize i = 0; i < range.size; i += Hal::PAGE_SIZE)
+            x86_64::invpcid(x86_64::Invpcid::ADDRESS, tag % PCID_COUNT, range.start + i);
+        return;
+    }
+
+    // Flushed as a whole the next time it's activated on this cpu.
+    vmm._stale.fetchOr(1uLL << self.id(), ACQ_REL);
+}
+
 Res<Strong<Hal::Vmm>> createVmm() {
     auto pml4Mem = Core::kmm()
                        .allocRange(Hal::PAGE_SIZE)
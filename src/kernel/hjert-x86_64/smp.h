@@ -0,0 +1,21 @@
+#pragma once
+
+#include <karm-base/std.h>
+
+namespace Hjert::Arch {
+
+struct [[gnu::packed]] SmpParams {
+    u64 cr3;
+    u64 efer;
+    u64 stack;
+    u64 entry;
+    u64 arg;
+};
+
+extern "C" u8 _smpTrampoline[];
+
+extern "C" u8 _smpTrampolineEnd[];
+
+extern "C" SmpParams _smpParams;
+
+} // namespace Hjert::Arch
@@ -0,0 +1,113 @@
+; Application processors start in real mode at the page given in the startup
+; IPI, with cs pointing at it. This code is copied to that page and brings
+; them to long mode, using the page tables, stack and entry point found in
+; _smpParams. Nothing in here depends on where the page is, addresses are
+; computed from the linear address of the page kept in ebx.
+
+%define OFF(x) (x - _smpTrampoline)
+
+section .text
+
+bits 16
+
+global _smpTrampoline
+_smpTrampoline:
+    cli
+    cld
+
+    mov ax, cs
+    mov ds, ax
+    mov ss, ax
+    mov sp, 0x1000
+
+    movzx ebx, ax
+    shl ebx, 4
+
+    mov eax, ebx
+    add eax, OFF(_smpGdt)
+    mov [OFF(_smpGdtDesc) + 2], eax
+    o32 lgdt [OFF(_smpGdtDesc)]
+
+    mov eax, cr0
+    or eax, 1 ; protected mode
+    mov cr0, eax
+
+    mov eax, ebx
+    add eax, OFF(_smpProtected)
+    push dword 0x08
+    push eax
+    o32 retf
+
+bits 32
+
+_smpProtected:
+    mov ax, 0x10
+    mov ds, ax
+    mov es, ax
+    mov ss, ax
+    lea esp, [ebx + 0x1000]
+
+    mov eax, cr4
+    or eax, (1 << 5) | (1 << 9) | (1 << 10) ; pae, osfxsr, osxmmexcpt
+    mov cr4, eax
+
+    mov eax, [ebx + OFF(_smpParams.cr3)]
+    mov cr3, eax
+
+    mov ecx, 0xC0000080 ; efer
+    mov eax, [ebx + OFF(_smpParams.efer)]
+    xor edx, edx
+    wrmsr
+
+    mov eax, cr0
+    and eax, ~(1 << 2)           ; no fpu emulation
+    or eax, (1 << 31) | (1 << 1) ; paging, monitor co-processor
+    mov cr0, eax
+
+    lea eax, [ebx + OFF(_smpLong)]
+    push dword 0x18
+    push eax
+    retf
+
+bits 64
+
+_smpLong:
+    mov ax, 0x10
+    mov ds, ax
+    mov es, ax
+    mov ss, ax
+
+    mov ebx, ebx ; the upper half is undefined after the mode switch
+
+    mov rsp, [rbx + OFF(_smpParams.stack)]
+    mov rdi, [rbx + OFF(_smpParams.arg)]
+    mov rax, [rbx + OFF(_smpParams.entry)]
+    call rax
+
+.hang:
+    cli
+    hlt
+    jmp .hang
+
+align 16
+_smpGdt:
+    dq 0
+    dq 0x00cf9a000000ffff ; 0x08 32-bit code
+    dq 0x00cf92000000ffff ; 0x10 data
+    dq 0x00af9a000000ffff ; 0x18 64-bit code
+
+_smpGdtDesc:
+    dw _smpGdtDesc - _smpGdt - 1
+    dd 0 ; patched with the linear address of _smpGdt
+
+align 8
+global _smpParams
+_smpParams:
+.cr3:   dq 0
+.efer:  dq 0
+.stack: dq 0
+.entry: dq 0
+.arg:   dq 0
+
+global _smpTrampolineEnd
+_smpTrampolineEnd:
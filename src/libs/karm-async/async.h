@@ -18,6 +18,8 @@ using Eval = Func<TimeStamp()>;
 
 struct Sched {
     struct Queued {
+        static constexpr bool SLAB = true;
+
         Coro<> coro;
         Eval eval;
     };
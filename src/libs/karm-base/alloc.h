@@ -0,0 +1,32 @@
+#pragma once
+
+#include "inert.h"
+
+namespace Karm {
+
+/// The default allocator of containers, backed by the global heap.
+/// Allocators are passed by value and stored in the containers, so they
+/// should be small and are usually empty.
+struct HeapAlloc {
+    template <typename T>
+    Inert<T> *allocArray(usize len) {
+        return new Inert<T>[len];
+    }
+
+    template <typename T>
+    void freeArray(Inert<T> *buf, usize) {
+        delete[] buf;
+    }
+
+    template <typename T, typename... Args>
+    T *make(Args &&...args) {
+        return new T(std::forward<Args>(args)...);
+    }
+
+    template <typename T>
+    void destroy(T *ptr) {
+        delete ptr;
+    }
+};
+
+} // namespace Karm
@@ -0,0 +1,266 @@
+#pragma once
+
+#include <karm-meta/nocopy.h>
+#include <karm-meta/traits.h>
+
+#include "align.h"
+#include "box.h"
+#include "size.h"
+#include "string.h"
+#include "vec.h"
+
+namespace Karm {
+
+/* --- Arena ---------------------------------------------------------------- */
+
+/// A bump allocator for objects that die together. Memory is served from
+/// chunks and only reclaimed all at once, by `reset()` or by rewinding to a
+/// `mark()`. Objects with a destructor made with `make()` are destroyed, in
+/// reverse order, when the memory they live in is reclaimed.
+struct Arena :
+    Meta::NoCopy {
+
+    static constexpr usize CHUNK_SIZE = kib(64);
+    static constexpr usize ALIGN = 16;
+
+    struct _Chunk {
+        _Chunk *prev;
+        usize cap;
+        usize used;
+
+        u8 *data() {
+            return reinterpret_cast<u8 *>(this + 1);
+        }
+    };
+
+    struct _Dtor {
+        _Dtor *prev;
+        void (*fn)(void *);
+        void *obj;
+    };
+
+    struct Mark {
+        _Chunk *chunk;
+        usize used;
+        usize total;
+        _Dtor *dtors;
+    };
+
+    struct Stats {
+        usize served; // Bytes handed out since the arena was created
+        usize used;   // Bytes currently handed out
+        usize peak;   // Highest value of `used`
+    };
+
+    _Chunk *_chunk = nullptr;
+    _Chunk *_spare = nullptr; // Chunks kept around after a reset
+    _Dtor *_dtors = nullptr;
+    Stats _stats{};
+
+    Arena() = default;
+
+    ~Arena() {
+        reset();
+        while (_spare) {
+            auto *prev = _spare->prev;
+            _freeChunk(_spare);
+            _spare = prev;
+        }
+    }
+
+    /* --- Chunks ----------------------------------------------------------- */
+
+    static _Chunk *_allocChunk(usize cap) {
+        auto *chunk = reinterpret_cast<_Chunk *>(new u8[sizeof(_Chunk) + cap]);
+        chunk->prev = nullptr;
+        chunk->cap = cap;
+        chunk->used = 0;
+        return chunk;
+    }
+
+    static void _freeChunk(_Chunk *chunk) {
+        delete[] reinterpret_cast<u8 *>(chunk);
+    }
+
+    void _pushChunk(usize size, usize align) {
+        usize need = size + align;
+        _Chunk *chunk = nullptr;
+
+        if (_spare and need <= _spare->cap) {
+            chunk = _spare;
+            _spare = chunk->prev;
+        } else {
+            // Large allocations get a chunk of their own.
+            chunk = _allocChunk(max(need, CHUNK_SIZE));
+        }
+
+        chunk->used = 0;
+        chunk->prev = _chunk;
+        _chunk = chunk;
+    }
+
+    void _popChunk() {
+        auto *chunk = _chunk;
+        _chunk = chunk->prev;
+
+        if (chunk->cap == CHUNK_SIZE) {
+            chunk->prev = _spare;
+            _spare = chunk;
+        } else {
+            _freeChunk(chunk);
+        }
+    }
+
+    /* --- Allocation ------------------------------------------------------- */
+
+    void *alloc(usize size, usize align = ALIGN) {
+        if (not _chunk or
+            alignUp((usize)_chunk->data() + _chunk->used, align) + size >
+                (usize)_chunk->data() + _chunk->cap)
+            _pushChunk(size, align);
+
+        usize start = alignUp((usize)_chunk->data() + _chunk->used, align);
+        usize end = start + size;
+        usize used = end - (usize)_chunk->data();
+
+        usize grown = used - _chunk->used;
+        _chunk->used = used;
+        _stats.served += size;
+        _stats.used += grown;
+        _stats.peak = max(_stats.peak, _stats.used);
+
+        return reinterpret_cast<void *>(start);
+    }
+
+    template <typename T, typename... Args>
+    T &make(Args &&...args) {
+        T *obj = new (alloc(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+
+        if constexpr (not Meta::TriviallyDestructible<T>) {
+            auto *dtor = new (alloc(sizeof(_Dtor), alignof(_Dtor))) _Dtor{
+                _dtors,
+                [](void *obj) {
+                    static_cast<T *>(obj)->~T();
+                },
+                obj,
+            };
+            _dtors = dtor;
+        }
+
+        return *obj;
+    }
+
+    /// Copies a string into the arena, the copy lives until the arena is
+    /// reset and is null terminated.
+    Str dup(Str str) {
+        auto *buf = static_cast<char *>(alloc(str.len() + 1, 1));
+        memcpy(buf, str.buf(), str.len());
+        buf[str.len()] = 0;
+        return {buf, str.len()};
+    }
+
+    /* --- Frames ----------------------------------------------------------- */
+
+    Mark mark() {
+        return {
+            _chunk,
+            _chunk ? _chunk->used : 0,
+            _stats.used,
+            _dtors,
+        };
+    }
+
+    /// Frees everything allocated since `mark` was taken.
+    void rewind(Mark mark) {
+        while (_dtors != mark.dtors) {
+            auto *dtor = _dtors;
+            _dtors = dtor->prev;
+            dtor->fn(dtor->obj);
+        }
+
+        while (_chunk != mark.chunk)
+            _popChunk();
+
+        if (_chunk)
+            _chunk->used = mark.used;
+
+        _stats.used = mark.total;
+    }
+
+    void reset() {
+        rewind({});
+    }
+
+    Stats stats() const {
+        return _stats;
+    }
+};
+
+/// Rewinds the arena to where it was when the scope was entered.
+struct ArenaScope :
+    Meta::Static {
+
+    Arena &_arena;
+    Arena::Mark _mark;
+
+    ArenaScope(Arena &arena)
+        : _arena(arena), _mark(arena.mark()) {}
+
+    ~ArenaScope() {
+        _arena.rewind(_mark);
+    }
+};
+
+/* --- Allocator ------------------------------------------------------------ */
+
+/// Allocates from an arena, see alloc.h. Nothing is freed before the arena
+/// is reset, so containers should be sized up front when possible.
+struct ArenaAlloc {
+    Arena *_arena = nullptr;
+
+    ArenaAlloc() = default;
+
+    ArenaAlloc(Arena &arena)
+        : _arena(&arena) {}
+
+    Arena &_ensure() {
+        if (not _arena)
+            panic("no arena");
+        return *_arena;
+    }
+
+    template <typename T>
+    Inert<T> *allocArray(usize len) {
+        return static_cast<Inert<T> *>(_ensure().alloc(sizeof(Inert<T>) * len, alignof(Inert<T>)));
+    }
+
+    template <typename T>
+    void freeArray(Inert<T> *, usize) {}
+
+    template <typename T, typename... Args>
+    T *make(Args &&...args) {
+        return new (_ensure().alloc(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+    }
+
+    template <typename T>
+    void destroy(T *ptr) {
+        ptr->~T();
+    }
+};
+
+template <typename T>
+using ArenaBuf = Buf<T, ArenaAlloc>;
+
+template <typename T>
+using ArenaVec = _Vec<ArenaBuf<T>>;
+
+template <typename T>
+using ArenaBox = Box<T, ArenaAlloc>;
+
+template <typename T, typename... Args>
+ArenaBox<T> makeBox(Arena &arena, Args &&...args) {
+    ArenaAlloc alloc{arena};
+    return {alloc.make<T>(std::forward<Args>(args)...), alloc};
+}
+
+} // namespace Karm
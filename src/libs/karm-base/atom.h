@@ -0,0 +1,92 @@
+#pragma once
+
+#include "hashmap.h"
+#include "lock.h"
+#include "string.h"
+
+namespace Karm {
+
+/* --- Atom Table ----------------------------------------------------------- */
+
+struct _AtomEntry {
+    u64 hash;
+    String str;
+};
+
+// Interned strings are never freed, atoms are meant for small sets of
+// frequently repeated strings (keys, names, extensions, ...).
+struct _AtomTable {
+    Lock _lock;
+    HashMap<Str, _AtomEntry *> _entries;
+
+    _AtomEntry const *intern(Str str) {
+        LockScope scope(_lock);
+
+        if (auto entry = _entries.get(str)) {
+            _countString(stringStats().atomHits);
+            return *entry;
+        }
+
+        // The entry lives on the heap so the key can point into its
+        // storage, even when the string is stored inline.
+        auto *entry = new _AtomEntry{hash(str), str};
+        _entries.put(entry->str.str(), entry);
+        _countString(stringStats().atoms);
+        return entry;
+    }
+};
+
+inline _AtomTable &_atomTable() {
+    // Never destroyed, atoms may still be used by static destructors.
+    static _AtomTable *table = new _AtomTable();
+    return *table;
+}
+
+/* --- Atom ----------------------------------------------------------------- */
+
+/// An interned string, atoms with the same content share the same storage,
+/// so they are cheap to copy and compare equal by pointer.
+struct Atom {
+    _AtomEntry const *_entry;
+
+    Atom()
+        : Atom(Str{}) {}
+
+    Atom(Str str)
+        : _entry(_atomTable().intern(str)) {}
+
+    Atom(char const *cstr)
+        : Atom(Str{cstr}) {}
+
+    Atom(String const &str)
+        : Atom(str.str()) {}
+
+    Str str() const {
+        return _entry->str.str();
+    }
+
+    usize len() const {
+        return _entry->str.len();
+    }
+
+    // Interned, so two atoms are equal exactly when they share an entry.
+    bool operator==(Atom const &other) const {
+        return _entry == other._entry;
+    }
+
+    Ordr cmp(Atom const &other) const {
+        if (_entry == other._entry)
+            return Ordr::EQUAL;
+        return ::cmp(str(), other.str());
+    }
+
+    Ordr cmp(Str other) const {
+        return ::cmp(str(), other);
+    }
+
+    u64 hash() const {
+        return _entry->hash;
+    }
+};
+
+} // namespace Karm
@@ -50,6 +50,14 @@ struct Atomic {
         return __atomic_fetch_sub(&_val, desired, order);
     }
 
+    T fetchOr(T bits, MemOrder order = MemOrder::SEQ_CST) {
+        return __atomic_fetch_or(&_val, bits, order);
+    }
+
+    T fetchAnd(T bits, MemOrder order = MemOrder::SEQ_CST) {
+        return __atomic_fetch_and(&_val, bits, order);
+    }
+
     T fetchInc(MemOrder order = MemOrder::SEQ_CST) {
         return __atomic_fetch_add(&_val, 1, order);
     }
@@ -0,0 +1,224 @@
+#include <karm-base/bits.h>
+#include <karm-base/range-alloc.h>
+#include <karm-base/rc.h>
+#include <karm-base/size.h>
+#include <karm-base/slot-table.h>
+#include <karm-main/main.h>
+#include <karm-sys/time.h>
+
+// Usage: karm-base-bench [name...]
+//
+// Runs the named benchmarks, or all of them, and prints the mean time per
+// operation. Timings are only comparable between runs on the same machine.
+
+namespace Karm::Base::Bench {
+
+// A xorshift generator, so every run churns through the same sequence.
+struct Rand {
+    u64 _state = 0x2545f4914f6cdd1d;
+
+    usize next(usize max) {
+        _state ^= _state << 13;
+        _state ^= _state >> 7;
+        _state ^= _state << 17;
+        return _state % max;
+    }
+};
+
+static void _report(Str name, TimeSpan elapsed, usize ops) {
+    Sys::println("{}: {}ns/op", name, elapsed.toUSecs() * 1000 / max(ops, 1uz));
+}
+
+/* --- Slot Table ----------------------------------------------------------- */
+
+struct Obj {
+    usize value;
+};
+
+// The fixed array with a linear scan for free slots that domains used to
+// keep their caps in.
+struct LinearSlots {
+    Array<Opt<Strong<Obj>>, 4096> _slots;
+
+    Opt<usize> add(Strong<Obj> obj) {
+        for (usize i = 1; i < _slots.len(); i++) {
+            if (not _slots[i]) {
+                _slots[i] = obj;
+                return i;
+            }
+        }
+        return NONE;
+    }
+
+    Strong<Obj> *access(usize handle) {
+        if (not _slots[handle])
+            return nullptr;
+        return &*_slots[handle];
+    }
+
+    Opt<Strong<Obj>> take(usize handle) {
+        return _slots[handle].take();
+    }
+};
+
+// Keeps `LIVE` caps alive and replaces a random one each round, like a
+// server handing out and dropping caps.
+template <typename Slots>
+static Res<> _slotChurn(Str name, Slots &slots) {
+    static constexpr usize LIVE = 1000;
+    static constexpr usize ROUNDS = 200000;
+
+    Vec<usize> handles;
+    for (usize i = 0; i < LIVE; i++)
+        handles.pushBack(try$(slots.add(makeStrong<Obj>(i))));
+
+    Rand rand;
+    usize sum = 0;
+    auto start = Sys::now();
+    for (usize i = 0; i < ROUNDS; i++) {
+        auto &handle = handles[rand.next(LIVE)];
+        sum += (*slots.access(handle))->value;
+        auto obj = try$(slots.take(handle));
+        handle = try$(slots.add(obj));
+    }
+    auto elapsed = Sys::now() - start;
+
+    if (sum == 0)
+        return Error::other("nothing was looked up");
+
+    _report(name, elapsed, ROUNDS);
+    return Ok();
+}
+
+static Res<> benchSlotTable() {
+    // The same layout as the slots of a hjert domain.
+    auto table = makeBox<SlotTable<Strong<Obj>, 10, 2>>();
+    try$(_slotChurn("slot-table/churn", *table));
+
+    auto linear = makeBox<LinearSlots>();
+    try$(_slotChurn("slot-table/linear-churn", *linear));
+
+    return Ok();
+}
+
+/* --- Bits ----------------------------------------------------------------- */
+
+// The pmm bitmap of a machine with 64GiB of 4KiB pages, most of it used, so
+// lower allocations have to get past 48GiB of used pages.
+static Res<> benchBits() {
+    static constexpr usize LEN = 16 * 1024 * 1024;
+    static constexpr usize ROUNDS = 2000;
+
+    Vec<u64> storage;
+    storage.resize(Bits::storageLen(LEN));
+    Bits bits{mutSub(storage), LEN};
+    bits.fill(true);
+    bits.set(BitsRange{LEN / 4 * 3, LEN / 4}, false);
+
+    for (usize count : {1uz, 64uz}) {
+        auto start = Sys::now();
+        for (usize i = 0; i < ROUNDS; i++) {
+            auto range = try$(bits.alloc(count, 0, false));
+            bits.set(range, false);
+        }
+        _report(count == 1 ? "bits/lower-alloc-1" : "bits/lower-alloc-64", Sys::now() - start, ROUNDS);
+    }
+
+    usize used = 0;
+    auto start = Sys::now();
+    for (usize i = 0; i < ROUNDS; i++)
+        used += bits.used();
+    _report("bits/used", Sys::now() - start, ROUNDS);
+
+    if (used != ROUNDS * (LEN / 4 * 3))
+        return Error::other("bitmap changed while benchmarking");
+
+    return Ok();
+}
+
+/* --- Range Alloc ---------------------------------------------------------- */
+
+// Maps and unmaps 4-64KiB ranges over a 128TiB address space, with `live`
+// mappings of which every other one was unmapped up front to fragment it.
+static Res<> _rangeChurn(Str name, usize live) {
+    static constexpr usize ROUNDS = 20000;
+
+    RangeAlloc<> alloc;
+    alloc.unused({0x400000, 0x800000000000});
+
+    Rand rand;
+    Vec<USizeRange> mapped;
+    for (usize i = 0; i < live; i++) {
+        auto range = try$(alloc.alloc(kib(4) * (1 + rand.next(16))));
+        if (i % 2)
+            alloc.unused(range);
+        else
+            mapped.pushBack(range);
+    }
+
+    auto start = Sys::now();
+    for (usize i = 0; i < ROUNDS; i++) {
+        mapped.pushBack(try$(alloc.alloc(kib(4) * (1 + rand.next(16)))));
+        usize victim = rand.next(mapped.len());
+        alloc.unused(mapped[victim]);
+        mapped[victim] = mapped[mapped.len() - 1];
+        mapped.popBack();
+    }
+    _report(name, Sys::now() - start, ROUNDS);
+
+    return Ok();
+}
+
+// Aligned allocations when thousands of free ranges are long enough but
+// none of them is aligned well enough.
+static Res<> _rangeAligned() {
+    static constexpr usize HOLES = 10000;
+    static constexpr usize ROUNDS = 20000;
+
+    RangeAlloc<> alloc;
+    for (usize i = 0; i < HOLES; i++)
+        alloc.unused({i * kib(128) + kib(4), kib(32)});
+    alloc.unused({HOLES * kib(128), mib(64)});
+
+    auto start = Sys::now();
+    for (usize i = 0; i < ROUNDS; i++)
+        alloc.unused(try$(alloc.alloc(kib(16), kib(64))));
+    _report("range-alloc/aligned", Sys::now() - start, ROUNDS);
+
+    return Ok();
+}
+
+static Res<> benchRangeAlloc() {
+    try$(_rangeChurn("range-alloc/churn-1000", 1000));
+    try$(_rangeChurn("range-alloc/churn-10000", 10000));
+    try$(_rangeChurn("range-alloc/churn-50000", 50000));
+    try$(_rangeAligned());
+    return Ok();
+}
+
+/* --- Entry Point ---------------------------------------------------------- */
+
+struct Bench {
+    Str name;
+    Res<> (*fn)();
+};
+
+static Array<Bench, 3> BENCHES = {
+    Bench{"slot-table", benchSlotTable},
+    Bench{"bits", benchBits},
+    Bench{"range-alloc", benchRangeAlloc},
+};
+
+} // namespace Karm::Base::Bench
+
+Res<> entryPoint(Ctx &ctx) {
+    auto &args = useArgs(ctx);
+
+    for (auto &bench : Base::Bench::BENCHES) {
+        if (args.len() and not args.has(bench.name))
+            continue;
+        try$(bench.fn());
+    }
+
+    return Ok();
+}
@@ -1,6 +1,8 @@
 #pragma once
 
+#include "clamp.h"
 #include "opt.h"
+#include "panic.h"
 #include "range.h"
 #include "slice.h"
 
@@ -8,107 +10,282 @@ namespace Karm {
 
 using BitsRange = Range<usize, struct BitsRangeTag>;
 
+/// A bitmap of used (set) and free (clear) bits over caller provided
+/// storage, for allocators that can't allocate themselves (e.g. the pmm).
+///
+/// Bits are stored in 64-bit words, and a summary keeps one bit per word
+/// telling if that word still has a free bit. Searches skip over full
+/// words through the summary and walk runs with `ctz`/`clz`, never bit by
+/// bit.
 struct Bits {
-    u8 *_buf{};
-    usize _len{};
+    static constexpr usize WORD = 64;
+    static constexpr u64 FULL = ~0uLL;
 
-    Bits(MutSlice<u8> slice)
-        : _buf(slice.buf()),
-          _len(slice.len()) {}
+    u64 *_words{};
+    u64 *_summary{};
+    usize _len{}; // In bits
+
+    /// Number of words of storage needed for `len` bits.
+    static constexpr usize storageLen(usize len) {
+        usize words = alignUp(len, WORD) / WORD;
+        return words + alignUp(words, WORD) / WORD;
+    }
+
+    Bits(MutSlice<u64> storage, usize len)
+        : _words(storage.buf()),
+          _summary(storage.buf() + _wordsLen(len)),
+          _len(len) {
+        if (storage.len() < storageLen(len))
+            panic("bits storage too small");
+
+        for (usize wi = 0; wi < _wordsLen(); wi++)
+            _sync(wi);
+    }
+
+    static constexpr usize _wordsLen(usize len) {
+        return alignUp(len, WORD) / WORD;
+    }
+
+    usize _wordsLen() const {
+        return _wordsLen(_len);
+    }
+
+    /* --- Word Helpers ----------------------------------------------------- */
+
+    ALWAYS_INLINE static usize _ctz(u64 w) {
+        return w ? __builtin_ctzll(w) : WORD;
+    }
+
+    ALWAYS_INLINE static usize _clz(u64 w) {
+        return w ? __builtin_clzll(w) : WORD;
+    }
+
+    // Mask of the bits in [start, end) of a word, end must be > start.
+    ALWAYS_INLINE static u64 _mask(usize start, usize end) {
+        u64 hi = end == WORD ? FULL : (1uLL << end) - 1;
+        return hi & ~((1uLL << start) - 1);
+    }
+
+    // The word, with bits past the end of the bitmap reported as used.
+    ALWAYS_INLINE u64 _word(usize wi) const {
+        u64 w = _words[wi];
+        usize tail = _len % WORD;
+        if (wi == _wordsLen() - 1 and tail)
+            w |= ~_mask(0, tail);
+        return w;
+    }
+
+    ALWAYS_INLINE void _sync(usize wi) {
+        u64 bit = 1uLL << (wi % WORD);
+        if (_word(wi) == FULL)
+            _summary[wi / WORD] &= ~bit;
+        else
+            _summary[wi / WORD] |= bit;
+    }
+
+    // Index of the first word at or after `wi` with a free bit.
+    usize _nextFree(usize wi) const {
+        usize words = _wordsLen();
+        while (wi < words) {
+            u64 s = _summary[wi / WORD] & ~((1uLL << (wi % WORD)) - 1);
+            if (s)
+                return min(alignDown(wi, WORD) + _ctz(s), words);
+            wi = alignDown(wi, WORD) + WORD;
+        }
+        return words;
+    }
+
+    // One past the index of the last word before `wi` with a free bit, or 0.
+    usize _prevFree(usize wi) const {
+        while (wi > 0) {
+            usize i = wi - 1;
+            u64 s = _summary[i / WORD] & _mask(0, i % WORD + 1);
+            if (s)
+                return alignDown(i, WORD) + (WORD - _clz(s));
+            wi = alignDown(i, WORD);
+        }
+        return 0;
+    }
+
+    /* --- Access ----------------------------------------------------------- */
 
     bool get(usize index) const {
-        return _buf[index / 8] & (1 << (index % 8));
+        return _words[index / WORD] & (1uLL << (index % WORD));
     }
 
     void set(usize index, bool value) {
-        if (value) {
-            _buf[index / 8] |= (1 << (index % 8));
-        } else {
-            _buf[index / 8] &= ~(1 << (index % 8));
-        }
+        set(BitsRange{index, 1}, value);
     }
 
     void set(BitsRange range, bool value) {
-        for (usize i = range.start; i < range.end(); i++) {
-            set(i, value);
+        usize i = range.start;
+        usize end = range.end();
+
+        while (i < end) {
+            usize wi = i / WORD;
+            usize bit = i % WORD;
+            usize n = min(WORD - bit, end - i);
+            u64 mask = _mask(bit, bit + n);
+
+            if (value)
+                _words[wi] |= mask;
+            else
+                _words[wi] &= ~mask;
+
+            _sync(wi);
+            i += n;
         }
     }
 
     void fill(bool value) {
-        ::fill(mutBytes(), value ? 0xff_byte : 0x00_byte);
+        for (usize wi = 0; wi < _wordsLen(); wi++) {
+            _words[wi] = value ? FULL : 0;
+            _sync(wi);
+        }
     }
 
     usize len() const {
-        return _len * 8;
+        return _len;
     }
 
-    Opt<BitsRange> alloc(usize count, usize start, bool upper = true) {
-        start = min(start, len());
+    /* --- Allocation ------------------------------------------------------- */
 
-        if (_len == 0) {
-            return NONE;
-        }
+    Opt<BitsRange> _allocLower(usize count, usize start) {
+        usize run = 0;
+        usize runStart = 0;
+        usize wi = _nextFree(start / WORD);
 
-        BitsRange range = {};
-        isize offset = upper ? -1 : 1;
-
-        for (usize i = start; (upper ? i > 0 : i < len()); i += offset) {
-            if (get(i)) {
-                range = {};
-            } else {
-                if (range.size == 0 or upper) {
-                    range.start = i;
-                }
+        while (wi < _wordsLen()) {
+            u64 w = _word(wi);
+            if (wi == start / WORD)
+                w |= (1uLL << (start % WORD)) - 1;
 
-                range.size++;
+            usize bit = 0;
+            while (bit < WORD) {
+                u64 rest = w >> bit;
+                if (rest & 1) {
+                    run = 0;
+                    bit += _ctz(~rest);
+                } else {
+                    usize zeros = min(_ctz(rest), WORD - bit);
+                    if (run == 0)
+                        runStart = wi * WORD + bit;
+                    if (run + zeros >= count) {
+                        BitsRange range = {runStart, count};
+                        set(range, true);
+                        return range;
+                    }
+                    run += zeros;
+                    bit += zeros;
+                }
             }
 
-            if (range.size == count) {
-                set(range, true);
-                return range;
+            // A full word ends the run, jump to the next one with room.
+            usize next = _nextFree(wi + 1);
+            if (next != wi + 1)
+                run = 0;
+            wi = next;
+        }
+
+        return NONE;
+    }
+
+    Opt<BitsRange> _allocUpper(usize count, usize end) {
+        usize run = 0;
+        usize runEnd = 0;
+        usize wi = _prevFree(_wordsLen(end));
+
+        while (wi > 0) {
+            wi--;
+            u64 w = _word(wi);
+            if (wi == end / WORD and end % WORD)
+                w |= ~_mask(0, end % WORD);
+
+            // Bits left to look at in this word, from the top.
+            usize left = WORD;
+            while (left > 0) {
+                u64 rest = w << (WORD - left);
+                if (rest >> (WORD - 1)) {
+                    run = 0;
+                    left -= min(_clz(~rest), left);
+                } else {
+                    usize zeros = min(_clz(rest), left);
+                    if (run == 0)
+                        runEnd = wi * WORD + left;
+                    if (run + zeros >= count) {
+                        BitsRange range = {runEnd - count, count};
+                        set(range, true);
+                        return range;
+                    }
+                    run += zeros;
+                    left -= zeros;
+                }
             }
+
+            usize prev = _prevFree(wi);
+            if (prev != wi)
+                run = 0;
+            wi = prev;
         }
 
         return NONE;
     }
 
+    /// Finds `count` consecutive free bits and marks them as used. Lower
+    /// allocations take the first run at or after `start`, upper ones the
+    /// last run ending at or before `start`.
+    Opt<BitsRange> alloc(usize count, usize start, bool upper = true) {
+        start = min(start, len());
+
+        if (_len == 0 or count == 0)
+            return NONE;
+
+        if (upper)
+            return _allocUpper(count, start);
+        return _allocLower(count, start);
+    }
+
     usize used() const {
         usize res = 0;
+        for (usize wi = 0; wi < _wordsLen(); wi++)
+            res += __builtin_popcountll(_words[wi]);
 
-        for (usize i = 0; i < len(); i++) {
-            if (get(i)) {
-                res++;
-            }
-        }
+        usize tail = _len % WORD;
+        if (tail)
+            res -= __builtin_popcountll(_words[_wordsLen() - 1] & ~_mask(0, tail));
 
         return res;
     }
 
+    /// Calls `cb` with every run of free bits.
     void visit(auto cb) {
         BitsRange range = {};
-        for (usize i = 0; i < len(); i++) {
-            if (get(i)) {
-                if (range.size > 0) {
-                    cb(range);
-                }
-
-                range = {};
-            } else {
-                if (range.size == 0) {
-                    range.start = i;
+        for (usize wi = 0; wi < _wordsLen(); wi++) {
+            u64 w = _word(wi);
+            usize bit = 0;
+            while (bit < WORD) {
+                u64 rest = w >> bit;
+                if (rest & 1) {
+                    if (range.size > 0)
+                        cb(range);
+                    range = {};
+                    bit += _ctz(~rest);
+                } else {
+                    usize zeros = min(_ctz(rest), WORD - bit);
+                    if (range.size == 0)
+                        range.start = wi * WORD + bit;
+                    range.size += zeros;
+                    bit += zeros;
                 }
-
-                range.size++;
             }
         }
-    }
 
-    Bytes bytes() const {
-        return Bytes(_buf, _len);
+        if (range.size > 0)
+            cb(range);
     }
 
-    MutBytes mutBytes() {
-        return MutBytes(_buf, _len);
+    Bytes bytes() const {
+        return Bytes(reinterpret_cast<Byte const *>(_words), _wordsLen() * sizeof(u64));
     }
 };
 
@@ -2,42 +2,47 @@
 
 #include <karm-meta/traits.h>
 
+#include "alloc.h"
 #include "opt.h"
 #include "panic.h"
 #include "std.h"
 
 namespace Karm {
 
-template <typename T>
+/// Owns a single object, which is destroyed through `A`, see alloc.h.
+template <typename T, typename A = HeapAlloc>
 struct Box {
+    static constexpr bool RELOCATABLE = true;
+
     T *_ptr{};
+    [[no_unique_address]] A _alloc{};
 
     constexpr Box() = delete;
 
-    constexpr Box(T *ptr)
-        : _ptr(ptr) {}
+    constexpr Box(T *ptr, A alloc = {})
+        : _ptr(ptr), _alloc(alloc) {}
 
     constexpr Box(Box const &) = delete;
 
     template <Meta::Derive<T> U>
-    constexpr Box(Box<U> &&other) {
-        delete _ptr;
-        _ptr = other._ptr;
-        other._ptr = nullptr;
+    constexpr Box(Box<U, A> &&other)
+        : _ptr(std::exchange(other._ptr, nullptr)),
+          _alloc(other._alloc) {
     }
 
     constexpr ~Box() {
         if (_ptr)
-            delete _ptr;
+            _alloc.destroy(_ptr);
     }
 
     constexpr Box &operator=(Box const &) = delete;
 
     template <Meta::Derive<T> U>
-    constexpr Box &operator=(Box<U> &&other) {
-        delete _ptr;
-        _ptr = other._ptr;
-        other._ptr = nullptr;
+    constexpr Box &operator=(Box<U, A> &&other) {
+        if (_ptr)
+            _alloc.destroy(_ptr);
+        _ptr = std::exchange(other._ptr, nullptr);
+        _alloc = other._alloc;
         return *this;
     }
 
@@ -70,8 +75,8 @@ struct Box {
     }
 };
 
-template <typename T>
-using OptBox = Opt<Box<T>>;
+template <typename T, typename A = HeapAlloc>
+using OptBox = Opt<Box<T, A>>;
 
 template <typename T, typename... Args>
 constexpr static Box<T> makeBox(Args... args) {
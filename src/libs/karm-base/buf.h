@@ -1,26 +1,50 @@
 #pragma once
 
+#include "alloc.h"
 #include "array.h"
 #include "clamp.h"
 #include "inert.h"
 
 namespace Karm {
 
+/// Move `count` elements from `src` to the uninitialized storage at `dst`,
+/// leaving `src` uninitialized, the two ranges may overlap.
+template <typename T>
+ALWAYS_INLINE void relocate(Inert<T> *dst, Inert<T> *src, usize count) {
+    if (dst == src or count == 0)
+        return;
+
+    if constexpr (Meta::TriviallyRelocatable<T>) {
+        memmove((void *)dst, (void const *)src, count * sizeof(Inert<T>));
+    } else if (dst < src) {
+        for (usize i = 0; i < count; i++)
+            dst[i].ctor(src[i].take());
+    } else {
+        for (usize i = count; i > 0; i--)
+            dst[i - 1].ctor(src[i - 1].take());
+    }
+}
+
 /// A dynamically sized array of elements.
 /// Often used as a backing store for other data structures. (e.g. `Vec`)
-template <typename T>
+/// The memory comes from `A`, see alloc.h.
+template <typename T, typename A = HeapAlloc>
 struct Buf {
     using Inner = T;
 
+    static constexpr bool RELOCATABLE = true;
+    static constexpr usize MIN_CAP = 4;
+
     Inert<T> *_buf{};
     usize _cap{};
     usize _len{};
+    [[no_unique_address]] A _alloc{};
 
     static Buf init(usize len, T fill = {}) {
         Buf buf;
         buf._cap = len;
         buf._len = len;
-        buf._buf = new Inert<T>[len];
+        buf._buf = buf._alloc.template allocArray<T>(len);
         for (usize i = 0; i < len; i++) {
             buf._buf[i].ctor(fill);
         }
@@ -31,41 +55,44 @@ struct Buf {
 
     Buf(usize cap)
         : _cap(cap) {
-        _buf = new Inert<T>[cap];
+        _buf = _alloc.template allocArray<T>(cap);
+    }
+
+    Buf(A alloc, usize cap = 0)
+        : _cap(cap), _alloc(alloc) {
+        if (cap)
+            _buf = _alloc.template allocArray<T>(cap);
     }
 
     Buf(std::initializer_list<T> other) {
         _cap = other.size();
         _len = other.size();
-        _buf = new Inert<T>[_cap];
+        _buf = _alloc.template allocArray<T>(_cap);
         for (usize i = 0; i < _len; i++) {
             _buf[i].ctor(std::move(other.begin()[i]));
         }
     }
 
-    Buf(Sliceable<T> auto &other) {
+    Buf(Sliceable<T> auto const &other) {
         _cap = other.len();
         _len = other.len();
-        _buf = new Inert<T>[_cap];
-        for (usize i = 0; i < _len; i++) {
-            _buf[i].ctor(other[i]);
-        }
+        _buf = _alloc.template allocArray<T>(_cap);
+        _copy(_buf, other.buf(), _len);
     }
 
-    Buf(Buf const &other) {
+    Buf(Buf const &other)
+        : _alloc(other._alloc) {
         _cap = other._cap;
         _len = other._len;
-        _buf = new Inert<T>[_cap];
-
-        for (usize i = 0; i < _len; i++) {
-            _buf[i].ctor(other[i]);
-        }
+        _buf = _alloc.template allocArray<T>(_cap);
+        _copy(_buf, other.buf(), _len);
     }
 
     Buf(Buf &&other) {
         std::swap(_buf, other._buf);
         std::swap(_cap, other._cap);
         std::swap(_len, other._len);
+        std::swap(_alloc, other._alloc);
     }
 
     ~Buf() {
@@ -76,7 +103,7 @@ struct Buf {
             _buf[i].dtor();
         }
 
-        delete[] _buf;
+        _alloc.freeArray(_buf, _cap);
     }
 
     Buf &operator=(Buf const &other) {
@@ -88,6 +115,7 @@ struct Buf {
         std::swap(_buf, other._buf);
         std::swap(_cap, other._cap);
         std::swap(_len, other._len);
+        std::swap(_alloc, other._alloc);
         return *this;
     }
 
@@ -95,58 +123,61 @@ struct Buf {
 
     constexpr T const &operator[](usize i) const { return _buf[i].unwrap(); }
 
-    void ensure(usize cap) {
-        if (cap <= _cap)
-            return;
-
-        if (not _buf) {
-            _buf = new Inert<T>[cap];
-            _cap = cap;
-            return;
+    static void _copy(Inert<T> *dst, T const *src, usize count) {
+        if constexpr (Meta::TriviallyCopyable<T>) {
+            if (count)
+                memcpy((void *)dst, (void const *)src, count * sizeof(T));
+        } else {
+            for (usize i = 0; i < count; i++)
+                dst[i].ctor(src[i]);
         }
+    }
 
-        Inert<T> *tmp = new Inert<T>[cap];
-        for (usize i = 0; i < _len; i++) {
-            tmp[i].ctor(_buf[i].take());
+    void _realloc(usize cap) {
+        Inert<T> *tmp = _alloc.template allocArray<T>(cap);
+        if (_buf) {
+            relocate(tmp, _buf, _len);
+            _alloc.freeArray(_buf, _cap);
         }
-
-        delete[] _buf;
         _buf = tmp;
         _cap = cap;
     }
 
+    // Make room for `cap` elements, growing geometrically so a sequence of
+    // appends only reallocates O(log n) times.
+    void _grow(usize cap) {
+        if (cap <= _cap)
+            return;
+
+        _realloc(max(cap, _cap * 2, MIN_CAP));
+    }
+
+    // Reserve exactly `cap` elements.
+    void ensure(usize cap) {
+        if (cap <= _cap)
+            return;
+
+        _realloc(cap);
+    }
+
     void fit() {
         if (_len == _cap)
             return;
 
-        Inert<T> *tmp = new Inert<T>[_len];
-        for (usize i = 0; i < _len; i++) {
-            tmp[i].ctor(_buf[i].take());
-        }
-
-        delete[] _buf;
-        _buf = tmp;
-        _cap = _len;
+        _realloc(_len);
     }
 
     template <typename... Args>
     void emplace(usize index, Args &&...args) {
-        ensure(_len + 1);
-
-        for (usize i = _len; i > index; i--) {
-            _buf[i].ctor(_buf[i - 1].take());
-        }
+        _grow(_len + 1);
+        relocate(_buf + index + 1, _buf + index, _len - index);
         _buf[index].ctor(std::forward<Args>(args)...);
         _len++;
     }
 
     void insert(usize index, T &&value) {
-        ensure(_len + 1);
-
-        for (usize i = _len; i > index; i--) {
-            _buf[i].ctor(_buf[i - 1].take());
-        }
-
+        _grow(_len + 1);
+        relocate(_buf + index + 1, _buf + index, _len - index);
         _buf[index].ctor(std::move(value));
         _len++;
     }
@@ -161,26 +192,36 @@ struct Buf {
         _buf[index].ctor(std::move(value));
     }
 
-    void insert(Copy, usize index, T const *first, usize count) {
-        ensure(_len + count);
-
-        for (usize i = _len; i > index; i--) {
-            _buf[i].ctor(_buf[i - count].take());
-        }
+    bool _aliases(T const *ptr) const {
+        return (void const *)ptr >= (void const *)_buf and
+               (void const *)ptr < (void const *)(_buf + _len);
+    }
 
-        for (usize i = 0; i < count; i++) {
-            _buf[index + i].ctor(first[i]);
+    void insert(Copy, usize index, T const *first, usize count) {
+        if (_aliases(first)) {
+            // The elements come from this buffer, they are copied into the
+            // new storage before the old one is shifted or freed.
+            usize cap = max(_len + count, _cap * 2, MIN_CAP);
+            Inert<T> *tmp = _alloc.template allocArray<T>(cap);
+            _copy(tmp + index, first, count);
+            relocate(tmp, _buf, index);
+            relocate(tmp + index + count, _buf + index, _len - index);
+            _alloc.freeArray(_buf, _cap);
+            _buf = tmp;
+            _cap = cap;
+            _len += count;
+            return;
         }
 
+        _grow(_len + count);
+        relocate(_buf + index + count, _buf + index, _len - index);
+        _copy(_buf + index, first, count);
         _len += count;
     }
 
     void insert(Move, usize index, T *first, usize count) {
-        ensure(_len + count);
-
-        for (usize i = _len; i > index; i--) {
-            _buf[i].ctor(_buf[i - count].take());
-        }
+        _grow(_len + count);
+        relocate(_buf + index + count, _buf + index, _len - index);
 
         for (usize i = 0; i < count; i++) {
             _buf[index + i].ctor(std::move(first[i]));
@@ -195,9 +236,7 @@ struct Buf {
         }
 
         T ret = _buf[index].take();
-        for (usize i = index; i < _len - 1; i++) {
-            _buf[i].ctor(_buf[i + 1].take());
-        }
+        relocate(_buf + index, _buf + index + 1, _len - index - 1);
         _len--;
         return ret;
     }
@@ -211,10 +250,11 @@ struct Buf {
             panic("index + count out of bounds");
         }
 
-        for (usize i = index; i < _len - count; i++) {
-            _buf[i].ctor(_buf[i + count].take());
+        for (usize i = index; i < index + count; i++) {
+            _buf[i].dtor();
         }
 
+        relocate(_buf + index, _buf + index + count, _len - index - count);
         _len -= count;
     }
 
@@ -243,7 +283,10 @@ struct Buf {
         _len = newLen;
     }
 
-    T *take() {
+    // Only heap buffers can be taken, they must be freed with delete[].
+    T *take()
+        requires Meta::Same<A, HeapAlloc>
+    {
         T *ret = buf();
         _buf = nullptr;
         _cap = 0;
@@ -289,6 +332,8 @@ template <typename T, usize N>
 struct InlineBuf {
     using Inner = T;
 
+    static constexpr bool RELOCATABLE = Meta::TriviallyRelocatable<T>;
+
     Array<Inert<T>, N> _buf = {};
     usize _len = {};
 
@@ -310,7 +355,7 @@ struct InlineBuf {
         }
     }
 
-    InlineBuf(Sliceable<T> auto &other) {
+    InlineBuf(Sliceable<T> auto const &other) {
         _len = other.len();
 
         if (_len > N) {
@@ -370,9 +415,7 @@ struct InlineBuf {
             panic("cap too large");
         }
 
-        for (usize i = _len; i > index; i--) {
-            _buf[i].ctor(_buf[i - 1].take());
-        }
+        relocate(_buf.buf() + index + 1, _buf.buf() + index, _len - index);
 
         _buf[index].ctor(std::forward<Args>(args)...);
         _len++;
@@ -383,25 +426,37 @@ struct InlineBuf {
             panic("cap too large");
         }
 
-        for (usize i = _len; i > index; i--) {
-            _buf[i].ctor(_buf[i - 1].take());
-        }
+        relocate(_buf.buf() + index + 1, _buf.buf() + index, _len - index);
 
         _buf[index].ctor(std::move(value));
         _len++;
     }
 
-    void insert(Copy, usize index, T *first, usize count) {
+    bool _aliases(T const *ptr) const {
+        return (void const *)ptr >= (void const *)_buf.buf() and
+               (void const *)ptr < (void const *)(_buf.buf() + _len);
+    }
+
+    void insert(Copy, usize index, T const *first, usize count) {
         if (_len + count > N) {
             panic("cap too large");
         }
 
-        for (usize i = _len; i > index; i--) {
-            _buf[i] = _buf[i - count];
-        }
+        bool aliased = _aliases(first);
+        usize from = aliased ? first - buf() : 0;
+
+        relocate(_buf.buf() + index + count, _buf.buf() + index, _len - index);
 
         for (usize i = 0; i < count; i++) {
-            _buf[index + i] = first[i];
+            if (not aliased) {
+                _buf[index + i].ctor(first[i]);
+                continue;
+            }
+
+            // The elements come from this buffer, those past the insertion
+            // point were shifted along with the tail.
+            usize at = from + i;
+            _buf[index + i].ctor(_buf[at < index ? at : at + count].unwrap());
         }
 
         _len += count;
@@ -412,12 +467,10 @@ struct InlineBuf {
             panic("cap too large");
         }
 
-        for (usize i = _len; i > index; i--) {
-            _buf[i] = std::move<T>(_buf[i - count]);
-        }
+        relocate(_buf.buf() + index + count, _buf.buf() + index, _len - index);
 
         for (usize i = 0; i < count; i++) {
-            _buf[index + i] = std::move(first[i]);
+            _buf[index + i].ctor(std::move(first[i]));
         }
 
         _len += count;
@@ -425,9 +478,7 @@ struct InlineBuf {
 
     T removeAt(usize index) {
         T tmp = _buf[index].take();
-        for (usize i = index; i < _len - 1; i++) {
-            _buf[i].ctor(_buf[i + 1].take());
-        }
+        relocate(_buf.buf() + index, _buf.buf() + index + 1, _len - index - 1);
         _len--;
         return tmp;
     }
@@ -537,9 +588,7 @@ struct ViewBuf {
     void emplace(usize index, Args &&...args) {
         ensure(_len + 1);
 
-        for (usize i = _len; i > index; i--) {
-            _buf[i].ctor(_buf[i - 1].take());
-        }
+        relocate(_buf + index + 1, _buf + index, _len - index);
         _buf[index].ctor(std::forward<Args>(args)...);
         _len++;
     }
@@ -547,9 +596,7 @@ struct ViewBuf {
     void insert(usize index, T &&value) {
         ensure(_len + 1);
 
-        for (usize i = _len; i > index; i--) {
-            _buf[i].ctor(_buf[i - 1].take());
-        }
+        relocate(_buf + index + 1, _buf + index, _len - index);
 
         _buf[index].ctor(std::move(value));
         _len++;
@@ -565,15 +612,29 @@ struct ViewBuf {
         _buf[index].ctor(std::move(value));
     }
 
-    void insert(Copy, usize index, T *first, usize count) {
+    bool _aliases(T const *ptr) const {
+        return (void const *)ptr >= (void const *)_buf and
+               (void const *)ptr < (void const *)(_buf + _len);
+    }
+
+    void insert(Copy, usize index, T const *first, usize count) {
         ensure(_len + count);
 
-        for (usize i = _len; i > index; i--) {
-            _buf[i].ctor(_buf[i - count].take());
-        }
+        bool aliased = _aliases(first);
+        usize from = aliased ? first - buf() : 0;
+
+        relocate(_buf + index + count, _buf + index, _len - index);
 
         for (usize i = 0; i < count; i++) {
-            _buf[index + i].ctor(first[i]);
+            if (not aliased) {
+                _buf[index + i].ctor(first[i]);
+                continue;
+            }
+
+            // The elements come from this buffer, those past the insertion
+            // point were shifted along with the tail.
+            usize at = from + i;
+            _buf[index + i].ctor(_buf[at < index ? at : at + count].unwrap());
         }
 
         _len += count;
@@ -582,9 +643,7 @@ struct ViewBuf {
     void insert(Move, usize index, T *first, usize count) {
         ensure(_len + count);
 
-        for (usize i = _len; i > index; i--) {
-            _buf[i].ctor(_buf[i - count].take());
-        }
+        relocate(_buf + index + count, _buf + index, _len - index);
 
         for (usize i = 0; i < count; i++) {
             _buf[index + i].ctor(std::move(first[i]));
@@ -599,9 +658,7 @@ struct ViewBuf {
         }
 
         T ret = _buf[index].take();
-        for (usize i = index; i < _len - 1; i++) {
-            _buf[i].ctor(_buf[i + 1].take());
-        }
+        relocate(_buf + index, _buf + index + 1, _len - index - 1);
         _len--;
         return ret;
     }
@@ -615,10 +672,12 @@ struct ViewBuf {
             panic("index + count out of bounds");
         }
 
-        for (usize i = index; i < _len - count; i++) {
-            _buf[i].ctor(_buf[i + count].take());
+        for (usize i = index; i < index + count; i++) {
+            _buf[i].dtor();
         }
 
+        relocate(_buf + index, _buf + index + count, _len - index - count);
+
         _len -= count;
     }
 
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <karm-meta/traits.h>
+
+#include "cons.h"
+#include "slice.h"
+#include "tuple.h"
+
+namespace Karm {
+
+/* --- Hash Functions ------------------------------------------------------- */
+
+// Finalizer from MurmurHash3, spreads the entropy to all the bits, hash
+// tables take their bucket index and their tag from different bits.
+ALWAYS_INLINE constexpr u64 hashMix(u64 h) {
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccduLL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53uLL;
+    h ^= h >> 33;
+    return h;
+}
+
+ALWAYS_INLINE constexpr u64 hashCombine(u64 seed, u64 h) {
+    return hashMix(seed ^ (h + 0x9e3779b97f4a7c15uLL + (seed << 6) + (seed >> 2)));
+}
+
+inline u64 hashBytes(void const *buf, usize len) {
+    // FNV-1a
+    u64 h = 0xcbf29ce484222325uLL;
+    auto const *bytes = static_cast<u8 const *>(buf);
+    for (usize i = 0; i < len; i++) {
+        h ^= bytes[i];
+        h *= 0x100000001b3uLL;
+    }
+    return hashMix(h);
+}
+
+/* --- Hash Trait ----------------------------------------------------------- */
+
+/// Types can be made hashable by providing a `u64 hash() const` member, it
+/// must be consistent with `cmp()`, equal values have equal hashes.
+template <typename T>
+concept MemberHashable = requires(T const &v) {
+    { v.hash() } -> Meta::Same<u64>;
+};
+
+template <typename T>
+    requires Meta::Integral<T> or Meta::Enum<T>
+ALWAYS_INLINE constexpr u64 hash(T v) {
+    return hashMix((u64)v);
+}
+
+template <Meta::Float T>
+ALWAYS_INLINE u64 hash(T v) {
+    // Make sure 0.0 and -0.0 hash the same since they compare equal.
+    if (v == 0)
+        v = 0;
+    return hashBytes(&v, sizeof(T));
+}
+
+template <typename T>
+ALWAYS_INLINE u64 hash(T const *v) {
+    return hashMix((u64)(usize)v);
+}
+
+template <MemberHashable T>
+ALWAYS_INLINE u64 hash(T const &v) {
+    return v.hash();
+}
+
+template <Sliceable S>
+    requires(not MemberHashable<S>)
+ALWAYS_INLINE u64 hash(S const &s) {
+    using U = typename S::Inner;
+    if constexpr (Meta::Integral<U>) {
+        // Str and String hash the same so they can be used interchangeably
+        // as keys.
+        return hashBytes(s.buf(), s.len() * sizeof(U));
+    } else {
+        u64 h = hashMix(s.len());
+        for (usize i = 0; i < s.len(); i++)
+            h = hashCombine(h, hash(s[i]));
+        return h;
+    }
+}
+
+template <typename Car, typename Cdr>
+ALWAYS_INLINE u64 hash(Cons<Car, Cdr> const &c) {
+    return hashCombine(hash(c.car), hash(c.cdr));
+}
+
+template <typename... Ts>
+ALWAYS_INLINE u64 hash(Tuple<Ts...> const &t) {
+    u64 h = hashMix(sizeof...(Ts));
+    t.visit([&](auto const &v) {
+        h = hashCombine(h, hash(v));
+    });
+    return h;
+}
+
+template <typename T>
+concept Hashable = requires(T const &v) {
+    { hash(v) } -> Meta::Same<u64>;
+};
+
+} // namespace Karm
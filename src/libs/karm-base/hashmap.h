@@ -0,0 +1,391 @@
+#pragma once
+
+#ifdef __SSE2__
+#    include <emmintrin.h>
+#endif
+
+#include "buf.h"
+#include "clamp.h"
+#include "cons.h"
+#include "hash.h"
+#include "inert.h"
+#include "iter.h"
+#include "opt.h"
+#include "panic.h"
+
+namespace Karm {
+
+/* --- Control Bytes -------------------------------------------------------- */
+
+// Every slot of a hash table has a control byte, it's either EMPTY, DELETED
+// or the 7 low bits of the hash of the key stored in the slot. Lookups scan
+// a whole group of control bytes at once and only compare the keys of the
+// slots with a matching tag.
+struct _HashGroup {
+    static constexpr usize SIZE = 16;
+    static constexpr i8 EMPTY = -128;
+    static constexpr i8 DELETED = -2;
+
+#ifdef __SSE2__
+    __m128i _ctrl;
+
+    ALWAYS_INLINE _HashGroup(i8 const *ctrl)
+        : _ctrl(_mm_loadu_si128(reinterpret_cast<__m128i const *>(ctrl))) {}
+
+    ALWAYS_INLINE u32 match(i8 tag) const {
+        return _mm_movemask_epi8(_mm_cmpeq_epi8(_ctrl, _mm_set1_epi8(tag)));
+    }
+
+    // EMPTY and DELETED are the only control bytes smaller than -1.
+    ALWAYS_INLINE u32 matchFree() const {
+        return _mm_movemask_epi8(_mm_cmpgt_epi8(_mm_set1_epi8(-1), _ctrl));
+    }
+#else
+    i8 const *_ctrl;
+
+    ALWAYS_INLINE _HashGroup(i8 const *ctrl)
+        : _ctrl(ctrl) {}
+
+    ALWAYS_INLINE u32 match(i8 tag) const {
+        u32 mask = 0;
+        for (usize i = 0; i < SIZE; i++)
+            mask |= (u32)(_ctrl[i] == tag) << i;
+        return mask;
+    }
+
+    ALWAYS_INLINE u32 matchFree() const {
+        u32 mask = 0;
+        for (usize i = 0; i < SIZE; i++)
+            mask |= (u32)(_ctrl[i] < -1) << i;
+        return mask;
+    }
+#endif
+
+    ALWAYS_INLINE u32 matchEmpty() const {
+        return match(EMPTY);
+    }
+
+    ALWAYS_INLINE static usize first(u32 mask) {
+        return __builtin_ctz(mask);
+    }
+};
+
+/* --- HashMap -------------------------------------------------------------- */
+
+/// An open-addressing hash map, the keys must be `Hashable` and comparable
+/// with `Op::eq()`. Lookups accept any key type that hashes and compares
+/// the same as `K` (e.g. a `Str` for a `String` key).
+/// Iteration order is unspecified.
+template <typename K, typename V>
+struct HashMap {
+    using Item = Cons<K, V>;
+
+    static constexpr bool RELOCATABLE = true;
+    static constexpr usize GROUP = _HashGroup::SIZE;
+
+    i8 *_ctrl{};
+    Inert<Item> *_slots{};
+    usize _cap{}; // Zero or a power of two multiple of GROUP
+    usize _len{};
+    usize _deleted{};
+
+    HashMap() = default;
+
+    HashMap(std::initializer_list<Item> list) {
+        reserve(list.size());
+        for (auto const &item : list)
+            put(item.car, item.cdr);
+    }
+
+    HashMap(HashMap const &other)
+        : _cap(other._cap), _len(other._len), _deleted(other._deleted) {
+        if (not _cap)
+            return;
+
+        _ctrl = new i8[_cap];
+        memcpy(_ctrl, other._ctrl, _cap);
+        _slots = new Inert<Item>[_cap];
+        for (usize i = 0; i < _cap; i++) {
+            if (_ctrl[i] >= 0)
+                _slots[i].ctor(other._slots[i].unwrap());
+        }
+    }
+
+    HashMap(HashMap &&other) {
+        std::swap(_ctrl, other._ctrl);
+        std::swap(_slots, other._slots);
+        std::swap(_cap, other._cap);
+        std::swap(_len, other._len);
+        std::swap(_deleted, other._deleted);
+    }
+
+    ~HashMap() {
+        clear();
+        delete[] _ctrl;
+        delete[] _slots;
+    }
+
+    HashMap &operator=(HashMap const &other) {
+        *this = HashMap(other);
+        return *this;
+    }
+
+    HashMap &operator=(HashMap &&other) {
+        std::swap(_ctrl, other._ctrl);
+        std::swap(_slots, other._slots);
+        std::swap(_cap, other._cap);
+        std::swap(_len, other._len);
+        std::swap(_deleted, other._deleted);
+        return *this;
+    }
+
+    /* --- Probing ---------------------------------------------------------- */
+
+    ALWAYS_INLINE static i8 _tag(u64 h) {
+        return h & 0x7f;
+    }
+
+    // Groups are visited in triangular order, since the number of groups is
+    // a power of two this visits every one of them exactly once.
+    ALWAYS_INLINE Opt<usize> _find(auto const &key, u64 h) const {
+        if (not _cap)
+            return NONE;
+
+        usize mask = _cap / GROUP - 1;
+        usize g = (h >> 7) & mask;
+        for (usize i = 0; i <= mask; i++) {
+            g = (g + i) & mask;
+            _HashGroup group{_ctrl + g * GROUP};
+
+            for (u32 m = group.match(_tag(h)); m; m &= m - 1) {
+                usize slot = g * GROUP + _HashGroup::first(m);
+                if (Op::eq(_slots[slot].unwrap().car, key))
+                    return slot;
+            }
+
+            if (group.matchEmpty())
+                return NONE;
+        }
+
+        return NONE;
+    }
+
+    ALWAYS_INLINE usize _findFree(u64 h) const {
+        usize mask = _cap / GROUP - 1;
+        usize g = (h >> 7) & mask;
+        for (usize i = 0; i <= mask; i++) {
+            g = (g + i) & mask;
+            _HashGroup group{_ctrl + g * GROUP};
+            if (u32 m = group.matchFree())
+                return g * GROUP + _HashGroup::first(m);
+        }
+
+        panic("hashmap is full");
+    }
+
+    static usize _capFor(usize len) {
+        usize cap = GROUP;
+        while (cap * 7 < len * 8)
+            cap *= 2;
+        return cap;
+    }
+
+    void _rehash(usize cap) {
+        i8 *ctrl = _ctrl;
+        Inert<Item> *slots = _slots;
+        usize oldCap = _cap;
+
+        _ctrl = new i8[cap];
+        memset(_ctrl, _HashGroup::EMPTY, cap);
+        _slots = new Inert<Item>[cap];
+        _cap = cap;
+        _deleted = 0;
+
+        for (usize i = 0; i < oldCap; i++) {
+            if (ctrl[i] < 0)
+                continue;
+
+            u64 h = hash(slots[i].unwrap().car);
+            usize slot = _findFree(h);
+            _ctrl[slot] = _tag(h);
+            relocate(&_slots[slot], &slots[i], 1);
+        }
+
+        delete[] ctrl;
+        delete[] slots;
+    }
+
+    Item &_insert(u64 h, K key, V value) {
+        if ((_len + _deleted + 1) * 8 > _cap * 7) {
+            // Mostly tombstones, clean them up in place instead of growing.
+            if (_cap and _len * 2 < _cap)
+                _rehash(_cap);
+            else
+                _rehash(max(_cap * 2, GROUP));
+        }
+
+        usize slot = _findFree(h);
+        if (_ctrl[slot] == _HashGroup::DELETED)
+            _deleted--;
+
+        _ctrl[slot] = _tag(h);
+        _slots[slot].ctor(Item{std::move(key), std::move(value)});
+        _len++;
+        return _slots[slot].unwrap();
+    }
+
+    /* --- Map -------------------------------------------------------------- */
+
+    void put(K const &key, V const &value) {
+        u64 h = hash(key);
+        if (auto slot = _find(key, h)) {
+            _slots[*slot].unwrap().cdr = value;
+            return;
+        }
+        _insert(h, key, value);
+    }
+
+    Opt<V> get(auto const &key) const {
+        if (auto slot = _find(key, hash(key)))
+            return _slots[*slot].unwrap().cdr;
+        return NONE;
+    }
+
+    /// Returns a pointer to the value of `key`, or nullptr if it's not in
+    /// the map. The pointer is invalidated by the next insertion.
+    V *access(auto const &key) {
+        if (auto slot = _find(key, hash(key)))
+            return &_slots[*slot].unwrap().cdr;
+        return nullptr;
+    }
+
+    V &getOrDefault(K const &key, V const &fallback = {}) {
+        u64 h = hash(key);
+        if (auto slot = _find(key, h))
+            return _slots[*slot].unwrap().cdr;
+        return _insert(h, key, fallback).cdr;
+    }
+
+    bool has(auto const &key) const {
+        return _find(key, hash(key)).has();
+    }
+
+    bool remove(auto const &key) {
+        auto slot = _find(key, hash(key));
+        if (not slot)
+            return false;
+
+        _slots[*slot].dtor();
+        _len--;
+
+        // If the group still has an empty slot no probe sequence ever went
+        // past it, the slot can be reused without leaving a tombstone.
+        _HashGroup group{_ctrl + (*slot / GROUP) * GROUP};
+        if (group.matchEmpty()) {
+            _ctrl[*slot] = _HashGroup::EMPTY;
+        } else {
+            _ctrl[*slot] = _HashGroup::DELETED;
+            _deleted++;
+        }
+
+        return true;
+    }
+
+    void reserve(usize len) {
+        usize cap = _capFor(len);
+        if (cap > _cap)
+            _rehash(cap);
+    }
+
+    void clear() {
+        for (usize i = 0; i < _cap; i++) {
+            if (_ctrl[i] >= 0)
+                _slots[i].dtor();
+        }
+
+        if (_cap)
+            memset(_ctrl, _HashGroup::EMPTY, _cap);
+
+        _len = 0;
+        _deleted = 0;
+    }
+
+    usize len() const {
+        return _len;
+    }
+
+    auto iter() {
+        return Iter([this, i = 0uz]() mutable -> Item * {
+            for (; i < _cap; i++) {
+                if (_ctrl[i] >= 0)
+                    return &_slots[i++].unwrap();
+            }
+            return nullptr;
+        });
+    }
+
+    auto iter() const {
+        return Iter([this, i = 0uz]() mutable -> Item const * {
+            for (; i < _cap; i++) {
+                if (_ctrl[i] >= 0)
+                    return &_slots[i++].unwrap();
+            }
+            return nullptr;
+        });
+    }
+};
+
+/* --- HashSet -------------------------------------------------------------- */
+
+template <typename T>
+struct HashSet {
+    static constexpr bool RELOCATABLE = true;
+
+    HashMap<T, None> _map;
+
+    HashSet() = default;
+
+    HashSet(std::initializer_list<T> list) {
+        reserve(list.size());
+        for (auto const &v : list)
+            put(v);
+    }
+
+    void put(T const &value) {
+        u64 h = hash(value);
+        if (not _map._find(value, h))
+            _map._insert(h, value, NONE);
+    }
+
+    bool has(auto const &value) const {
+        return _map.has(value);
+    }
+
+    bool remove(auto const &value) {
+        return _map.remove(value);
+    }
+
+    void reserve(usize len) {
+        _map.reserve(len);
+    }
+
+    void clear() {
+        _map.clear();
+    }
+
+    usize len() const {
+        return _map.len();
+    }
+
+    auto iter() const {
+        return Iter([this, i = 0uz]() mutable -> T const * {
+            for (; i < _map._cap; i++) {
+                if (_map._ctrl[i] >= 0)
+                    return &_map._slots[i++].unwrap().car;
+            }
+            return nullptr;
+        });
+    }
+};
+
+} // namespace Karm
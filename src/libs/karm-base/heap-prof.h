@@ -0,0 +1,180 @@
+#pragma once
+
+#include "array.h"
+#include "atomic.h"
+#include "clamp.h"
+#include "endian.h"
+#include "lock.h"
+#include "size.h"
+
+namespace Karm {
+
+/* --- Heap Profiler -------------------------------------------------------- */
+
+// Counters for the global heap, fed by the operator new and delete of the
+// impl layers when the target sets the `karm-base-heap-prof` prop. Every
+// allocation is counted, call sites are only captured once every
+// SAMPLE_RATE bytes so the overhead stays flat on allocation heavy code.
+// Nothing in here allocates.
+struct HeapProf {
+    static constexpr usize CLASSES = 32; // Power of two size classes
+    static constexpr usize SITES = 1024;
+    static constexpr isize SAMPLE_RATE = kib(64);
+    static constexpr u32 MAGIC = 0x3150484b; // "KHP1"
+
+    struct Site {
+        usize addr;
+        usize samples;
+        usize bytes;
+    };
+
+    Atomic<usize> _allocs{};
+    Atomic<usize> _frees{};
+    Atomic<usize> _live{};
+    Atomic<usize> _peak{};
+    Array<Atomic<usize>, CLASSES> _classes{};
+
+    Atomic<isize> _countdown{};
+    Lock _sitesLock{};
+    Array<Site, SITES> _sites{};
+    usize _dropped = 0; // Samples that didn't fit in the site table
+
+    static usize classOf(usize size) {
+        return size ? 64 - __builtin_clzll(size) - 1 : 0;
+    }
+
+    void _sample(usize size, usize addr) {
+        LockScope scope(_sitesLock);
+
+        usize i = (addr >> 4) % SITES;
+        for (usize probe = 0; probe < SITES; probe++) {
+            auto &site = _sites[(i + probe) % SITES];
+            if (site.addr == addr or site.addr == 0) {
+                site.addr = addr;
+                site.samples++;
+                site.bytes += size;
+                return;
+            }
+        }
+
+        _dropped++;
+    }
+
+    void onAlloc(usize size, usize addr) {
+        _allocs.inc(RELAXED);
+        _classes[min(classOf(size), CLASSES - 1)].inc(RELAXED);
+
+        usize live = _live.fetchAdd(size, RELAXED) + size;
+        usize peak = _peak.load(RELAXED);
+        while (live > peak and not _peak.cmpxchg(peak, live, RELAXED))
+            peak = _peak.load(RELAXED);
+
+        if (_countdown.fetchSub(size, RELAXED) <= 0) {
+            _countdown.store(SAMPLE_RATE, RELAXED);
+            _sample(size, addr);
+        }
+    }
+
+    void onFree(usize size) {
+        _frees.inc(RELAXED);
+        _live.fetchSub(size, RELAXED);
+    }
+
+    /* --- Queries ---------------------------------------------------------- */
+
+    usize allocs() { return _allocs.load(RELAXED); }
+
+    usize frees() { return _frees.load(RELAXED); }
+
+    usize live() { return _live.load(RELAXED); }
+
+    usize peak() { return _peak.load(RELAXED); }
+
+    usize allocsOfClass(usize cls) { return _classes[cls].load(RELAXED); }
+
+    /// Writes a summary to `write`, which is called with `Bytes` chunks.
+    /// All fields are little endian u64 unless noted:
+    ///
+    ///     u32 magic "KHP1", u32 site count
+    ///     allocs, frees, live, peak, sample rate, dropped samples
+    ///     CLASSES allocation counts, class `n` holds sizes in [2^n, 2^(n+1))
+    ///     site count times: return address, samples, sampled bytes
+    void dump(auto write) {
+        LockScope scope(_sitesLock);
+
+        usize sites = 0;
+        for (auto &site : _sites)
+            sites += site.addr != 0;
+
+        auto word = [&](usize v) {
+            write(u64le(v).bytes());
+        };
+
+        write(u32le(MAGIC).bytes());
+        write(u32le(sites).bytes());
+        word(allocs());
+        word(frees());
+        word(live());
+        word(peak());
+        word(SAMPLE_RATE);
+        word(_dropped);
+
+        for (usize i = 0; i < CLASSES; i++)
+            word(allocsOfClass(i));
+
+        for (auto &site : _sites) {
+            if (site.addr == 0)
+                continue;
+            word(site.addr);
+            word(site.samples);
+            word(site.bytes);
+        }
+    }
+};
+
+// Constant initialized, operator new may be called before any constructor.
+inline constinit HeapProf _heapProf{};
+
+inline HeapProf &heapProf() {
+    return _heapProf;
+}
+
+/* --- Allocation Hooks ----------------------------------------------------- */
+
+// The hooks prefix each block with its size so unsized deletes can be
+// accounted for. Without the prop they compile down to nothing and the impl
+// layers allocate exactly what was requested.
+#ifdef __ck_karm_base_heap_prof__
+static constexpr usize HEAP_PROF_HEADER = 16;
+#else
+static constexpr usize HEAP_PROF_HEADER = 0;
+#endif
+
+/// Accounts for a block of `size + HEAP_PROF_HEADER` bytes at `raw` and
+/// returns the pointer to hand to the caller. `addr` is the call site.
+ALWAYS_INLINE inline void *heapProfAlloc(void *raw, [[maybe_unused]] usize size, [[maybe_unused]] void *addr) {
+#ifdef __ck_karm_base_heap_prof__
+    if (not raw)
+        return nullptr;
+    *static_cast<usize *>(raw) = size;
+    heapProf().onAlloc(size, reinterpret_cast<usize>(addr));
+    return static_cast<u8 *>(raw) + HEAP_PROF_HEADER;
+#else
+    return raw;
+#endif
+}
+
+/// Accounts for the release of `ptr` and returns the block to free.
+ALWAYS_INLINE inline void *heapProfFree(void *ptr) {
+#ifdef __ck_karm_base_heap_prof__
+    if (not ptr)
+        return nullptr;
+    void *raw = static_cast<u8 *>(ptr) - HEAP_PROF_HEADER;
+    heapProf().onFree(*static_cast<usize *>(raw));
+    return raw;
+#else
+    return ptr;
+#endif
+}
+
+} // namespace Karm
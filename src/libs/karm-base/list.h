@@ -4,13 +4,16 @@
 #include "iter.h"
 #include "opt.h"
 #include "rc.h"
+#include "slab.h"
 #include "std.h"
 
 namespace Karm {
 
+/// A doubly linked list, the nodes are allocated from slabs if `T` opts in
+/// with `static constexpr bool SLAB = true`.
 template <typename T>
 struct List {
-    struct Node {
+    struct Node : public SlabNew<Slabbed<T>> {
         T buf;
         Node *next = nullptr;
         Node *prev = nullptr;
@@ -351,6 +354,44 @@ struct List {
         _tail = n;
     }
 
+    /* --- Nodes --- */
+
+    void _unlink(Node *node) {
+        if (node->prev) {
+            node->prev->next = node->next;
+        } else {
+            _head = node->next;
+        }
+
+        if (node->next) {
+            node->next->prev = node->prev;
+        } else {
+            _tail = node->prev;
+        }
+
+        node->prev = nullptr;
+        node->next = nullptr;
+    }
+
+    /// Moves `node` to the back of the list, in constant time.
+    void moveBack(Node *node) {
+        if (node == _tail) {
+            return;
+        }
+
+        _unlink(node);
+        node->prev = _tail;
+        _tail->next = node;
+        _tail = node;
+    }
+
+    /// Removes `node` from the list, in constant time.
+    void removeNode(Node *node) {
+        _unlink(node);
+        delete node;
+        _len--;
+    }
+
     /* --- Iteration --- */
 
     template <typename Self>
@@ -16,6 +16,8 @@ struct Opt;
 
 template <typename T>
 struct [[nodiscard]] Opt {
+    static constexpr bool RELOCATABLE = Meta::TriviallyRelocatable<T>;
+
     bool _present = false;
     Inert<T> _value{};
 
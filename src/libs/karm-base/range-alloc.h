@@ -1,89 +1,301 @@
 #pragma once
 
+#include <karm-meta/nocopy.h>
+
+#include "align.h"
+#include "checked.h"
+#include "opt.h"
 #include "range.h"
 #include "res.h"
-#include "vec.h"
+#include "slab.h"
 
 namespace Karm {
 
-template <typename R = USizeRange>
-struct RangeAlloc {
-    Vec<R> _r;
+/* --- Range Tree ----------------------------------------------------------- */
 
-    void used(R range) {
-        for (usize i = 0; i < _r.len(); i++) {
-            R curr = _r[i];
+// Free ranges are kept in two treaps sharing the same nodes, one ordered by
+// address to find neighbours when coalescing, and one ordered by size to
+// find the best fit. Both are O(log n) expected for every operation. The
+// nodes come from the slab allocator, they are small and churn a lot.
+template <typename R>
+struct _RangeNode : public SlabNew<true> {
+    R range;
+    u64 prio;
+    _RangeNode *byAddr[2] = {};
+    _RangeNode *bySize[2] = {};
 
-            if (Op::eq(curr, range)) {
-                _r.removeAt(i);
-                break;
-            }
+    _RangeNode(R range, u64 prio)
+        : range(range), prio(prio) {}
+};
 
-            if (curr.overlaps(range)) {
-                R lh = curr.halfUnder(range);
-                R uh = curr.halfOver(range);
+template <typename R, auto KIDS, auto LESS>
+struct _RangeTreap {
+    using Node = _RangeNode<R>;
+
+    Node *_root = nullptr;
+
+    static Node *&_kid(Node *n, usize i) {
+        return (n->*KIDS)[i];
+    }
+
+    // Splits `t` into the nodes ordered before `key` and the others.
+    static void _split(Node *t, Node const *key, Node *&l, Node *&r) {
+        if (not t) {
+            l = r = nullptr;
+        } else if (LESS(t, key)) {
+            _split(_kid(t, 1), key, _kid(t, 1), r);
+            l = t;
+        } else {
+            _split(_kid(t, 0), key, l, _kid(t, 0));
+            r = t;
+        }
+    }
+
+    static Node *_merge(Node *l, Node *r) {
+        if (not l)
+            return r;
+        if (not r)
+            return l;
+
+        if (l->prio > r->prio) {
+            _kid(l, 1) = _merge(_kid(l, 1), r);
+            return l;
+        }
+
+        _kid(r, 0) = _merge(l, _kid(r, 0));
+        return r;
+    }
 
-                if (lh.size != 0) {
-                    _r[i] = lh;
+    void insert(Node *n) {
+        _kid(n, 0) = _kid(n, 1) = nullptr;
+        Node *l, *r;
+        _split(_root, n, l, r);
+        _root = _merge(_merge(l, n), r);
+    }
+
+    void remove(Node *n) {
+        Node **link = &_root;
+        while (*link != n)
+            link = &_kid(*link, LESS(*link, n) ? 1 : 0);
+        *link = _merge(_kid(n, 0), _kid(n, 1));
+    }
 
-                    if (uh.size != 0) {
-                        unused(uh);
-                    }
-                } else if (uh.size != 0) {
-                    _r[i] = uh;
-                }
+    /// First node that is not ordered before `key`.
+    Node *lowerBound(Node const *key) const {
+        Node *res = nullptr;
+        Node *t = _root;
+        while (t) {
+            if (LESS(t, key)) {
+                t = _kid(t, 1);
+            } else {
+                res = t;
+                t = _kid(t, 0);
             }
         }
+        return res;
     }
 
-    Res<R> alloc(usize size) {
-        for (usize i = 0; i < _r.len(); i++) {
-            if (_r[i].size == size) {
-                R result = _r[i];
-                _r.removeAt(i);
-                return Ok(result);
+    /// Last node that is ordered before `key`.
+    Node *before(Node const *key) const {
+        Node *res = nullptr;
+        Node *t = _root;
+        while (t) {
+            if (LESS(t, key)) {
+                res = t;
+                t = _kid(t, 1);
+            } else {
+                t = _kid(t, 0);
             }
+        }
+        return res;
+    }
 
-            if (_r[i].size > size) {
-                R result = {_r[i].start, size};
-                _r[i].start += size;
-                _r[i].size -= size;
-                return Ok(result);
+    /// First node ordered after `n`.
+    Node *after(Node const *n) const {
+        Node *res = nullptr;
+        Node *t = _root;
+        while (t) {
+            if (LESS(n, t)) {
+                res = t;
+                t = _kid(t, 0);
+            } else {
+                t = _kid(t, 1);
             }
         }
+        return res;
+    }
+};
+
+/* --- Range Allocator ------------------------------------------------------ */
+
+/// Hands out ranges from a set of free ranges. Allocation is best fit,
+/// freed ranges are coalesced with their neighbours.
+template <typename R = USizeRange>
+struct RangeAlloc :
+    Meta::NoCopy {
+
+    using Node = _RangeNode<R>;
+
+    static bool _lessAddr(Node const *a, Node const *b) {
+        return a->range.start < b->range.start;
+    }
+
+    static bool _lessSize(Node const *a, Node const *b) {
+        if (a->range.size != b->range.size)
+            return a->range.size < b->range.size;
+        return a->range.start < b->range.start;
+    }
+
+    _RangeTreap<R, &Node::byAddr, _lessAddr> _byAddr;
+    _RangeTreap<R, &Node::bySize, _lessSize> _bySize;
+    u64 _seed = 0x9e3779b97f4a7c15;
+    usize _len = 0;
+
+    RangeAlloc() = default;
+
+    RangeAlloc(RangeAlloc &&other)
+        : _byAddr(std::exchange(other._byAddr, {})),
+          _bySize(std::exchange(other._bySize, {})),
+          _seed(other._seed),
+          _len(std::exchange(other._len, 0)) {}
 
-        return Error::outOfMemory();
+    ~RangeAlloc() {
+        while (_byAddr._root)
+            _remove(_byAddr._root);
     }
 
-    void compress(usize start) {
-        while (start + 1 < _r.len() and _r[start].contigous(_r[start + 1])) {
-            _r[start] = _r[start].merge(_r[start + 1]);
-            _r.removeAt(start + 1);
+    /* --- Nodes ------------------------------------------------------------ */
+
+    void _insert(R range) {
+        // xorshift64, the priorities only have to look random.
+        _seed ^= _seed << 13;
+        _seed ^= _seed >> 7;
+        _seed ^= _seed << 17;
+
+        auto *node = new Node{range, _seed};
+        _byAddr.insert(node);
+        _bySize.insert(node);
+        _len++;
+    }
+
+    void _remove(Node *node) {
+        _byAddr.remove(node);
+        _bySize.remove(node);
+        _len--;
+        delete node;
+    }
+
+    /* --- Allocation ------------------------------------------------------- */
+
+    /// Removes `range` from the free ranges, it doesn't have to be free.
+    void used(R range) {
+        if (range.empty())
+            return;
+
+        Node key{range, 0};
+        Node *node = _byAddr.before(&key);
+        if (not node or node->range.end() <= range.start)
+            node = _byAddr.lowerBound(&key);
+
+        while (node and node->range.start < range.end()) {
+            Node *next = _byAddr.after(node);
+
+            if (node->range.overlaps(range)) {
+                R curr = node->range;
+                _remove(node);
+
+                R lh = curr.halfUnder(range);
+                R uh = curr.halfOver(range);
+                if (lh.size != 0)
+                    _insert(lh);
+                if (uh.size != 0)
+                    _insert(uh);
+            }
+
+            node = next;
         }
+    }
+
+    // Aligned allocations try this many of the smallest ranges before
+    // settling for one that fits at any alignment.
+    static constexpr usize ALIGN_PROBES = 8;
 
-        while (start > 0 and _r[start].contigous(_r[start - 1])) {
-            _r[start] = _r[start].merge(_r[start - 1]);
-            _r.removeAt(start - 1);
+    static Opt<R> _fit(Node const *node, usize size, usize align) {
+        usize start = alignUp(node->range.start, align);
+        if (start + size > node->range.end())
+            return NONE;
+        return R{start, size};
+    }
+
+    /// Allocates `size` units starting at a multiple of `align`, from the
+    /// smallest free range that can hold them. When many ranges are too
+    /// badly aligned, it's taken from the smallest range that can hold them
+    /// at any alignment instead.
+    Res<R> alloc(usize size, usize align = 1) {
+        Node key{{0, size}, 0};
+        Node *node = _bySize.lowerBound(&key);
+
+        // Ranges at least `size + align - 1` long always fit, smaller ones
+        // only if their start happens to be aligned well enough. Only the
+        // first few of those are tried, a lot of badly aligned ranges would
+        // make the search linear.
+        for (usize i = 0; node and i < ALIGN_PROBES; i++) {
+            if (auto result = _fit(node, size, align)) {
+                used(*result);
+                return Ok(*result);
+            }
+            node = _bySize.after(node);
         }
+
+        if (not node or align - 1 > MAX<usize> - size)
+            return Error::outOfMemory();
+
+        key.range.size = size + align - 1;
+        node = _bySize.lowerBound(&key);
+        if (not node)
+            return Error::outOfMemory();
+
+        R result = _fit(node, size, align).unwrap();
+        used(result);
+        return Ok(result);
     }
 
+    /// Gives `range` back, it's merged with the free ranges it touches.
     void unused(R range) {
-        for (usize i = 0; i < _r.len(); i++) {
-            if (_r[i].contigous(range)) {
-                _r[i] = _r[i].merge(range);
-                compress(i);
-                return;
-            }
+        if (range.empty())
+            return;
 
-            if (i + 1 < _r.len() &&
-                (_r[i].start < range.start) &&
-                (range.start < _r[i + 1].start)) {
-                _r.insert(i + 1, range);
-                return;
-            }
+        Node key{range, 0};
+
+        Node *prev = _byAddr.before(&key);
+        if (prev and prev->range.end() >= range.start) {
+            range = range.merge(prev->range);
+            _remove(prev);
+        }
+
+        Node *next = _byAddr.lowerBound(&key);
+        while (next and next->range.start <= range.end()) {
+            Node *after = _byAddr.after(next);
+            range = range.merge(next->range);
+            _remove(next);
+            next = after;
         }
 
-        _r.pushBack(range);
+        _insert(range);
+    }
+
+    /* --- Queries ---------------------------------------------------------- */
+
+    /// Number of free ranges.
+    usize len() const {
+        return _len;
+    }
+
+    /// Calls `cb` with every free range, in address order.
+    void visit(auto cb) const {
+        Node key{{0, 0}, 0};
+        for (Node *n = _byAddr.lowerBound(&key); n; n = _byAddr.after(n))
+            cb(n->range);
     }
 };
 
@@ -6,14 +6,18 @@
 #include "opt.h"
 #include "ordr.h"
 #include "ref.h"
+#include "slab.h"
 
 namespace Karm {
 
+// Reference counts are updated without taking a lock, increments are relaxed
+// since a new reference can only be made from an existing one, decrements
+// release so the last owner sees every write made through the others.
 struct _Cell {
-    Lock _lock;
-    bool _clear = false;
-    isize _strong = 0;
-    isize _weak = 0;
+    // All the strong references together hold one weak reference, the cell
+    // is freed once the value is cleared and the last weak reference is gone.
+    Atomic<isize> _strong{0};
+    Atomic<isize> _weak{1};
 
     virtual ~_Cell() = default;
 
@@ -21,70 +25,67 @@ struct _Cell {
     virtual void clear() = 0;
     virtual Meta::Type<> inspect() = 0;
 
-    _Cell *collect() {
-        if (_strong == 0 and not _clear) {
-            clear();
-            _clear = true;
-        }
-
-        if (_strong == 0 and _weak == 0) {
-            _lock.release();
-            delete this;
-            return nullptr;
-        } else {
-            _lock.release();
-            return nullptr;
-        }
-    }
-
     _Cell *refStrong() {
-        LockScope scope{_lock};
-
-        if (_clear)
-            panic("refStrong() called on cleared cell");
-        _strong++;
-        if (_strong < 0)
+        if (_strong.fetchInc(RELAXED) < 0)
             panic("refStrong() overflow");
         return this;
     }
 
-    _Cell *derefStrong() {
-        _lock.acquire();
+    // Only takes a reference if the value is still alive.
+    _Cell *tryRefStrong() {
+        isize strong = _strong.load(RELAXED);
+        while (strong > 0) {
+            if (_strong.cmpxchg(strong, strong + 1, ACQUIRE))
+                return this;
+            strong = _strong.load(RELAXED);
+        }
+        return nullptr;
+    }
 
-        _strong--;
-        if (_strong < 0)
+    _Cell *derefStrong() {
+        isize strong = _strong.fetchDec(RELEASE);
+        if (strong <= 0)
             panic("derefStrong() underflow");
-        return collect();
+
+        if (strong == 1) {
+            memoryBarier(ACQUIRE);
+            clear();
+            derefWeak();
+        }
+
+        return nullptr;
     }
 
     _Cell *refWeak() {
-        LockScope scope{_lock};
-
-        _weak++;
-        if (_weak < 0)
+        if (_weak.fetchInc(RELAXED) < 0)
             panic("refWeak() overflow");
         return this;
     }
 
     _Cell *derefWeak() {
-        _lock.acquire();
-
-        _weak--;
-        if (_weak < 0)
+        isize weak = _weak.fetchDec(RELEASE);
+        if (weak <= 0)
             panic("derefWeak() underflow");
-        return collect();
+
+        if (weak == 1) {
+            memoryBarier(ACQUIRE);
+            delete this;
+        }
+
+        return nullptr;
     }
 
     template <typename T>
     T &unwrap() {
-        if (_clear)
-            panic("unwrap() called on cleared cell");
         return *static_cast<T *>(_unwrap());
     }
 };
 
 template <typename T>
-struct Cell : public _Cell {
+struct Cell :
+    public _Cell,
+    public SlabNew<Slabbed<T>> {
+
     Inert<T> _buf{};
 
     template <typename... Args>
@@ -99,14 +100,17 @@ struct Cell : public _Cell {
 
 template <typename T>
 struct Strong {
+    static constexpr bool RELOCATABLE = true;
+
     _Cell *_cell{};
 
     /* --- Rule of Five ----------------------------------------------------- */
 
     constexpr Strong() = delete;
 
+    /// Takes ownership of a strong reference to `ptr`.
     constexpr Strong(Move, _Cell *ptr)
-        : _cell(ptr->refStrong()) {
+        : _cell(ptr) {
     }
 
     constexpr Strong(Strong const &other)
@@ -224,12 +228,14 @@ struct Strong {
             return NONE;
         }
 
-        return Strong<U>(MOVE, _cell);
+        return Strong<U>(MOVE, _cell->refStrong());
     }
 };
 
 template <typename T>
 struct Weak {
+    static constexpr bool RELOCATABLE = true;
+
     _Cell *_cell;
 
     constexpr Weak() = delete;
@@ -268,15 +274,154 @@ struct Weak {
     }
 
     Opt<Strong<T>> upgrade() const {
-        if (not _cell)
+        if (not _cell or not _cell->tryRefStrong())
             return NONE;
-        return Strong<T>(_cell);
+        return Strong<T>(MOVE, _cell);
     }
 };
 
 template <typename T, typename... Args>
 constexpr static Strong<T> makeStrong(Args &&...args) {
-    return {MOVE, new Cell<T>(std::forward<Args>(args)...)};
+    auto *cell = new Cell<T>(std::forward<Args>(args)...);
+    return {MOVE, cell->refStrong()};
+}
+
+/* --- Intrusive Reference Counting ----------------------------------------- */
+
+/// Base for objects that keep their reference count inline, they are owned
+/// through `Rc<T>` without a separate cell or any virtual call.
+/// The object is deleted as `Crtp`, which needs a virtual destructor if it
+/// has subclasses.
+template <typename Crtp>
+struct RefCounted {
+    Atomic<usize> _refs{};
+
+    void _ref() {
+        _refs.fetchInc(RELAXED);
+    }
+
+    void _deref() {
+        if (_refs.fetchDec(RELEASE) == 1) {
+            memoryBarier(ACQUIRE);
+            delete static_cast<Crtp *>(this);
+        }
+    }
+};
+
+/// Same as `RefCounted` but the count is not atomic, for objects that never
+/// leave the thread they were created on (e.g. UI trees).
+template <typename Crtp>
+struct LocalRefCounted {
+    usize _refs{};
+
+    void _ref() {
+        _refs++;
+    }
+
+    void _deref() {
+        if (--_refs == 0)
+            delete static_cast<Crtp *>(this);
+    }
+};
+
+template <typename T>
+concept IntrusiveRefCounted = requires(T &t) {
+    t._ref();
+    t._deref();
+};
+
+template <IntrusiveRefCounted T>
+struct Rc {
+    static constexpr bool RELOCATABLE = true;
+
+    T *_ptr{};
+
+    /* --- Rule of Five ----------------------------------------------------- */
+
+    constexpr Rc() = delete;
+
+    /// Takes a new reference to `ptr`.
+    explicit constexpr Rc(T *ptr)
+        : _ptr(ptr) {
+        _ptr->_ref();
+    }
+
+    constexpr Rc(Rc const &other)
+        : Rc(other._ptr) {
+    }
+
+    constexpr Rc(Rc &&other)
+        : _ptr(std::exchange(other._ptr, nullptr)) {
+    }
+
+    template <Meta::Derive<T> U>
+    constexpr Rc(Rc<U> const &other)
+        : Rc(other._ptr) {
+    }
+
+    template <Meta::Derive<T> U>
+    constexpr Rc(Rc<U> &&other)
+        : _ptr(std::exchange(other._ptr, nullptr)) {
+    }
+
+    constexpr ~Rc() {
+        if (_ptr)
+            std::exchange(_ptr, nullptr)->_deref();
+    }
+
+    constexpr Rc &operator=(Rc const &other) {
+        *this = Rc(other);
+        return *this;
+    }
+
+    constexpr Rc &operator=(Rc &&other) {
+        std::swap(_ptr, other._ptr);
+        return *this;
+    }
+
+    /* --- Operators -------------------------------------------------------- */
+
+    constexpr T const *operator->() const {
+        return &unwrap();
+    }
+
+    constexpr T *operator->() {
+        return &unwrap();
+    }
+
+    constexpr T const &operator*() const {
+        return unwrap();
+    }
+
+    constexpr T &operator*() {
+        return unwrap();
+    }
+
+    /* --- Methods ---------------------------------------------------------- */
+
+    constexpr T const &unwrap() const {
+        if (not _ptr)
+            panic("null dereference");
+        return *_ptr;
+    }
+
+    constexpr T &unwrap() {
+        if (not _ptr)
+            panic("null dereference");
+        return *_ptr;
+    }
+
+    constexpr Ordr cmp(Rc const &other) const {
+        if (_ptr == other._ptr)
+            return Ordr::EQUAL;
+
+        return ::cmp(unwrap(), other.unwrap());
+    }
+};
+
+template <IntrusiveRefCounted T, typename... Args>
+constexpr static Rc<T> makeRc(Args &&...args) {
+    return Rc<T>(new T(std::forward<Args>(args)...));
 }
 
 } // namespace Karm
@@ -0,0 +1,183 @@
+#pragma once
+
+#include "array.h"
+#include "list.h"
+#include "time.h"
+#include "vec.h"
+
+namespace Karm {
+
+/* --- Run Queue ------------------------------------------------------------ */
+
+/// Entries waiting to run, one FIFO per priority, higher priorities first.
+/// A bitmap of the non-empty queues makes picking the next entry O(1).
+template <typename T, usize PRIOS = 32>
+struct RunQueue {
+    static_assert(PRIOS <= 64, "the queue bitmap is a single word");
+
+    Array<List<T>, PRIOS> _queues;
+    u64 _mask = 0;
+    usize _len = 0;
+
+    void push(usize prio, T value) {
+        _queues[prio].pushBack(std::move(value));
+        _mask |= 1uLL << prio;
+        _len++;
+    }
+
+    /// The highest priority with an entry waiting.
+    Opt<usize> top() const {
+        if (not _mask)
+            return NONE;
+        return 63 - __builtin_clzll(_mask);
+    }
+
+    Opt<T> pop() {
+        auto prio = top();
+        if (not prio)
+            return NONE;
+
+        auto &queue = _queues[*prio];
+        T value = queue.popFront();
+        if (queue.len() == 0)
+            _mask &= ~(1uLL << *prio);
+        _len--;
+        return value;
+    }
+
+    /// Takes out the highest priority entry accepted by `pred`. Each queue
+    /// is searched from the back, where entries have waited the least.
+    Opt<T> steal(auto pred) {
+        u64 mask = _mask;
+        while (mask) {
+            usize prio = 63 - __builtin_clzll(mask);
+            mask &= ~(1uLL << prio);
+
+            auto &queue = _queues[prio];
+            usize i = queue.len();
+            for (auto &value : queue.iterRev()) {
+                i--;
+                if (not pred(value))
+                    continue;
+
+                T res = std::move(value);
+                queue.removeAt(i);
+                if (queue.len() == 0)
+                    _mask &= ~(1uLL << prio);
+                _len--;
+                return res;
+            }
+        }
+
+        return NONE;
+    }
+
+    usize len() const {
+        return _len;
+    }
+};
+
+/* --- Sleep Queue ---------------------------------------------------------- */
+
+/// Entries waiting for a deadline, kept in a binary heap so the earliest
+/// one is always at hand.
+template <typename T>
+struct SleepQueue {
+    struct Entry {
+        TimeStamp deadline;
+        T value;
+    };
+
+    Vec<Entry> _heap;
+
+    bool _before(usize a, usize b) const {
+        return Op::lt(_heap[a].deadline, _heap[b].deadline);
+    }
+
+    void _siftUp(usize i) {
+        while (i > 0) {
+            usize parent = (i - 1) / 2;
+            if (not _before(i, parent))
+                break;
+            std::swap(_heap[i], _heap[parent]);
+            i = parent;
+        }
+    }
+
+    void _siftDown(usize i) {
+        while (true) {
+            usize min = i;
+            usize l = 2 * i + 1;
+            usize r = l + 1;
+
+            if (l < _heap.len() and _before(l, min))
+                min = l;
+            if (r < _heap.len() and _before(r, min))
+                min = r;
+            if (min == i)
+                break;
+
+            std::swap(_heap[i], _heap[min]);
+            i = min;
+        }
+    }
+
+    void push(TimeStamp deadline, T value) {
+        _heap.pushBack({deadline, std::move(value)});
+        _siftUp(_heap.len() - 1);
+    }
+
+    /// The earliest deadline.
+    Opt<TimeStamp> next() const {
+        if (_heap.len() == 0)
+            return NONE;
+        return _heap[0].deadline;
+    }
+
+    /// Takes out the earliest entry if its deadline is at or before `now`.
+    Opt<T> popExpired(TimeStamp now) {
+        if (_heap.len() == 0 or Op::gt(_heap[0].deadline, now))
+            return NONE;
+
+        std::swap(_heap[0], _heap[_heap.len() - 1]);
+        T value = std::move(_heap.popBack().value);
+        if (_heap.len())
+            _siftDown(0);
+        return value;
+    }
+
+    /// Takes out the first entry accepted by `pred`, whatever its deadline.
+    /// Finding it is O(n), taking it out O(log n).
+    Opt<T> remove(auto pred) {
+        for (usize i = 0; i < _heap.len(); i++) {
+            if (not pred(_heap[i].value))
+                continue;
+
+            usize last = _heap.len() - 1;
+            std::swap(_heap[i], _heap[last]);
+            T value = std::move(_heap.popBack().value);
+            if (i < last) {
+                _siftUp(i);
+                _siftDown(i);
+            }
+            return value;
+        }
+
+        return NONE;
+    }
+
+    /// Recomputes every deadline with `fn(value)`, O(n).
+    void update(auto fn) {
+        for (auto &entry : _heap)
+            entry.deadline = fn(entry.value);
+
+        for (usize i = _heap.len() / 2; i > 0; i--)
+            _siftDown(i - 1);
+    }
+
+    usize len() const {
+        return _heap.len();
+    }
+};
+
+} // namespace Karm
@@ -0,0 +1,203 @@
+#pragma once
+
+#include "array.h"
+#include "lock.h"
+#include "size.h"
+
+namespace Karm {
+
+/* --- Slab Classes --------------------------------------------------------- */
+
+// Memory for small objects is carved out of blocks and handed out by size
+// classes, freed objects go back to a free list of their class and are never
+// returned to the heap. Each thread keeps a magazine of free objects per
+// class so most allocations don't touch the shared lock. Freestanding
+// targets have no thread local storage and always go through the lock.
+struct _SlabClass {
+    static constexpr usize BLOCK_SIZE = kib(16);
+
+    struct _Free {
+        _Free *next;
+    };
+
+    usize size;
+    Lock _lock{};
+    _Free *_free = nullptr;
+
+    void _carve() {
+        auto *block = new u8[BLOCK_SIZE];
+        for (usize off = 0; off + size <= BLOCK_SIZE; off += size) {
+            auto *obj = reinterpret_cast<_Free *>(block + off);
+            obj->next = _free;
+            _free = obj;
+        }
+    }
+
+    // Moves `count` objects to `out`, carving new blocks as needed.
+    usize take(void **out, usize count) {
+        LockScope scope(_lock);
+        for (usize i = 0; i < count; i++) {
+            if (not _free)
+                _carve();
+            out[i] = _free;
+            _free = _free->next;
+        }
+        return count;
+    }
+
+    void give(void **in, usize count) {
+        LockScope scope(_lock);
+        for (usize i = 0; i < count; i++) {
+            auto *obj = static_cast<_Free *>(in[i]);
+            obj->next = _free;
+            _free = obj;
+        }
+    }
+};
+
+inline Array<_SlabClass, 10> _slabClasses = {
+    _SlabClass{16},
+    _SlabClass{32},
+    _SlabClass{48},
+    _SlabClass{64},
+    _SlabClass{96},
+    _SlabClass{128},
+    _SlabClass{192},
+    _SlabClass{256},
+    _SlabClass{384},
+    _SlabClass{512},
+};
+
+static constexpr usize SLAB_MAX_SIZE = 512;
+
+// Index of the smallest class that fits `size`, sizes must not be larger
+// than SLAB_MAX_SIZE.
+ALWAYS_INLINE constexpr usize _slabClassOf(usize size) {
+    if (size <= 64)
+        return size ? (size - 1) / 16 : 0;
+    if (size <= 128)
+        return size <= 96 ? 4 : 5;
+    if (size <= 256)
+        return size <= 192 ? 6 : 7;
+    return size <= 384 ? 8 : 9;
+}
+
+/* --- Magazines ------------------------------------------------------------ */
+
+#ifndef __ck_freestanding__
+
+struct _SlabMagazines {
+    static constexpr usize CAP = 32;
+
+    struct Magazine {
+        usize len;
+        void *objs[CAP];
+    };
+
+    Array<Magazine, 10> _mags{};
+    bool _dead = false;
+
+    ~_SlabMagazines() {
+        // Hand the cached objects back when the thread exits, objects freed
+        // after this (e.g. by static destructors) go straight to the class.
+        for (usize i = 0; i < _mags.len(); i++) {
+            auto &mag = _mags[i];
+            _slabClasses[i].give(mag.objs, mag.len);
+            mag.len = 0;
+        }
+        _dead = true;
+    }
+
+    ALWAYS_INLINE void *alloc(usize cls) {
+        auto &mag = _mags[cls];
+        if (mag.len == 0) {
+            if (_dead) {
+                void *ptr;
+                _slabClasses[cls].take(&ptr, 1);
+                return ptr;
+            }
+            mag.len = _slabClasses[cls].take(mag.objs, CAP / 2);
+        }
+        return mag.objs[--mag.len];
+    }
+
+    ALWAYS_INLINE void free(usize cls, void *ptr) {
+        auto &mag = _mags[cls];
+        if (_dead) {
+            _slabClasses[cls].give(&ptr, 1);
+            return;
+        }
+
+        if (mag.len == CAP) {
+            _slabClasses[cls].give(mag.objs + CAP / 2, CAP / 2);
+            mag.len = CAP / 2;
+        }
+        mag.objs[mag.len++] = ptr;
+    }
+};
+
+inline thread_local _SlabMagazines _slabMagazines;
+
+#endif
+
+/* --- Slab Allocation ------------------------------------------------------ */
+
+/// Allocates `size` bytes from the slab class that fits it, or from the heap
+/// for sizes above SLAB_MAX_SIZE. The memory must be freed with `slabFree()`
+/// and the same size.
+ALWAYS_INLINE inline void *slabAlloc(usize size) {
+    if (size > SLAB_MAX_SIZE)
+        return ::operator new(size);
+
+    usize cls = _slabClassOf(size);
+#ifdef __ck_freestanding__
+    void *ptr;
+    _slabClasses[cls].take(&ptr, 1);
+    return ptr;
+#else
+    return _slabMagazines.alloc(cls);
+#endif
+}
+
+ALWAYS_INLINE inline void slabFree(void *ptr, usize size) {
+    if (not ptr)
+        return;
+
+    if (size > SLAB_MAX_SIZE) {
+        ::operator delete(ptr);
+        return;
+    }
+
+    usize cls = _slabClassOf(size);
+#ifdef __ck_freestanding__
+    _slabClasses[cls].give(&ptr, 1);
+#else
+    _slabMagazines.free(cls, ptr);
+#endif
+}
+
+/* --- Opt-in --------------------------------------------------------------- */
+
+/// Types that define `static constexpr bool SLAB = true` are allocated from
+/// slabs by the containers that support it (e.g. `List` nodes and the cells
+/// of `makeStrong()`).
+template <typename T>
+concept Slabbed = requires { requires T::SLAB; };
+
+/// Base class that routes `new` and `delete` of the derived class to the
+/// slab allocator when `ENABLE` is true.
+template <bool ENABLE>
+struct SlabNew {};
+
+template <>
+struct SlabNew<true> {
+    static void *operator new(usize size) {
+        return slabAlloc(size);
+    }
+
+    static void operator delete(void *ptr, usize size) {
+        slabFree(ptr, size);
+    }
+};
+
+} // namespace Karm
@@ -403,36 +403,318 @@ constexpr usize zeroFill(MutSlice<T> slice) {
     return fill(slice, {});
 }
 
-ALWAYS_INLINE constexpr void sort(MutSliceable auto &slice, auto cmp) {
-    if (len(slice) <= 1) {
+/* --- Sorting -------------------------------------------------------------- */
+
+// Pattern-defeating quicksort (Orson Peters), an introsort that falls back to
+// insertion sort for small partitions and to heapsort when it keeps picking
+// bad pivots, so it's O(n log n) in the worst case and never recurses deeper
+// than O(log n). Sorted, reversed and mostly equal inputs run in linear time.
+namespace _Sort {
+
+static constexpr usize INSERTION_THRESHOLD = 24;
+static constexpr usize NINTHER_THRESHOLD = 128;
+static constexpr usize PARTIAL_INSERTION_LIMIT = 8;
+
+template <typename T>
+constexpr void insertionSort(T *begin, T *end, auto &less) {
+    if (begin == end)
         return;
+
+    for (T *curr = begin + 1; curr != end; curr++) {
+        T *sift = curr;
+        T *prev = curr - 1;
+
+        if (less(*sift, *prev)) {
+            T tmp = std::move(*sift);
+            do {
+                *sift-- = std::move(*prev);
+            } while (sift != begin and less(tmp, *--prev));
+            *sift = std::move(tmp);
+        }
     }
+}
 
-    auto pivot = at(slice, len(slice) / 2);
-    auto left = 0uz;
-    auto right = len(slice) - 1;
+// Same as insertionSort() but assumes *(begin - 1) is not greater than any
+// element of the range, which saves a bound check in the inner loop.
+template <typename T>
+constexpr void unguardedInsertionSort(T *begin, T *end, auto &less) {
+    if (begin == end)
+        return;
 
-    while (left <= right) {
-        while (cmp(at(slice, left), pivot).isLt()) {
-            left++;
+    for (T *curr = begin + 1; curr != end; curr++) {
+        T *sift = curr;
+        T *prev = curr - 1;
+
+        if (less(*sift, *prev)) {
+            T tmp = std::move(*sift);
+            do {
+                *sift-- = std::move(*prev);
+            } while (less(tmp, *--prev));
+            *sift = std::move(tmp);
         }
+    }
+}
 
-        while (cmp(at(slice, right), pivot).isGt()) {
-            right--;
+// Gives up and returns false once more than PARTIAL_INSERTION_LIMIT elements
+// have been moved, the range is then only partially sorted.
+template <typename T>
+constexpr bool partialInsertionSort(T *begin, T *end, auto &less) {
+    if (begin == end)
+        return true;
+
+    usize moved = 0;
+    for (T *curr = begin + 1; curr != end; curr++) {
+        T *sift = curr;
+        T *prev = curr - 1;
+
+        if (less(*sift, *prev)) {
+            T tmp = std::move(*sift);
+            do {
+                *sift-- = std::move(*prev);
+            } while (sift != begin and less(tmp, *--prev));
+            *sift = std::move(tmp);
+            moved += curr - sift;
         }
 
-        if (left <= right) {
-            std::swap(at(slice, left), at(slice, right));
-            left++;
-            right--;
+        if (moved > PARTIAL_INSERTION_LIMIT)
+            return false;
+    }
+
+    return true;
+}
+
+template <typename T>
+constexpr void sort2(T *a, T *b, auto &less) {
+    if (less(*b, *a))
+        std::swap(*a, *b);
+}
+
+template <typename T>
+constexpr void sort3(T *a, T *b, T *c, auto &less) {
+    sort2(a, b, less);
+    sort2(b, c, less);
+    sort2(a, b, less);
+}
+
+template <typename T>
+constexpr void siftDown(T *heap, usize i, usize len, auto &less) {
+    while (true) {
+        usize child = i * 2 + 1;
+        if (child >= len)
+            return;
+
+        if (child + 1 < len and less(heap[child], heap[child + 1]))
+            child++;
+
+        if (not less(heap[i], heap[child]))
+            return;
+
+        std::swap(heap[i], heap[child]);
+        i = child;
+    }
+}
+
+template <typename T>
+constexpr void heapSort(T *begin, T *end, auto &less) {
+    usize len = end - begin;
+
+    for (usize i = len / 2; i-- > 0;)
+        siftDown(begin, i, len, less);
+
+    for (usize i = len; i-- > 1;) {
+        std::swap(begin[0], begin[i]);
+        siftDown(begin, 0, i, less);
+    }
+}
+
+// Partitions around the pivot at *begin, elements equal to the pivot go to
+// the right. Returns the final position of the pivot and whether the range
+// was already partitioned.
+template <typename T>
+constexpr T *partitionRight(T *begin, T *end, bool &alreadyPartitioned, auto &less) {
+    T pivot = std::move(*begin);
+    T *first = begin;
+    T *last = end;
+
+    // The median of 3 guarantees an element >= pivot exists, so this can't
+    // run past the end.
+    while (less(*++first, pivot))
+        ;
+
+    if (first - 1 == begin) {
+        while (first < last and not less(*--last, pivot))
+            ;
+    } else {
+        while (not less(*--last, pivot))
+            ;
+    }
+
+    alreadyPartitioned = first >= last;
+
+    while (first < last) {
+        std::swap(*first, *last);
+        while (less(*++first, pivot))
+            ;
+        while (not less(*--last, pivot))
+            ;
+    }
+
+    T *pivotPos = first - 1;
+    *begin = std::move(*pivotPos);
+    *pivotPos = std::move(pivot);
+    return pivotPos;
+}
+
+// Partitions around the pivot at *begin, elements equal to the pivot go to
+// the left. Used when the pivot is equal to the one of the parent partition,
+// all the elements equal to it are then in their final position.
+template <typename T>
+constexpr T *partitionLeft(T *begin, T *end, auto &less) {
+    T pivot = std::move(*begin);
+    T *first = begin;
+    T *last = end;
+
+    while (less(pivot, *--last))
+        ;
+
+    if (last + 1 == end) {
+        while (first < last and not less(pivot, *++first))
+            ;
+    } else {
+        while (not less(pivot, *++first))
+            ;
+    }
+
+    while (first < last) {
+        std::swap(*first, *last);
+        while (less(pivot, *--last))
+            ;
+        while (not less(pivot, *++first))
+            ;
+    }
+
+    T *pivotPos = last;
+    *begin = std::move(*pivotPos);
+    *pivotPos = std::move(pivot);
+    return pivotPos;
+}
+
+template <typename T>
+constexpr void pdqsort(T *begin, T *end, usize badAllowed, bool leftmost, auto &less) {
+    while (true) {
+        usize len = end - begin;
+
+        if (len < INSERTION_THRESHOLD) {
+            if (leftmost)
+                insertionSort(begin, end, less);
+            else
+                unguardedInsertionSort(begin, end, less);
+            return;
+        }
+
+        // Pick the pivot, median of 3 or pseudo median of 9 (ninther) for
+        // larger partitions, and move it to *begin.
+        usize half = len / 2;
+        if (len > NINTHER_THRESHOLD) {
+            sort3(begin, begin + half, end - 1, less);
+            sort3(begin + 1, begin + (half - 1), end - 2, less);
+            sort3(begin + 2, begin + (half + 1), end - 3, less);
+            sort3(begin + (half - 1), begin + half, begin + (half + 1), less);
+            std::swap(*begin, *(begin + half));
+        } else {
+            sort3(begin + half, begin, end - 1, less);
+        }
+
+        // The element before the partition was the pivot of the parent
+        // partition, if it's equal to this pivot, there is no need to sort
+        // the elements equal to it.
+        if (not leftmost and not less(*(begin - 1), *begin)) {
+            begin = partitionLeft(begin, end, less) + 1;
+            continue;
+        }
+
+        bool alreadyPartitioned = false;
+        T *pivotPos = partitionRight(begin, end, alreadyPartitioned, less);
+
+        usize leftLen = pivotPos - begin;
+        usize rightLen = end - (pivotPos + 1);
+
+        if (leftLen < len / 8 or rightLen < len / 8) {
+            if (--badAllowed == 0) {
+                heapSort(begin, end, less);
+                return;
+            }
+
+            // Shuffle some elements around to break the pattern that led to
+            // the bad partition.
+            if (leftLen >= INSERTION_THRESHOLD) {
+                std::swap(*begin, *(begin + leftLen / 4));
+                std::swap(*(pivotPos - 1), *(pivotPos - leftLen / 4));
+
+                if (leftLen > NINTHER_THRESHOLD) {
+                    std::swap(*(begin + 1), *(begin + (leftLen / 4 + 1)));
+                    std::swap(*(begin + 2), *(begin + (leftLen / 4 + 2)));
+                    std::swap(*(pivotPos - 2), *(pivotPos - (leftLen / 4 + 1)));
+                    std::swap(*(pivotPos - 3), *(pivotPos - (leftLen / 4 + 2)));
+                }
+            }
+
+            if (rightLen >= INSERTION_THRESHOLD) {
+                std::swap(*(pivotPos + 1), *(pivotPos + (1 + rightLen / 4)));
+                std::swap(*(end - 1), *(end - rightLen / 4));
+
+                if (rightLen > NINTHER_THRESHOLD) {
+                    std::swap(*(pivotPos + 2), *(pivotPos + (2 + rightLen / 4)));
+                    std::swap(*(pivotPos + 3), *(pivotPos + (3 + rightLen / 4)));
+                    std::swap(*(end - 2), *(end - (1 + rightLen / 4)));
+                    std::swap(*(end - 3), *(end - (2 + rightLen / 4)));
+                }
+            }
+        } else if (alreadyPartitioned and
+                   partialInsertionSort(begin, pivotPos, less) and
+                   partialInsertionSort(pivotPos + 1, end, less)) {
+            // The range was most likely already sorted.
+            return;
+        }
+
+        // Recurse into the smaller side and loop on the larger one, this
+        // keeps the stack depth logarithmic.
+        if (leftLen < rightLen) {
+            pdqsort(begin, pivotPos, badAllowed, leftmost, less);
+            begin = pivotPos + 1;
+            leftmost = false;
+        } else {
+            pdqsort(pivotPos + 1, end, badAllowed, false, less);
+            end = pivotPos;
         }
     }
+}
+
+} // namespace _Sort
 
-    auto rightSlice = mutSub(slice, 0, right + 1);
-    sort(rightSlice, cmp);
+/// Sorts the slice in place, `cmp` returns the `Ordr` of two elements.
+/// Not stable, see `stableSort()` in sort.h when the order of equal elements
+/// matters.
+constexpr void sort(MutSliceable auto &slice, auto cmp) {
+    usize l = len(slice);
+    if (l <= 1)
+        return;
+
+    auto less = [&](auto const &lhs, auto const &rhs) {
+        return cmp(lhs, rhs).isLt();
+    };
 
-    auto leftSlice = mutSub(slice, left, len(slice));
-    sort(leftSlice, cmp);
+    usize badAllowed = 0;
+    for (usize i = l; i; i >>= 1)
+        badAllowed++;
+
+    _Sort::pdqsort(slice.buf(), slice.buf() + l, badAllowed, true, less);
+}
+
+constexpr void sort(MutSliceable auto &slice) {
+    sort(slice, [](auto const &lhs, auto const &rhs) {
+        return ::cmp(lhs, rhs);
+    });
 }
 
 ALWAYS_INLINE Opt<usize> search(Sliceable auto const &slice, auto cmp) {
@@ -0,0 +1,118 @@
+#pragma once
+
+#include "array.h"
+#include "box.h"
+#include "opt.h"
+#include "vec.h"
+
+namespace Karm {
+
+/* --- Slot Table ----------------------------------------------------------- */
+
+/// Values addressed by handles, with O(1) insertion, lookup and removal.
+///
+/// Slots live in fixed size chunks, so they never move and the table grows
+/// one chunk at a time. Empty slots are threaded into a free list through
+/// their `next` field. A handle holds the index of its slot in the low
+/// `INDEX_BITS` bits and the generation of the slot above them, the
+/// generation is bumped each time the slot is emptied so stale handles are
+/// rejected without any extra bookkeeping. Slot 0 is never used, handles are
+/// never zero.
+template <typename T, usize INDEX_BITS = 20, usize GEN_BITS = 12, usize CHUNK = 256>
+struct SlotTable {
+    static_assert((CHUNK & (CHUNK - 1)) == 0, "chunks are a power of two");
+
+    static constexpr usize BITS = INDEX_BITS + GEN_BITS;
+    static constexpr usize INDEX_MASK = (1uz << INDEX_BITS) - 1;
+    static constexpr usize GEN_MASK = (1uz << GEN_BITS) - 1;
+    static constexpr usize MAX_LEN = 1uz << INDEX_BITS;
+
+    struct _Slot {
+        Opt<T> value = NONE;
+        u32 gen = 0;
+        u32 next = 0; // Next free slot, zero ends the list
+    };
+
+    using _Chunk = Array<_Slot, CHUNK>;
+
+    Vec<Box<_Chunk>> _chunks;
+    usize _free = 0;
+    usize _len = 0;
+
+    _Slot &_slot(usize index) {
+        return (*_chunks[index / CHUNK])[index % CHUNK];
+    }
+
+    // Adds a chunk and puts its slots on the free list, lowest index first.
+    bool _grow() {
+        usize base = _chunks.len() * CHUNK;
+        if (base >= MAX_LEN)
+            return false;
+
+        _chunks.pushBack(makeBox<_Chunk>());
+        for (usize i = CHUNK; i > 0; i--) {
+            usize index = base + i - 1;
+            if (index == 0)
+                break;
+            _slot(index).next = _free;
+            _free = index;
+        }
+        return true;
+    }
+
+    // The slot named by `handle`, if it's still holding the same value.
+    _Slot *_lookup(usize handle) {
+        usize index = handle & INDEX_MASK;
+        if (index == 0 or index >= _chunks.len() * CHUNK)
+            return nullptr;
+
+        auto &slot = _slot(index);
+        if (not slot.value or slot.gen != ((handle >> INDEX_BITS) & GEN_MASK))
+            return nullptr;
+        return &slot;
+    }
+
+    /// Stores `value` and returns its handle, or `NONE` if the table is full.
+    Opt<usize> add(T value) {
+        if (_free == 0 and not _grow())
+            return NONE;
+
+        usize index = _free;
+        auto &slot = _slot(index);
+        _free = slot.next;
+        slot.value = std::move(value);
+        _len++;
+        return index | ((usize)slot.gen << INDEX_BITS);
+    }
+
+    T *access(usize handle) {
+        auto *slot = _lookup(handle);
+        if (not slot)
+            return nullptr;
+        return &*slot->value;
+    }
+
+    bool has(usize handle) {
+        return _lookup(handle) != nullptr;
+    }
+
+    /// Takes the value out of its slot, every handle to it becomes stale.
+    Opt<T> take(usize handle) {
+        auto *slot = _lookup(handle);
+        if (not slot)
+            return NONE;
+
+        Opt<T> value = slot->value.take();
+        slot->gen = (slot->gen + 1) & GEN_MASK;
+        slot->next = _free;
+        _free = handle & INDEX_MASK;
+        _len--;
+        return value;
+    }
+
+    usize len() const {
+        return _len;
+    }
+};
+
+} // namespace Karm
@@ -0,0 +1,171 @@
+#pragma once
+
+#include "buf.h"
+#include "slice.h"
+
+namespace Karm {
+
+/* --- Stable Sort ---------------------------------------------------------- */
+
+namespace _Sort {
+
+template <typename T>
+void mergeSort(T *buf, usize len, Buf<T> &scratch, auto &less) {
+    if (len < INSERTION_THRESHOLD) {
+        insertionSort(buf, buf + len, less);
+        return;
+    }
+
+    usize mid = len / 2;
+    mergeSort(buf, mid, scratch, less);
+    mergeSort(buf + mid, len - mid, scratch, less);
+
+    // Both halves are already in order.
+    if (not less(buf[mid], buf[mid - 1]))
+        return;
+
+    // Only the left half is moved out of the way, the merge never writes
+    // past the elements of the right half it has already consumed.
+    scratch.insert(MOVE, 0, buf, mid);
+    T *left = scratch.buf();
+
+    usize i = 0, j = mid, k = 0;
+    while (i < mid and j < len) {
+        // Take from the left on ties, that's what makes it stable.
+        if (less(buf[j], left[i]))
+            buf[k++] = std::move(buf[j++]);
+        else
+            buf[k++] = std::move(left[i++]);
+    }
+
+    while (i < mid)
+        buf[k++] = std::move(left[i++]);
+
+    scratch.truncate(0);
+}
+
+} // namespace _Sort
+
+/// Sorts the slice in place, the relative order of equal elements is
+/// preserved. Uses a scratch buffer of half the size of the slice.
+template <MutSliceable S>
+void stableSort(S &slice, auto cmp) {
+    using T = typename S::Inner;
+
+    usize l = len(slice);
+    if (l <= 1)
+        return;
+
+    auto less = [&](auto const &lhs, auto const &rhs) {
+        return cmp(lhs, rhs).isLt();
+    };
+
+    Buf<T> scratch(l / 2);
+
+    _Sort::mergeSort(slice.buf(), l, scratch, less);
+}
+
+template <MutSliceable S>
+void stableSort(S &slice) {
+    stableSort(slice, [](auto const &lhs, auto const &rhs) {
+        return ::cmp(lhs, rhs);
+    });
+}
+
+/* --- Radix Sort ----------------------------------------------------------- */
+
+template <typename T>
+concept RadixKey = Meta::Integral<T> or Meta::Float<T>;
+
+namespace _Sort {
+
+// Maps a key to an unsigned integer with the same ordering.
+template <RadixKey K>
+ALWAYS_INLINE constexpr u64 radixBits(K key) {
+    constexpr usize BITS = sizeof(K) * 8;
+    constexpr u64 MASK = BITS == 64 ? ~0uLL : (1uLL << BITS) - 1;
+    constexpr u64 SIGN = 1uLL << (BITS - 1);
+
+    if constexpr (Meta::Float<K>) {
+        static_assert(sizeof(K) == 4 or sizeof(K) == 8, "unsupported float");
+        u64 bits;
+        if constexpr (sizeof(K) == 4)
+            bits = __builtin_bit_cast(u32, key);
+        else
+            bits = __builtin_bit_cast(u64, key);
+
+        // Negative floats are ordered backward.
+        return bits & SIGN ? ~bits & MASK : bits | SIGN;
+    } else if constexpr (Meta::Signed<K>) {
+        return ((u64)key & MASK) ^ SIGN;
+    } else {
+        return (u64)key;
+    }
+}
+
+} // namespace _Sort
+
+/// Sorts the slice by an integer or floating point key using a least
+/// significant digit radix sort, O(n) for a fixed key size. Stable, passes
+/// over bytes that are the same for every key are skipped.
+/// NaNs are sorted by their bit pattern.
+template <MutSliceable S>
+void radixSort(S &slice, auto key) {
+    using T = typename S::Inner;
+    using K = decltype(key(slice[0]));
+    static_assert(RadixKey<K>, "radix sort keys must be integers or floats");
+
+    usize l = len(slice);
+    if (l <= 1)
+        return;
+
+    // The elements are moved to the scratch buffer first, the slice then
+    // holds moved-from elements that can be assigned to by the first pass.
+    Buf<T> scratch(l);
+    scratch.insert(MOVE, 0, slice.buf(), l);
+
+    T *src = scratch.buf();
+    T *dst = slice.buf();
+    usize counts[256];
+
+    for (usize shift = 0; shift < sizeof(K) * 8; shift += 8) {
+        for (auto &c : counts)
+            c = 0;
+
+        for (usize i = 0; i < l; i++)
+            counts[(_Sort::radixBits(key(src[i])) >> shift) & 0xff]++;
+
+        // Every key has the same digit, the pass would not move anything.
+        if (counts[(_Sort::radixBits(key(src[0])) >> shift) & 0xff] == l)
+            continue;
+
+        usize offset = 0;
+        for (auto &c : counts) {
+            usize n = c;
+            c = offset;
+            offset += n;
+        }
+
+        for (usize i = 0; i < l; i++) {
+            usize digit = (_Sort::radixBits(key(src[i])) >> shift) & 0xff;
+            dst[counts[digit]++] = std::move(src[i]);
+        }
+
+        std::swap(src, dst);
+    }
+
+    if (src != slice.buf()) {
+        for (usize i = 0; i < l; i++)
+            slice.buf()[i] = std::move(src[i]);
+    }
+}
+
+template <MutSliceable S>
+    requires RadixKey<typename S::Inner>
+void radixSort(S &slice) {
+    radixSort(slice, [](auto v) {
+        return v;
+    });
+}
+
+} // namespace Karm
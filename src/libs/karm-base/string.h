@@ -1,5 +1,6 @@
 #pragma once
 
+#include "atomic.h"
 #include "ordr.h"
 #include "rune.h"
 #include "std.h"
@@ -47,28 +48,76 @@ struct _MutStr : public MutSlice<U> {
         : MutSlice<U>(cstr, strLen(cstr)) {}
 };
 
+/* --- String Stats --------------------------------------------------------- */
+
+/// Counts how strings are allocated, used to measure the effect of the small
+/// string optimization and of interning. The counters are only fed when the
+/// target sets the `karm-base-string-stats` prop, they stay at zero otherwise.
+struct StringStats {
+    Atomic<usize> heapAllocs{};
+    Atomic<usize> inlineAllocs{};
+    Atomic<usize> atoms{};
+    Atomic<usize> atomHits{};
+};
+
+inline StringStats _stringStats{};
+
+inline StringStats &stringStats() {
+    return _stringStats;
+}
+
+ALWAYS_INLINE inline void _countString([[maybe_unused]] Atomic<usize> &counter) {
+#ifdef __ck_karm_base_string_stats__
+    counter.inc(RELAXED);
+#endif
+}
+
+/* --- String --------------------------------------------------------------- */
+
 template <StaticEncoding E>
 struct _String {
     using Encoding = E;
     using Unit = typename E::Unit;
     using Inner = Unit;
 
-    Unit *_buf;
-    usize _len;
+    static constexpr bool RELOCATABLE = true;
+
+    // Strings shorter than INLINE units are stored inline, in place of the
+    // heap pointer and length. The last unit then holds how many more units
+    // would fit, so a full inline string gets its null terminator for free.
+    // Heap strings set it to HEAP, which no inline length can produce.
+    static constexpr usize INLINE = 24 / sizeof(Unit);
+    static constexpr Unit HEAP = (Unit)(1uLL << (sizeof(Unit) * 8 - 1));
+
+    struct _Heap {
+        Unit *ptr;
+        usize len;
+    };
+
+    union _Store {
+        _Heap heap;
+        Unit buf[INLINE];
+    };
+
+    _Store _store;
 
-    _String()
-        : _String("", 0) {}
+    _String() {
+        _clear();
+    }
 
-    _String(Move, Unit *buf, usize len)
-        : _buf(buf),
-          _len(len) {
+    /// Takes ownership of a buffer allocated with `new Unit[len + 1]`.
+    _String(Move, Unit *buf, usize len) {
+        if (len < INLINE) {
+            memcpy(_alloc(len), buf, len * sizeof(Unit));
+            delete[] buf;
+        } else {
+            _store.heap = {buf, len};
+            _store.buf[INLINE - 1] = HEAP;
+        }
     }
 
-    _String(Unit const *buf, usize len)
-        : _len(len) {
-        _buf = new Unit[len + 1];
-        _buf[len] = 0;
-        memcpy(_buf, buf, len * sizeof(Unit));
+    _String(Unit const *buf, usize len) {
+        memcpy(_alloc(len), buf, len * sizeof(Unit));
     }
 
     _String(Unit const *cstr)
@@ -79,18 +128,17 @@ struct _String {
         : _String(str.buf(), str.len()) {}
 
     _String(_String const &other)
-        : _String(other._buf, other._len) {
+        : _String(other.buf(), other.len()) {
     }
 
     _String(_String &&other)
-        : _buf(std::exchange(other._buf, nullptr)),
-          _len(std::exchange(other._len, 0)) {
+        : _store(other._store) {
+        other._clear();
     }
 
     ~_String() {
-        if (_buf) {
-            delete[] _buf;
-        }
+        if (not _isInline())
+            delete[] _store.heap.ptr;
     }
 
     _String &operator=(_String const &other) {
@@ -99,31 +147,63 @@ struct _String {
     }
 
     _String &operator=(_String &&other) {
-        std::swap(_buf, other._buf);
-        std::swap(_len, other._len);
+        std::swap(_store, other._store);
 
         return *this;
     }
 
-    _Str<E> str() const { return {_buf, _len}; }
+    void _clear() {
+        _store.buf[0] = 0;
+        _store.buf[INLINE - 1] = (Unit)(INLINE - 1);
+    }
+
+    bool _isInline() const {
+        return _store.buf[INLINE - 1] != HEAP;
+    }
+
+    // Sets the length and returns the storage for `len` units, the null
+    // terminator is already written.
+    Unit *_alloc(usize len) {
+        Unit *buf;
+        if (len < INLINE) {
+            _countString(stringStats().inlineAllocs);
+            buf = _store.buf;
+            buf[INLINE - 1] = (Unit)(INLINE - 1 - len);
+        } else {
+            _countString(stringStats().heapAllocs);
+            buf = new Unit[len + 1];
+            _store.heap = {buf, len};
+            _store.buf[INLINE - 1] = HEAP;
+        }
+
+        buf[len] = 0;
+        return buf;
+    }
+
+    _Str<E> str() const { return {buf(), len()}; }
 
     Slice<Unit> units() const {
-        return {_buf, _len};
+        return {buf(), len()};
     }
 
     MutSlice<Unit> mutUnits() {
-        return {_buf, _len};
+        return {buf(), len()};
     }
 
     Ordr cmp(char const *other) const {
         return ::cmp(str(), _Str<E>{other});
     }
 
-    Unit const &operator[](usize i) const { return _buf[i]; }
-    Unit &operator[](usize i) { return _buf[i]; }
-    Unit const *buf() const { return _buf; }
-    Unit *buf() { return _buf; }
-    usize len() const { return _len; }
+    Unit const &operator[](usize i) const { return buf()[i]; }
+    Unit &operator[](usize i) { return buf()[i]; }
+    Unit const *buf() const { return _isInline() ? _store.buf : _store.heap.ptr; }
+    Unit *buf() { return _isInline() ? _store.buf : _store.heap.ptr; }
+
+    usize len() const {
+        if (_isInline())
+            return INLINE - 1 - (usize)_store.buf[INLINE - 1];
+        return _store.heap.len;
+    }
 };
 
 template <
@@ -174,8 +254,8 @@ bool eqCi(_Str<E> a, _Str<E> b) {
 template <::StaticEncoding Target, ::StaticEncoding Source>
 _String<Target> transcode(_Str<Source> str) {
     usize len = transcodeLen<Source, Target>(str);
-    typename Target::Unit *buf = new typename Target::Unit[len + 1];
-    buf[len] = '\0';
+    _String<Target> res;
+    typename Target::Unit *buf = res._alloc(len);
 
     Cursor<typename Source::Unit> input = str;
     MutSlice<typename Target::Unit> slice(buf, len);
@@ -183,7 +263,7 @@ _String<Target> transcode(_Str<Source> str) {
 
     transcodeUnits<Source, Target>(input, output);
 
-    return {MOVE, buf, len};
+    return res;
 }
 
 using Str = _Str<Utf8>;
@@ -0,0 +1,76 @@
+#include <karm-base/arena.h>
+#include <karm-test/macros.h>
+
+namespace Karm::Base::Tests {
+
+test$(arenaAlloc) {
+    Arena arena;
+
+    auto *a = arena.alloc(3, 1);
+    auto *b = arena.alloc(8, 8);
+    expectEq$((usize)b % 8, 0uz);
+    expect$(a != b);
+
+    // Larger than a chunk.
+    auto *c = static_cast<u8 *>(arena.alloc(Arena::CHUNK_SIZE * 2));
+    memset(c, 0xff, Arena::CHUNK_SIZE * 2);
+
+    expectEq$(arena.stats().served, 11 + Arena::CHUNK_SIZE * 2);
+
+    arena.reset();
+    expectEq$(arena.stats().used, 0uz);
+    expectGteq$(arena.stats().peak, Arena::CHUNK_SIZE * 2);
+
+    return Ok();
+}
+
+test$(arenaScope) {
+    static isize alive = 0;
+
+    struct Obj {
+        Obj() { alive++; }
+        ~Obj() { alive--; }
+    };
+
+    Arena arena;
+    arena.make<Obj>();
+
+    {
+        ArenaScope scope{arena};
+        for (usize i = 0; i < 10000; i++)
+            arena.make<Obj>();
+        expectEq$(alive, 10001);
+    }
+
+    expectEq$(alive, 1);
+    auto str = arena.dup("hello");
+    expectEq$(str, Str{"hello"});
+
+    arena.reset();
+    expectEq$(alive, 0);
+
+    return Ok();
+}
+
+test$(arenaContainers) {
+    Arena arena;
+
+    {
+        ArenaVec<isize> vec{ArenaAlloc{arena}};
+        for (isize i = 0; i < 1000; i++)
+            vec.pushBack(i);
+
+        auto copy = vec;
+        expectEq$(copy.len(), 1000uz);
+        expectEq$(copy[999], 999);
+
+        auto box = makeBox<isize>(arena, 42);
+        expectEq$(*box, 42);
+    }
+
+    expectGteq$(arena.stats().used, 2000 * sizeof(isize));
+
+    return Ok();
+}
+
+} // namespace Karm::Base::Tests
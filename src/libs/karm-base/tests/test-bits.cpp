@@ -0,0 +1,110 @@
+#include <karm-base/bits.h>
+#include <karm-base/vec.h>
+#include <karm-test/macros.h>
+
+namespace Karm::Base::Tests {
+
+static u64 _next(u64 &state) {
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return state;
+}
+
+// Reference implementation, one bit at a time.
+static Opt<BitsRange> _naiveAlloc(Vec<bool> &bits, usize count, usize start, bool upper) {
+    usize run = 0;
+    if (upper) {
+        for (usize i = min(start, bits.len()); i > 0; i--) {
+            run = bits[i - 1] ? 0 : run + 1;
+            if (run == count)
+                return BitsRange{i - 1, count};
+        }
+    } else {
+        for (usize i = start; i < bits.len(); i++) {
+            run = bits[i] ? 0 : run + 1;
+            if (run == count)
+                return BitsRange{i + 1 - count, count};
+        }
+    }
+    return NONE;
+}
+
+test$(bitsAllocMatchesNaive) {
+    Array<usize, 4> lens = {1, 63, 64, 5000};
+
+    for (auto len : lens) {
+        Vec<u64> storage;
+        for (usize i = 0; i < Bits::storageLen(len); i++)
+            storage.pushBack(0);
+
+        Bits bits{storage, len};
+        bits.fill(false);
+
+        Vec<bool> naive;
+        for (usize i = 0; i < len; i++)
+            naive.pushBack(false);
+
+        u64 state = 0x2545f4914f6cdd1d;
+        for (usize op = 0; op < 2000; op++) {
+            usize r = _next(state);
+            usize count = 1 + (r >> 8) % (r & 1 ? 4 : 200);
+            usize start = (r >> 24) % (len + 1);
+
+            if (r & 2) {
+                bool upper = r & 4;
+                auto expected = _naiveAlloc(naive, count, start, upper);
+                auto got = bits.alloc(count, start, upper);
+
+                expectEq$(got.has(), expected.has());
+                if (got) {
+                    expectEq$(got->start, expected->start);
+                    for (usize i = 0; i < count; i++)
+                        naive[got->start + i] = true;
+                }
+            } else {
+                usize size = min(count, len - min(start, len));
+                bits.set(BitsRange{start, size}, false);
+                for (usize i = 0; i < size; i++)
+                    naive[start + i] = false;
+            }
+
+            if (op % 100 == 0) {
+                usize used = 0;
+                for (auto b : naive)
+                    used += b;
+                expectEq$(bits.used(), used);
+            }
+        }
+
+        usize free = 0, wrong = 0;
+        bits.visit([&](BitsRange range) {
+            for (usize i = 0; i < range.size; i++)
+                wrong += naive[range.start + i];
+            free += range.size;
+        });
+        expectEq$(wrong, 0uz);
+        expectEq$(free, len - bits.used());
+    }
+
+    return Ok();
+}
+
+test$(bitsFull) {
+    Vec<u64> storage;
+    for (usize i = 0; i < Bits::storageLen(200); i++)
+        storage.pushBack(0);
+
+    Bits bits{storage, 200};
+    bits.fill(true);
+    expect$(not bits.alloc(1, 0, false));
+    expect$(not bits.alloc(1, -1, true));
+
+    bits.set(BitsRange{130, 10}, false);
+    expectEq$(bits.alloc(10, 0, false).unwrap().start, 130uz);
+    expectEq$(bits.used(), 200uz);
+
+    return Ok();
+}
+
+} // namespace Karm::Base::Tests
@@ -0,0 +1,91 @@
+#include <karm-base/hashmap.h>
+#include <karm-base/string.h>
+#include <karm-test/macros.h>
+
+namespace Karm::Base::Tests {
+
+test$(hashMapPutGet) {
+    HashMap<isize, isize> map;
+
+    for (isize i = 0; i < 10000; i++)
+        map.put(i, i * 2);
+
+    expectEq$(map.len(), 10000uz);
+
+    for (isize i = 0; i < 10000; i++)
+        expectEq$(map.get(i).unwrap(), i * 2);
+
+    expectNot$(map.has(-1));
+
+    map.put(42, 0);
+    expectEq$(map.get(42).unwrap(), 0);
+    expectEq$(map.len(), 10000uz);
+
+    return Ok();
+}
+
+test$(hashMapRemove) {
+    HashMap<isize, isize> map;
+
+    for (isize i = 0; i < 1000; i++)
+        map.put(i, i);
+
+    for (isize i = 0; i < 1000; i += 2)
+        expect$(map.remove(i));
+
+    expectNot$(map.remove(0));
+    expectEq$(map.len(), 500uz);
+
+    for (isize i = 0; i < 1000; i++)
+        expectEq$(map.has(i), i % 2 == 1);
+
+    usize count = 0;
+    for (auto &kv : map.iter()) {
+        expectEq$(kv.car % 2, 1);
+        count++;
+    }
+    expectEq$(count, 500uz);
+
+    // Tombstones must not make the table grow forever.
+    for (isize round = 0; round < 100; round++) {
+        for (isize i = 0; i < 100; i++)
+            map.put(100000 + i, i);
+        for (isize i = 0; i < 100; i++)
+            map.remove(100000 + i);
+    }
+    expectLteq$(map._cap, 2048uz);
+
+    return Ok();
+}
+
+test$(hashMapStrKeys) {
+    HashMap<String, isize> map = {
+        {String{"hello"}, 1},
+        {String{"world"}, 2},
+    };
+
+    expectEq$(map.get(Str{"hello"}).unwrap(), 1);
+    expectEq$(map.get(Str{"world"}).unwrap(), 2);
+    expectNot$(map.has(Str{"nope"}));
+
+    auto copy = map;
+    copy.put(String{"copy"}, 3);
+    expectEq$(map.len(), 2uz);
+    expectEq$(copy.len(), 3uz);
+
+    return Ok();
+}
+
+test$(hashSet) {
+    HashSet<isize> set = {1, 2, 3, 2};
+    expectEq$(set.len(), 3uz);
+    expect$(set.has(2));
+
+    set.remove(2);
+    expectNot$(set.has(2));
+    expectEq$(set.len(), 2uz);
+
+    return Ok();
+}
+
+} // namespace Karm::Base::Tests
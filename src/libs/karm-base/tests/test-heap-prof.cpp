@@ -0,0 +1,38 @@
+#include <karm-base/heap-prof.h>
+#include <karm-base/vec.h>
+#include <karm-test/macros.h>
+
+namespace Karm::Base::Tests {
+
+test$(heapProfCounters) {
+    static HeapProf prof{};
+
+    prof.onAlloc(24, 0x1000);
+    prof.onAlloc(100, 0x2000);
+    prof.onFree(24);
+    prof.onAlloc(HeapProf::SAMPLE_RATE, 0x1000);
+
+    expectEq$(prof.allocs(), 3uz);
+    expectEq$(prof.frees(), 1uz);
+    expectEq$(prof.live(), 100uz + HeapProf::SAMPLE_RATE);
+    expectEq$(prof.peak(), prof.live());
+    expectEq$(prof.allocsOfClass(4), 1uz);
+    expectEq$(prof.allocsOfClass(6), 1uz);
+
+    Vec<u8> out;
+    prof.dump([&](Bytes bytes) {
+        for (auto b : bytes)
+            out.pushBack(b);
+    });
+
+    // Only the first allocation is sampled, the countdown to the next one
+    // ran out on the last allocation.
+    usize sites = 1;
+    expectEq$(out.len(), 8 + 6 * 8 + HeapProf::CLASSES * 8 + sites * 24);
+    expectEq$(out[0], 'K');
+    expectEq$(out[4], sites);
+
+    return Ok();
+}
+
+} // namespace Karm::Base::Tests
@@ -0,0 +1,125 @@
+#include <karm-base/range-alloc.h>
+#include <karm-base/vec.h>
+#include <karm-test/macros.h>
+
+namespace Karm::Base::Tests {
+
+test$(rangeAllocCoalesce) {
+    RangeAlloc<> alloc;
+    alloc.unused({0, 100});
+    alloc.used({10, 10});
+    alloc.used({50, 10});
+    expectEq$(alloc.len(), 3uz);
+
+    alloc.unused({10, 10});
+    alloc.unused({50, 10});
+    expectEq$(alloc.len(), 1uz);
+
+    USizeRange free = {};
+    alloc.visit([&](USizeRange range) {
+        free = range;
+    });
+    expectEq$(free.start, 0uz);
+    expectEq$(free.size, 100uz);
+
+    return Ok();
+}
+
+test$(rangeAllocBestFit) {
+    RangeAlloc<> alloc;
+    alloc.unused({0, 100});
+    alloc.unused({200, 10});
+    alloc.unused({300, 30});
+
+    expectEq$(alloc.alloc(8).unwrap().start, 200uz);
+    expectEq$(alloc.alloc(20).unwrap().start, 300uz);
+    expectEq$(alloc.alloc(16, 64).unwrap().start, 0uz);
+    expectEq$(alloc.alloc(16, 64).unwrap().start, 64uz);
+    expect$(not alloc.alloc(200));
+
+    return Ok();
+}
+
+test$(rangeAllocAlignedFragmented) {
+    RangeAlloc<> alloc;
+
+    // Lots of ranges long enough, but none of them aligned well enough.
+    for (usize i = 0; i < 100; i++)
+        alloc.unused({i * 128 + 1, 32});
+    alloc.unused({100000, 1000});
+
+    auto res = alloc.alloc(16, 64);
+    expect$(res.has());
+    expectEq$(res.unwrap().start, 100032uz);
+    expectEq$(alloc.len(), 102uz);
+
+    return Ok();
+}
+
+test$(rangeAllocMatchesBitmap) {
+    static constexpr usize LEN = 4096;
+
+    RangeAlloc<> alloc;
+    alloc.unused({0, LEN});
+
+    Vec<bool> used;
+    for (usize i = 0; i < LEN; i++)
+        used.pushBack(false);
+
+    Vec<USizeRange> live;
+    u64 state = 0x2545f4914f6cdd1d;
+
+    for (usize op = 0; op < 5000; op++) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+
+        if (state % 3 != 0 or live.len() == 0) {
+            usize size = 1 + (state >> 8) % 64;
+            usize align = 1 << ((state >> 16) % 5);
+            auto res = alloc.alloc(size, align);
+            if (not res)
+                continue;
+
+            auto range = res.unwrap();
+            expectEq$(range.start % align, 0uz);
+            for (usize i = range.start; i < range.end(); i++) {
+                expect$(not used[i]);
+                used[i] = true;
+            }
+            live.pushBack(range);
+        } else {
+            usize i = (state >> 8) % live.len();
+            auto range = live[i];
+            live.removeAt(i);
+            for (usize j = range.start; j < range.end(); j++)
+                used[j] = false;
+            alloc.unused(range);
+        }
+    }
+
+    // The free ranges are exactly the free bits, fully coalesced.
+    usize free = 0, bad = 0;
+    usize last = 0;
+    bool first = true;
+    alloc.visit([&](USizeRange range) {
+        if (not first and range.start <= last)
+            bad++;
+        first = false;
+        last = range.end();
+        for (usize i = range.start; i < range.end(); i++)
+            bad += used[i];
+        free += range.size;
+    });
+
+    usize expected = 0;
+    for (auto u : used)
+        expected += not u;
+
+    expectEq$(bad, 0uz);
+    expectEq$(free, expected);
+
+    return Ok();
+}
+
+} // namespace Karm::Base::Tests
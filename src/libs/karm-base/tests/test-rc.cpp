@@ -13,4 +13,62 @@ test$(strongRc) {
     return Ok();
 }
 
+test$(strongWeak) {
+    struct S {
+        isize x;
+    };
+
+    auto s = makeStrong<S>(42);
+    Weak<S> w = s;
+
+    {
+        auto copy = s;
+        expectEq$(s._cell->_strong.load(), 2);
+        expectEq$(w.upgrade().unwrap()->x, 42);
+    }
+
+    expectEq$(s._cell->_strong.load(), 1);
+
+    s = makeStrong<S>(0);
+    expect$(not w.upgrade());
+
+    return Ok();
+}
+
+static isize _alive = 0;
+
+struct Node : public LocalRefCounted<Node> {
+    isize value;
+
+    Node(isize value) : value(value) { _alive++; }
+
+    ~Node() { _alive--; }
+};
+
+struct SharedNode : public RefCounted<SharedNode> {
+    isize value;
+
+    SharedNode(isize value) : value(value) { _alive++; }
+
+    ~SharedNode() { _alive--; }
+};
+
+test$(intrusiveRc) {
+    {
+        auto a = makeRc<Node>(1);
+        auto b = a;
+        expectEq$(a->_refs, 2uz);
+        expectEq$(b->value, 1);
+
+        auto c = makeRc<SharedNode>(2);
+        auto d = std::move(c);
+        expectEq$(d->_refs.load(), 1uz);
+        expectEq$(_alive, 2);
+    }
+
+    expectEq$(_alive, 0);
+
+    return Ok();
+}
+
 } // namespace Karm::Base::Tests
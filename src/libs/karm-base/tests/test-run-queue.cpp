@@ -0,0 +1,157 @@
+#include <karm-base/run-queue.h>
+#include <karm-test/macros.h>
+
+namespace Karm::Base::Tests {
+
+test$(runQueuePriorities) {
+    RunQueue<usize> queue;
+    queue.push(3, 30);
+    queue.push(10, 100);
+    queue.push(3, 31);
+    queue.push(0, 0);
+
+    expectEq$(queue.top().unwrap(), 10uz);
+    expectEq$(queue.pop().unwrap(), 100uz);
+    expectEq$(queue.pop().unwrap(), 30uz);
+    expectEq$(queue.pop().unwrap(), 31uz);
+    expectEq$(queue.pop().unwrap(), 0uz);
+    expect$(not queue.pop());
+    expectEq$(queue.len(), 0uz);
+
+    return Ok();
+}
+
+test$(runQueueSteal) {
+    RunQueue<usize> queue;
+    queue.push(2, 20);
+    queue.push(2, 21);
+    queue.push(2, 22);
+    queue.push(5, 51);
+
+    // Highest priority first, newest first within a priority.
+    auto odd = [](usize &v) {
+        return v % 2 == 1;
+    };
+    expectEq$(queue.steal(odd).unwrap(), 51uz);
+    expectEq$(queue.steal(odd).unwrap(), 21uz);
+    expect$(not queue.steal(odd));
+
+    expectEq$(queue.len(), 2uz);
+    expectEq$(queue.top().unwrap(), 2uz);
+    expectEq$(queue.pop().unwrap(), 20uz);
+    expectEq$(queue.pop().unwrap(), 22uz);
+    expect$(not queue.pop());
+
+    return Ok();
+}
+
+test$(sleepQueueDeadlines) {
+    SleepQueue<usize> queue;
+    Array<usize, 8> deadlines = {50, 10, 40, 10, 30, 70, 20, 60};
+    for (auto d : deadlines)
+        queue.push(TimeStamp{d}, d);
+
+    expect$(not queue.popExpired(TimeStamp{5}));
+
+    usize last = 0;
+    usize popped = 0;
+    while (auto value = queue.popExpired(TimeStamp{45})) {
+        expectGteq$(*value, last);
+        last = *value;
+        popped++;
+    }
+    expectEq$(popped, 5uz);
+    expectEq$(queue.next().unwrap().val(), 50uz);
+
+    // Pull everything in, as if the blockers were satisfied.
+    queue.update([](usize &) {
+        return TimeStamp{0};
+    });
+    usize left = 0;
+    while (queue.popExpired(TimeStamp{0}))
+        left++;
+    expectEq$(left, 3uz);
+
+    return Ok();
+}
+
+test$(sleepQueueRemove) {
+    SleepQueue<usize> queue;
+    Array<usize, 8> deadlines = {50, 10, 40, 15, 30, 70, 20, 60};
+    for (auto d : deadlines)
+        queue.push(TimeStamp{d}, d);
+
+    // Woken before their deadline.
+    expectEq$(queue.remove([](usize &v) { return v == 10; }).unwrap(), 10uz);
+    expectEq$(queue.remove([](usize &v) { return v == 40; }).unwrap(), 40uz);
+    expect$(not queue.remove([](usize &v) { return v == 40; }));
+    expectEq$(queue.len(), 6uz);
+    expectEq$(queue.next().unwrap().val(), 15uz);
+
+    usize last = 0;
+    while (auto value = queue.popExpired(TimeStamp{100})) {
+        expectGteq$(*value, last);
+        expect$(*value != 10 and *value != 40);
+        last = *value;
+    }
+    expectEq$(queue.len(), 0uz);
+
+    return Ok();
+}
+
+// Round robin of equal priority tasks with sleepers, the way the kernel
+// scheduler drives the queues: every task gets the same share of ticks and
+// a woken task runs within one round.
+test$(runQueueSimulation) {
+    static constexpr usize TASKS = 16;
+    static constexpr usize TICKS = 10000;
+
+    RunQueue<usize> ready;
+    SleepQueue<usize> sleeping;
+    Array<usize, TASKS> ran{};
+    Array<usize, TASKS> wokeAt{};
+    usize maxLatency = 0;
+
+    for (usize i = 0; i < TASKS; i++) {
+        ready.push(4, i);
+        wokeAt[i] = ~0uz;
+    }
+
+    for (usize tick = 0; tick < TICKS; tick++) {
+        while (auto task = sleeping.popExpired(TimeStamp{tick})) {
+            wokeAt[*task] = tick;
+            ready.push(4, *task);
+        }
+
+        auto task = ready.pop();
+        if (not task)
+            continue;
+
+        usize t = *task;
+        if (wokeAt[t] != ~0uz) {
+            maxLatency = max(maxLatency, tick - wokeAt[t]);
+            wokeAt[t] = ~0uz;
+        }
+
+        ran[t]++;
+
+        // Odd tasks nap for a few ticks every now and then.
+        if (t % 2 and ran[t] % 8 == 0)
+            sleeping.push(TimeStamp{tick + 3}, t);
+        else
+            ready.push(4, t);
+    }
+
+    usize minEven = ~0uz, maxEven = 0;
+    for (usize i = 0; i < TASKS; i += 2) {
+        minEven = min(minEven, ran[i]);
+        maxEven = max(maxEven, ran[i]);
+    }
+
+    expectLteq$(maxEven - minEven, 1uz);
+    expectLteq$(maxLatency, TASKS);
+
+    return Ok();
+}
+
+} // namespace Karm::Base::Tests
@@ -0,0 +1,76 @@
+#include <karm-base/list.h>
+#include <karm-base/rc.h>
+#include <karm-base/slab.h>
+#include <karm-test/macros.h>
+
+namespace Karm::Base::Tests {
+
+test$(slabReuse) {
+    Array<usize, 6> sizes = {1, 16, 40, 100, 512, 4096};
+
+    for (auto size : sizes) {
+        void *a = slabAlloc(size);
+        memset(a, 0xaa, size);
+        slabFree(a, size);
+
+        // Freed objects are handed out again first.
+        void *b = slabAlloc(size);
+        if (size <= SLAB_MAX_SIZE)
+            expectEq$((usize)a, (usize)b);
+        slabFree(b, size);
+    }
+
+    return Ok();
+}
+
+test$(slabChurn) {
+    Array<void *, 1024> ptrs{};
+    u64 state = 0x2545f4914f6cdd1d;
+
+    for (usize i = 0; i < 100000; i++) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+
+        auto &ptr = ptrs[state % ptrs.len()];
+        usize size = 8 + (usize)(&ptr - ptrs.buf()) % 256;
+        if (ptr) {
+            expectEq$(*static_cast<usize *>(ptr), size);
+            slabFree(ptr, size);
+            ptr = nullptr;
+        } else {
+            ptr = slabAlloc(size);
+            *static_cast<usize *>(ptr) = size;
+        }
+    }
+
+    for (usize i = 0; i < ptrs.len(); i++)
+        slabFree(ptrs[i], 8 + i % 256);
+
+    return Ok();
+}
+
+struct SlabbedObj {
+    static constexpr bool SLAB = true;
+    isize x;
+};
+
+test$(slabContainers) {
+    static_assert(Slabbed<SlabbedObj>);
+    static_assert(not Slabbed<isize>);
+
+    List<SlabbedObj> list;
+    for (isize i = 0; i < 100; i++)
+        list.pushBack({i});
+    expectEq$(list.len(), 100uz);
+    expectEq$(list.peekBack().x, 99);
+    list.clear();
+
+    auto s = makeStrong<SlabbedObj>(42);
+    Weak<SlabbedObj> w = s;
+    expectEq$(w.upgrade().unwrap()->x, 42);
+
+    return Ok();
+}
+
+} // namespace Karm::Base::Tests
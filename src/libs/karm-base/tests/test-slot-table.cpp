@@ -0,0 +1,100 @@
+#include <karm-base/slot-table.h>
+#include <karm-test/macros.h>
+
+namespace Karm::Base::Tests {
+
+test$(slotTableAddGetTake) {
+    SlotTable<usize> table;
+    auto a = table.add(10).unwrap();
+    auto b = table.add(20).unwrap();
+
+    expect$(a != 0);
+    expect$(a != b);
+    expectEq$(*table.access(a), 10uz);
+    expectEq$(*table.access(b), 20uz);
+    expectEq$(table.len(), 2uz);
+
+    expectEq$(table.take(a).unwrap(), 10uz);
+    expect$(not table.has(a));
+    expect$(not table.take(a));
+    expectEq$(*table.access(b), 20uz);
+    expectEq$(table.len(), 1uz);
+
+    expect$(not table.has(0));
+    expect$(not table.has(12345));
+
+    return Ok();
+}
+
+test$(slotTableStaleHandles) {
+    SlotTable<usize> table;
+    auto a = table.add(1).unwrap();
+    auto taken = table.take(a);
+    expect$(taken.has());
+    expectEq$(taken.unwrap(), 1uz);
+
+    // The slot is reused, but under a new generation.
+    auto b = table.add(2).unwrap();
+    expectEq$(a & table.INDEX_MASK, b & table.INDEX_MASK);
+    expect$(a != b);
+    expect$(not table.access(a));
+    expectEq$(*table.access(b), 2uz);
+
+    return Ok();
+}
+
+test$(slotTableGrow) {
+    SlotTable<usize, 10, 4, 16> table;
+    Vec<usize> handles;
+    for (usize i = 0; i < 1023; i++)
+        handles.pushBack(table.add(i).unwrap());
+
+    expect$(not table.add(1023));
+    expectEq$(table.len(), 1023uz);
+
+    for (usize i = 0; i < handles.len(); i++)
+        expectEq$(*table.access(handles[i]), i);
+
+    for (usize i = 0; i < handles.len(); i += 2) {
+        auto taken = table.take(handles[i]);
+        expect$(taken.has());
+        expectEq$(taken.unwrap(), i);
+    }
+    for (usize i = 0; i < handles.len(); i += 2) {
+        auto added = table.add(i);
+        expect$(added.has());
+    }
+
+    expect$(not table.add(0));
+
+    return Ok();
+}
+
+test$(slotTableNarrowHandles) {
+    // The layout of hjert domains, handles must fit in a 12-bit hop.
+    SlotTable<usize, 10, 2> table;
+    Vec<usize> handles;
+    for (usize i = 0; i < 1023; i++) {
+        auto handle = table.add(i);
+        expect$(handle.has());
+        expectLt$(handle.unwrap(), 1uz << 12);
+        handles.pushBack(handle.unwrap());
+    }
+
+    auto full = table.add(0);
+    expect$(not full.has());
+
+    // Generations wrap within their bits.
+    for (usize i = 0; i < 8; i++) {
+        auto taken = table.take(handles[0]);
+        expect$(taken.has());
+        auto handle = table.add(i);
+        expect$(handle.has());
+        expectLt$(handle.unwrap(), 1uz << 12);
+        handles[0] = handle.unwrap();
+    }
+
+    return Ok();
+}
+
+} // namespace Karm::Base::Tests
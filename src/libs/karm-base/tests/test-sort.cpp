@@ -0,0 +1,151 @@
+#include <karm-base/sort.h>
+#include <karm-base/vec.h>
+#include <karm-test/macros.h>
+
+namespace Karm::Base::Tests {
+
+static u64 _next(u64 &state) {
+    // xorshift64
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return state;
+}
+
+enum struct Distribution {
+    RANDOM,
+    SORTED,
+    REVERSED,
+    EQUAL,
+    FEW_UNIQUE,
+    ORGAN_PIPE,
+    SAWTOOTH,
+
+    _LEN,
+};
+
+static Vec<isize> _generate(Distribution dist, usize len) {
+    Vec<isize> vec;
+    u64 state = 0x2545f4914f6cdd1d;
+
+    for (usize i = 0; i < len; i++) {
+        switch (dist) {
+        case Distribution::RANDOM:
+            vec.pushBack((isize)_next(state));
+            break;
+        case Distribution::SORTED:
+            vec.pushBack(i);
+            break;
+        case Distribution::REVERSED:
+            vec.pushBack(len - i);
+            break;
+        case Distribution::EQUAL:
+            vec.pushBack(42);
+            break;
+        case Distribution::FEW_UNIQUE:
+            vec.pushBack(_next(state) % 4);
+            break;
+        case Distribution::ORGAN_PIPE:
+            vec.pushBack(i < len / 2 ? i : len - i);
+            break;
+        case Distribution::SAWTOOTH:
+            vec.pushBack(i % 32);
+            break;
+        default:
+            break;
+        }
+    }
+
+    return vec;
+}
+
+static bool _isSorted(Vec<isize> const &vec) {
+    for (usize i = 1; i < vec.len(); i++) {
+        if (vec[i - 1] > vec[i])
+            return false;
+    }
+    return true;
+}
+
+static u64 _sum(Vec<isize> const &vec) {
+    u64 sum = 0;
+    for (auto v : vec)
+        sum += (u64)v;
+    return sum;
+}
+
+test$(sortDistributions) {
+    Array<usize, 6> lens = {0, 1, 2, 23, 200, 5000};
+
+    for (usize d = 0; d < (usize)Distribution::_LEN; d++) {
+        for (auto len : lens) {
+            auto vec = _generate((Distribution)d, len);
+            u64 sum = _sum(vec);
+
+            auto a = vec;
+            sort(a);
+            expect$(_isSorted(a));
+            expectEq$(_sum(a), sum);
+
+            auto b = vec;
+            stableSort(b);
+            expect$(_isSorted(b));
+            expectEq$(_sum(b), sum);
+
+            auto c = vec;
+            radixSort(c);
+            expect$(_isSorted(c));
+            expectEq$(_sum(c), sum);
+        }
+    }
+
+    return Ok();
+}
+
+test$(sortStable) {
+    struct Item {
+        isize key;
+        usize index;
+    };
+
+    Vec<Item> items;
+    u64 state = 0x9e3779b97f4a7c15;
+    for (usize i = 0; i < 1000; i++)
+        items.pushBack({(isize)(_next(state) % 16) - 8, i});
+
+    auto merged = items;
+    stableSort(merged, [](auto const &a, auto const &b) {
+        return cmp(a.key, b.key);
+    });
+
+    auto radixed = items;
+    radixSort(radixed, [](auto const &item) {
+        return item.key;
+    });
+
+    for (usize i = 1; i < items.len(); i++) {
+        expectLteq$(merged[i - 1].key, merged[i].key);
+        if (merged[i - 1].key == merged[i].key)
+            expectLt$(merged[i - 1].index, merged[i].index);
+
+        expectEq$(radixed[i].key, merged[i].key);
+        expectEq$(radixed[i].index, merged[i].index);
+    }
+
+    return Ok();
+}
+
+test$(sortRadixFloat) {
+    Vec<f64> vec = {3.5, -1.0, 0.0, -1e10, 1e-10, -0.5, 2.0, -1e-10};
+    radixSort(vec);
+
+    for (usize i = 1; i < vec.len(); i++)
+        expectLteq$(vec[i - 1], vec[i]);
+
+    expectEq$(vec[0], -1e10);
+    expectEq$(vec[vec.len() - 1], 3.5);
+
+    return Ok();
+}
+
+} // namespace Karm::Base::Tests
@@ -0,0 +1,93 @@
+#include <karm-base/atom.h>
+#include <karm-base/string.h>
+#include <karm-test/macros.h>
+
+namespace Karm::Base::Tests {
+
+test$(stringInline) {
+    String empty;
+    String small = "hello, world";
+    String copy = small;
+    String moved = std::move(copy);
+
+    expect$(empty._isInline());
+    expect$(small._isInline());
+    expect$(moved._isInline());
+    expectEq$(empty.len(), 0uz);
+    expectEq$(empty.buf()[0], '\0');
+    expectEq$(moved.str(), Str{"hello, world"});
+    expectEq$(moved.buf()[moved.len()], '\0');
+
+    String large = "this string is too long to be stored inline";
+    expect$(not large._isInline());
+    expectEq$(large.str(), Str{"this string is too long to be stored inline"});
+
+    // Swapping storage between inline and heap strings.
+    small = std::move(large);
+    expectEq$(small.str(), Str{"this string is too long to be stored inline"});
+    expectEq$(large.str(), Str{"hello, world"});
+
+    return Ok();
+}
+
+test$(stringInlineLimit) {
+    expectEq$(sizeof(String), 24uz);
+
+    String full = "twenty-three characters";
+    expect$(full._isInline());
+    expectEq$(full.len(), 23uz);
+    expectEq$(full.str(), Str{"twenty-three characters"});
+    expectEq$(full.buf()[23], '\0');
+
+    String over = "twenty-four characters!!";
+    expect$(not over._isInline());
+    expectEq$(over.len(), 24uz);
+    expectEq$(over.str(), Str{"twenty-four characters!!"});
+
+    String moved = std::move(over);
+    expectEq$(over.len(), 0uz);
+    expectEq$(moved.len(), 24uz);
+
+    return Ok();
+}
+
+test$(stringTranscode) {
+    auto utf16 = transcode<Utf16, Utf8>(Str{"hello"});
+    expectEq$(utf16.len(), 5uz);
+    expectEq$(utf16[4], (u16)'o');
+    expectEq$(utf16.buf()[5], (u16)0);
+    expect$(utf16._isInline());
+
+    auto long16 = transcode<Utf16, Utf8>(Str{"eleven char"});
+    expect$(long16._isInline());
+    expectEq$(long16.len(), 11uz);
+    auto over16 = transcode<Utf16, Utf8>(Str{"twelve chars"});
+    expect$(not over16._isInline());
+    expectEq$(over16.len(), 12uz);
+    expectEq$(over16[11], (u16)'s');
+
+    return Ok();
+}
+
+test$(atomIntern) {
+    Atom a = "content-type";
+    Atom b = String{"content-type"};
+    Atom c = "content-length";
+
+    expect$(a == b);
+    expect$(a != c);
+    expect$(Op::eq(a, b));
+    expect$(Op::ne(a, c));
+    expect$(Op::eq(a, Str{"content-type"}));
+    expectEq$(a.hash(), hash(Str{"content-type"}));
+
+    HashMap<Atom, isize> map;
+    map.put(a, 1);
+    map.put(c, 2);
+    expectEq$(map.get(b).unwrap(), 1);
+    expectEq$(map.get(Str{"content-length"}).unwrap(), 2);
+
+    return Ok();
+}
+
+} // namespace Karm::Base::Tests
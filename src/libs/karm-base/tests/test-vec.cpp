@@ -0,0 +1,164 @@
+#include <karm-base/rc.h>
+#include <karm-base/vec.h>
+#include <karm-test/macros.h>
+
+namespace Karm::Base::Tests {
+
+static isize _alive = 0;
+
+// Not trivially relocatable, keeps track of how many instances are alive.
+struct Counted {
+    isize value;
+
+    Counted(isize v) : value(v) { _alive++; }
+
+    Counted(Counted const &other) : value(other.value) { _alive++; }
+
+    Counted(Counted &&other) : value(other.value) { _alive++; }
+
+    ~Counted() { _alive--; }
+
+    Counted &operator=(Counted const &) = default;
+
+    Counted &operator=(Counted &&) = default;
+};
+
+static_assert(Meta::TriviallyRelocatable<isize>);
+static_assert(Meta::TriviallyRelocatable<Strong<isize>>);
+static_assert(Meta::TriviallyRelocatable<Vec<Counted>>);
+static_assert(not Meta::TriviallyRelocatable<Counted>);
+
+test$(vecGrowth) {
+    Vec<isize> vec;
+    usize reallocs = 0;
+    usize cap = vec.cap();
+
+    for (isize i = 0; i < 100000; i++) {
+        vec.pushBack(i);
+        if (vec.cap() != cap) {
+            cap = vec.cap();
+            reallocs++;
+        }
+    }
+
+    // Pushing one element at a time must grow geometrically.
+    expectLteq$(reallocs, 20uz);
+
+    for (isize i = 0; i < 100000; i++)
+        expectEq$(vec[i], i);
+
+    return Ok();
+}
+
+test$(vecBulkInsert) {
+    Vec<isize> vec = {0, 1, 5, 6};
+    Array<isize, 3> mid = {2, 3, 4};
+    vec.insert(2, mid);
+    vec.append(Vec<isize>{7, 8});
+
+    expectEq$(vec.len(), 9uz);
+    for (isize i = 0; i < 9; i++)
+        expectEq$(vec[i], i);
+
+    vec.removeRange(1, 7);
+    expectEq$(vec.len(), 2uz);
+    expectEq$(vec[0], 0);
+    expectEq$(vec[1], 8);
+
+    return Ok();
+}
+
+test$(vecSelfInsert) {
+    {
+        Vec<Counted> vec;
+        for (isize i = 0; i < 4; i++)
+            vec.pushBack(Counted{i});
+
+        // Both copy from storage that has to be reallocated.
+        vec.append(vec);
+        vec.insert(1, sub(vec, 2, 4));
+
+        isize expected[] = {0, 2, 3, 1, 2, 3, 0, 1, 2, 3};
+        expectEq$(vec.len(), 10uz);
+        for (usize i = 0; i < 10; i++)
+            expectEq$(vec[i].value, expected[i]);
+        expectEq$(_alive, 10);
+    }
+
+    expectEq$(_alive, 0);
+
+    return Ok();
+}
+
+test$(vecSelfInsertInline) {
+    {
+        InlineVec<Counted, 16> vec;
+        for (isize i = 0; i < 4; i++)
+            vec.pushBack(Counted{i});
+
+        // The source straddles the insertion point, its tail gets shifted.
+        vec.append(vec);
+        vec.insert(2, sub(vec, 0, 4));
+
+        isize expected[] = {0, 1, 0, 1, 2, 3, 2, 3, 0, 1, 2, 3};
+        expectEq$(vec.len(), 12uz);
+        for (usize i = 0; i < 12; i++)
+            expectEq$(vec[i].value, expected[i]);
+        expectEq$(_alive, 12);
+
+        // Neither inline nor view storage destroys its elements.
+        vec.truncate(0);
+    }
+
+    {
+        Array<Inert<Counted>, 16> storage;
+        _Vec<ViewBuf<Counted>> vec{ViewBuf<Counted>{storage.buf(), storage.len()}};
+        for (isize i = 0; i < 4; i++)
+            vec.pushBack(Counted{i});
+
+        vec.insert(1, sub(vec, 1, 3));
+
+        isize expected[] = {0, 1, 2, 1, 2, 3};
+        expectEq$(vec.len(), 6uz);
+        for (usize i = 0; i < 6; i++)
+            expectEq$(vec[i].value, expected[i]);
+        expectEq$(_alive, 6);
+        vec.truncate(0);
+    }
+
+    expectEq$(_alive, 0);
+
+    return Ok();
+}
+
+test$(vecRelocate) {
+    {
+        Vec<Counted> vec;
+        for (isize i = 0; i < 64; i++)
+            vec.insert(0, Counted{i});
+
+        expectEq$(_alive, 64);
+
+        vec.removeRange(8, 16);
+        vec.removeAt(0);
+        expectEq$(_alive, 47);
+        expectEq$(vec[0].value, 62);
+        expectEq$(vec[7].value, 39);
+    }
+
+    expectEq$(_alive, 0);
+
+    {
+        Vec<Strong<isize>> vec;
+        auto shared = makeStrong<isize>(42);
+        for (isize i = 0; i < 64; i++)
+            vec.pushFront(shared);
+
+        vec.removeRange(0, 32);
+        expectEq$(shared._cell->_strong.load(), 33);
+    }
+
+    return Ok();
+}
+
+} // namespace Karm::Base::Tests
@@ -28,6 +28,7 @@ struct _V;
         T v##N;                                           \
         constexpr _V(T &&v) : v##N{std::forward<T>(v)} {} \
         auto visit(auto f) { return f(v##N); }            \
+        auto visit(auto f) const { return f(v##N); }      \
     }
 
 // clang-format off
@@ -48,6 +49,8 @@ struct _Tuple<I> {
     constexpr static auto inspect(auto) {}
 
     constexpr auto visit(auto) {}
+
+    constexpr auto visit(auto) const {}
 };
 
 template <usize I, typename T>
@@ -68,6 +71,10 @@ struct _Tuple<I, T> :
     constexpr auto visit(auto f) {
         return _V<I, T>::visit(f);
     }
+
+    constexpr auto visit(auto f) const {
+        return _V<I, T>::visit(f);
+    }
 };
 
 template <usize I, typename T, typename... Ts>
@@ -92,6 +99,11 @@ struct _Tuple<I, T, Ts...> :
         _V<I, T>::visit(f);
         return _Tuple<I + 1, Ts...>::visit(f);
     }
+
+    constexpr auto visit(auto f) const {
+        _V<I, T>::visit(f);
+        return _Tuple<I + 1, Ts...>::visit(f);
+    }
 };
 
 template <typename... Ts>
@@ -11,6 +11,8 @@ template <typename S, typename T = typename S::Inner>
 struct _Vec {
     using Inner = T;
 
+    static constexpr bool RELOCATABLE = Meta::TriviallyRelocatable<S>;
+
     S _buf{};
 
     constexpr _Vec() = default;
@@ -19,9 +21,9 @@ struct _Vec {
 
     _Vec(std::initializer_list<T> other) : _buf(other) {}
 
-    _Vec(Sliceable<T> auto &other) : _buf(other) {}
+    _Vec(Sliceable<T> auto const &other) : _buf(other) {}
 
-    _Vec(S storage) : _buf(storage) {}
+    _Vec(S storage) : _buf(std::move(storage)) {}
 
     /* --- Collection --- */
 
@@ -77,6 +79,10 @@ struct _Vec {
 
     void insert(usize index, T &&value) { _buf.insert(index, std::move(value)); }
 
+    void insert(usize index, Sliceable<T> auto const &other) { _buf.insert(COPY, index, other.buf(), other.len()); }
+
+    void insert(Move, usize index, MutSliceable<T> auto &other) { _buf.insert(MOVE, index, other.buf(), other.len()); }
+
     void replace(usize index, T const &value) { _buf[index] = T(value); }
 
     void replace(usize index, T &&value) { _buf[index] = std::move(value); }
@@ -89,7 +95,7 @@ struct _Vec {
 
     T const &peekFront() const { return _buf[0]; }
 
-    void pushFront(T const &value) { _buf.insert(T(value)); }
+    void pushFront(T const &value) { _buf.insert(0, T(value)); }
 
     void pushFront(T &&value) { _buf.insert(0, std::move(value)); }
 
@@ -100,7 +106,7 @@ struct _Vec {
     }
 
     template <typename... Args>
-    void emplaceFront(Args &&...args) { _buf.emplace((args)...); }
+    void emplaceFront(Args &&...args) { _buf.emplace(0, std::forward<Args>(args)...); }
 
     T popFront() { return _buf.removeAt(0); }
 
@@ -112,14 +118,14 @@ struct _Vec {
 
     void pushBack(T &&value) { insert(len(), std::move(value)); }
 
-    void pushBack(Sliceable<T> auto &other) {
-        for (auto &v : other) {
-            pushBack(v);
-        }
-    }
+    void pushBack(Sliceable<T> auto &other) { append(other); }
+
+    void append(Sliceable<T> auto const &other) { insert(len(), other); }
+
+    void append(Move, MutSliceable<T> auto &other) { insert(MOVE, len(), other); }
 
     template <typename... Args>
-    void emplaceBack(Args &&...args) { insert(len(), T(std::move(args)...)); }
+    void emplaceBack(Args &&...args) { _buf.emplace(len(), std::forward<Args>(args)...); }
 
     T popBack() { return removeAt(len() - 1); }
 
@@ -75,33 +75,48 @@ static Res<Image> loadPng(Bytes bytes) {
     return Ok(img);
 }
 
-static Res<Image> loadJpeg(Bytes bytes) {
+static Res<Image> loadJpeg(Bytes bytes, Opt<Math::Vec2i> maxSize) {
     auto jpeg = try$(Jpeg::Image::load(bytes));
-    auto img = Image::alloc({jpeg.width(), jpeg.height()});
-    try$(jpeg.decode(img));
+    usize denom = maxSize ? jpeg.scaleFor(*maxSize) : 1;
+    auto img = Image::alloc(jpeg.scaledSize(denom));
+    try$(jpeg.decode(img, denom));
     return Ok(img);
 }
 
-Res<Image> loadImage(Sys::Mmap &&map) {
-    if (Bmp::Image::isBmp(map.bytes())) {
-        return loadBmp(map.bytes());
-    } else if (Qoi::Image::isQoi(map.bytes())) {
-        return loadQoi(map.bytes());
-    } else if (Png::Image::isPng(map.bytes())) {
-        return loadPng(map.bytes());
-    } else if (Jpeg::Image::isJpeg(map.bytes())) {
-        return loadJpeg(map.bytes());
+static Res<Image> _loadImage(Bytes bytes, Opt<Math::Vec2i> maxSize) {
+    if (Bmp::Image::isBmp(bytes)) {
+        return loadBmp(bytes);
+    } else if (Qoi::Image::isQoi(bytes)) {
+        return loadQoi(bytes);
+    } else if (Png::Image::isPng(bytes)) {
+        return loadPng(bytes);
+    } else if (Jpeg::Image::isJpeg(bytes)) {
+        return loadJpeg(bytes, maxSize);
     } else {
         return Error::invalidData("unknown image format");
     }
 }
 
+Res<Image> loadImage(Sys::Mmap &&map) {
+    return _loadImage(map.bytes(), NONE);
+}
+
+Res<Image> loadImage(Sys::Mmap &&map, Math::Vec2i maxSize) {
+    return _loadImage(map.bytes(), maxSize);
+}
+
 Res<Image> loadImage(Sys::Url url) {
     auto file = try$(Sys::File::open(url));
     auto map = try$(Sys::mmap().map(file));
     return loadImage(std::move(map));
 }
 
+Res<Image> loadImage(Sys::Url url, Math::Vec2i maxSize) {
+    auto file = try$(Sys::File::open(url));
+    auto map = try$(Sys::mmap().map(file));
+    return loadImage(std::move(map), maxSize);
+}
+
 Res<Image> loadImageOrFallback(Sys::Url url) {
     if (auto result = loadImage(url); result) {
         return result;
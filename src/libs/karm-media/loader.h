@@ -23,8 +23,15 @@ Res<Font> loadFontOrFallback(f64 size, Sys::Url url);
 
 Res<Image> loadImage(Sys::Mmap &&map);
 
+/// Load an image, formats that support it (JPEG) are decoded directly at the
+/// smallest scale that is still at least `maxSize` large, the resulting
+/// image may be larger than `maxSize` but never smaller than it needs to be.
+Res<Image> loadImage(Sys::Mmap &&map, Math::Vec2i maxSize);
+
 Res<Image> loadImage(Sys::Url url);
 
+Res<Image> loadImage(Sys::Url url, Math::Vec2i maxSize);
+
 Res<Image> loadImageOrFallback(Sys::Url url);
 
 } // namespace Karm::Media
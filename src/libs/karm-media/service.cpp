@@ -0,0 +1,250 @@
+#include <karm-logger/logger.h>
+#include <karm-sys/thread.h>
+
+#include "loader.h"
+#include "service.h"
+
+namespace Karm::Media {
+
+/* --- Image Handle --------------------------------------------------------- */
+
+Opt<Res<Image>> ImageHandle::poll() {
+    if (_result)
+        return _result;
+
+    if (not _request)
+        return NONE;
+
+    _result = _service->_poll(**_request);
+    if (_result) {
+        _request = NONE;
+        _service = nullptr;
+    }
+    return _result;
+}
+
+void ImageHandle::cancel() {
+    if (not _request)
+        return;
+
+    _service->_cancel(**_request);
+    _request = NONE;
+    _service = nullptr;
+}
+
+/* --- Image Service -------------------------------------------------------- */
+
+ImageService::~ImageService() {
+    {
+        LockScope scope(_lock);
+        _stop = true;
+    }
+
+    // Wake every worker so they notice, then wait for them before tearing
+    // down the state they are working on.
+    if (_wake)
+        (*_wake)->signal(_workers.len());
+
+    for (auto &worker : _workers)
+        (void)worker->join();
+}
+
+ImageHandle ImageService::load(Sys::Url url, Math::Vec2i size) {
+    bool inline_ = false;
+    Opt<Strong<ImageRequest>> req = NONE;
+
+    {
+        LockScope scope(_lock);
+
+        if (auto image = _lookup(url, size))
+            return ImageHandle{Ok(*image)};
+
+        for (auto &p : _pending) {
+            if (Op::eq(p->url, url) and Op::eq(p->size, size)) {
+                p->interest++;
+                return {*this, p};
+            }
+        }
+
+        req = makeStrong<ImageRequest>(url, size);
+        _pending.pushBack(*req);
+        _spawnWorkers();
+        inline_ = _workers.len() == 0;
+    }
+
+    if (not inline_) {
+        (*_wake)->signal();
+    } else {
+        // Threads are not available on this platform, decode on the caller
+        // thread so the request still completes.
+        while (auto next = _take())
+            _process(*next);
+    }
+
+    return {*this, *req};
+}
+
+Opt<Image> ImageService::lookup(Sys::Url const &url, Math::Vec2i size) {
+    LockScope scope(_lock);
+    return _lookup(url, size);
+}
+
+void ImageService::purge() {
+    LockScope scope(_lock);
+    _entries.clear();
+    _lru.clear();
+    _used = 0;
+}
+
+void ImageService::_cancel(ImageRequest &req) {
+    LockScope scope(_lock);
+
+    if (req.interest > 0)
+        req.interest--;
+
+    if (req.interest > 0 or req.state != ImageRequest::State::QUEUED)
+        return;
+
+    req.state = ImageRequest::State::CANCELED;
+    for (usize i = 0; i < _pending.len(); i++) {
+        if (&*_pending[i] == &req) {
+            _pending.removeAt(i);
+            break;
+        }
+    }
+}
+
+Opt<Res<Image>> ImageService::_poll(ImageRequest &req) {
+    LockScope scope(_lock);
+    if (req.state != ImageRequest::State::DONE)
+        return NONE;
+    return req.result;
+}
+
+Opt<Image> ImageService::_lookup(Sys::Url const &url, Math::Vec2i size) {
+    auto node = _entries.get(Key{url, size});
+    if (not node)
+        return NONE;
+
+    // It's now the most recently used.
+    _lru.moveBack(*node);
+    return (*node)->buf.image;
+}
+
+void ImageService::_insert(Sys::Url const &url, Math::Vec2i size, Image image) {
+    usize bytes = image._stride * image.height();
+
+    // Don't flush the whole cache for an image that would not fit anyway.
+    if (bytes > _budget)
+        return;
+
+    Key key{url, size};
+    if (auto node = _entries.get(key)) {
+        _used -= (*node)->buf.bytes;
+        _lru.removeNode(*node);
+    }
+
+    _lru.emplaceBack(Entry{key, image, bytes});
+    _entries.put(key, _lru._tail);
+    _used += bytes;
+
+    while (_used > _budget) {
+        auto *lru = _lru._head;
+        _used -= lru->buf.bytes;
+        _entries.remove(lru->buf.key);
+        _lru.removeNode(lru);
+    }
+}
+
+Opt<Strong<ImageRequest>> ImageService::_take() {
+    LockScope scope(_lock);
+
+    // Most recent requests first, they are the most likely to still be
+    // on screen.
+    for (usize i = _pending.len(); i > 0; i--) {
+        auto &p = _pending[i - 1];
+        if (p->state == ImageRequest::State::QUEUED) {
+            p->state = ImageRequest::State::DECODING;
+            return p;
+        }
+    }
+
+    return NONE;
+}
+
+void ImageService::_process(Strong<ImageRequest> req) {
+    auto result = Op::eq(req->size, Math::Vec2i{})
+                      ? loadImage(req->url)
+                      : loadImage(req->url, req->size);
+
+    if (not result)
+        logError("media: failed to load '{}': {}", req->url, result.none().msg());
+
+    LockScope scope(_lock);
+
+    if (result)
+        _insert(req->url, req->size, result.unwrap());
+
+    req->result = result;
+    req->state = ImageRequest::State::DONE;
+
+    for (usize i = 0; i < _pending.len(); i++) {
+        if (&*_pending[i] == &*req) {
+            _pending.removeAt(i);
+            break;
+        }
+    }
+}
+
+void ImageService::_spawnWorkers() {
+    usize queued = 0;
+    for (auto &p : _pending) {
+        if (p->state == ImageRequest::State::QUEUED)
+            queued++;
+    }
+
+    if (_workers.len() >= min(_threads, queued))
+        return;
+
+    if (not _wake) {
+        auto wake = Sys::Sema::create();
+        if (not wake)
+            return;
+        _wake = wake.take();
+    }
+
+    while (_workers.len() < _threads and _workers.len() < queued) {
+        auto thread = Sys::spawn([this] {
+            _worker();
+        });
+
+        if (not thread)
+            break;
+
+        _workers.pushBack(thread.take());
+    }
+}
+
+void ImageService::_worker() {
+    while (true) {
+        (*_wake)->wait();
+
+        {
+            LockScope scope(_lock);
+            if (_stop)
+                return;
+        }
+
+        // The request might have been canceled since, then there is
+        // nothing to take.
+        if (auto req = _take())
+            _process(*req);
+    }
+}
+
+ImageService &imageService() {
+    static ImageService service;
+    return service;
+}
+
+} // namespace Karm::Media
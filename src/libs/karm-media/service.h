@@ -0,0 +1,165 @@
+#pragma once
+
+#include <karm-base/hashmap.h>
+#include <karm-base/list.h>
+#include <karm-base/lock.h>
+#include <karm-base/size.h>
+#include <karm-sys/mutex.h>
+#include <karm-sys/thread.h>
+#include <karm-sys/url.h>
+
+#include "image.h"
+
+namespace Karm::Media {
+
+/* --- Image Request -------------------------------------------------------- */
+
+struct ImageService;
+
+struct ImageRequest {
+    enum struct State {
+        QUEUED,
+        DECODING,
+        DONE,
+        CANCELED,
+    };
+
+    Sys::Url url;
+    Math::Vec2i size;
+
+    // All the fields bellow are protected by the service lock.
+    State state = State::QUEUED;
+    usize interest = 1;
+    Opt<Res<Image>> result = NONE;
+
+    ImageRequest(Sys::Url url, Math::Vec2i size)
+        : url(url), size(size) {}
+};
+
+/* --- Image Handle --------------------------------------------------------- */
+
+/// A handle on an image that is being loaded by the image service, dropping
+/// the handle cancels the request if nobody else is waiting on it.
+struct ImageHandle : Meta::NoCopy {
+    ImageService *_service = nullptr;
+    Opt<Strong<ImageRequest>> _request = NONE;
+    Opt<Res<Image>> _result = NONE;
+
+    ImageHandle() = default;
+
+    ImageHandle(Res<Image> result)
+        : _result(result) {}
+
+    ImageHandle(ImageService &service, Strong<ImageRequest> request)
+        : _service(&service), _request(request) {}
+
+    ImageHandle(ImageHandle &&other)
+        : _service(std::exchange(other._service, nullptr)),
+          _request(std::exchange(other._request, NONE)),
+          _result(std::exchange(other._result, NONE)) {}
+
+    ImageHandle &operator=(ImageHandle &&other) {
+        if (this != &other) {
+            cancel();
+            _service = std::exchange(other._service, nullptr);
+            _request = std::exchange(other._request, NONE);
+            _result = std::exchange(other._result, NONE);
+        }
+        return *this;
+    }
+
+    ~ImageHandle() {
+        cancel();
+    }
+
+    /// Returns true while the request is in flight.
+    bool pending() const {
+        return _request.has();
+    }
+
+    /// Returns the result of the request once it completed, or NONE while
+    /// the image is still being decoded.
+    Opt<Res<Image>> poll();
+
+    /// Gives up on the request, if no other handle is waiting on it and it
+    /// didn't start yet, it's removed from the queue.
+    void cancel();
+};
+
+/* --- Image Service -------------------------------------------------------- */
+
+/// Decodes images on a pool of worker threads and keeps the most recently
+/// used ones in memory. Requests are keyed by url and requested size, two
+/// requests for the same key share a single decode.
+struct ImageService : Meta::Static {
+    static constexpr usize DEFAULT_THREADS = 2;
+    static constexpr usize DEFAULT_BUDGET = mib(64);
+
+    struct Key {
+        Sys::Url url;
+        Math::Vec2i size;
+
+        Ordr cmp(Key const &other) const {
+            return ::cmp(url, other.url) | ::cmp(size, other.size);
+        }
+
+        u64 hash() const {
+            return hashCombine(url.hash(), hashCombine(Karm::hash(size.x), Karm::hash(size.y)));
+        }
+    };
+
+    struct Entry {
+        Key key;
+        Image image;
+        usize bytes;
+    };
+
+    usize _threads;
+    usize _budget;
+
+    Lock _lock;
+    bool _stop = false;
+    usize _used = 0;
+    List<Entry> _lru;                           // Least recently used first
+    HashMap<Key, List<Entry>::Node *> _entries; // Nodes of _lru by key
+    Vec<Strong<ImageRequest>> _pending;         // Queued or decoding
+
+    // Workers sleep on the semaphore, it's signaled once per queued request.
+    Opt<Strong<Sys::Sema>> _wake;
+    Vec<Strong<Sys::Thread>> _workers;
+
+    ImageService(usize threads = DEFAULT_THREADS, usize budget = DEFAULT_BUDGET)
+        : _threads(threads), _budget(budget) {}
+
+    ~ImageService();
+
+    /// Request the image at `url`, a zero `size` loads the image at its
+    /// natural size, otherwise see `loadImage(Sys::Url, Math::Vec2i)`.
+    ImageHandle load(Sys::Url url, Math::Vec2i size = {});
+
+    /// Returns the image if it's already in the cache.
+    Opt<Image> lookup(Sys::Url const &url, Math::Vec2i size = {});
+
+    /// Drops all the cached images, pending requests are left untouched.
+    void purge();
+
+    void _cancel(ImageRequest &req);
+
+    Opt<Res<Image>> _poll(ImageRequest &req);
+
+    Opt<Image> _lookup(Sys::Url const &url, Math::Vec2i size);
+
+    void _insert(Sys::Url const &url, Math::Vec2i size, Image image);
+
+    Opt<Strong<ImageRequest>> _take();
+
+    void _process(Strong<ImageRequest> req);
+
+    void _spawnWorkers();
+
+    void _worker();
+};
+
+ImageService &imageService();
+
+} // namespace Karm::Media
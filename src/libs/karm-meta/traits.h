@@ -57,6 +57,20 @@ concept Integral = __is_integral(T);
 template <typename T>
 concept Trivial = __is_trivial(T);
 
+template <typename T>
+concept TriviallyCopyable = __is_trivially_copyable(T);
+
+template <typename T>
+concept TriviallyDestructible = __is_trivially_destructible(T);
+
+/// Objects that can be moved to a new address with a plain memcpy(), the
+/// source is then discarded without running its destructor. Types that are
+/// not trivially copyable opt in with `static constexpr bool RELOCATABLE`.
+template <typename T>
+concept TriviallyRelocatable =
+    TriviallyCopyable<T> or
+    requires { requires T::RELOCATABLE; };
+
 template <typename T>
 concept Signed = __is_signed(T);
 
@@ -18,17 +18,20 @@ struct Mutext {
 };
 
 struct Sema {
-    Res<Strong<Sema>> create();
+    /// Create a semaphore with an initial `count`, platforms without
+    /// threads support return `Error::notImplemented()`.
+    static Res<Strong<Sema>> create(usize count = 0);
 
     virtual ~Sema() = default;
 
+    /// Block until the count is positive, then decrement it.
     virtual void wait() = 0;
 
-    virtual void tryWait() = 0;
+    /// Decrement the count if it's positive, returns false otherwise.
+    virtual bool tryWait() = 0;
 
+    /// Add `n` to the count, waking up to `n` waiting threads.
     virtual void signal(usize n = 1) = 0;
-
-    virtual void count() = 0;
 };
 
 struct CondVar {
@@ -0,0 +1,16 @@
+#include <embed-sys/sys.h>
+
+#include "mutex.h"
+#include "thread.h"
+
+namespace Karm::Sys {
+
+Res<Strong<Thread>> spawn(Func<void()> entry) {
+    return Embed::spawnThread(std::move(entry));
+}
+
+Res<Strong<Sema>> Sema::create(usize count) {
+    return Embed::createSema(count);
+}
+
+} // namespace Karm::Sys
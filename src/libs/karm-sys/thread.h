@@ -68,15 +68,15 @@ Cons<Tx<T>, Rx<T>> makeChannel() {
 }
 
 struct Thread {
-    Res<Thread> spawn(Func<void(void)>);
+    virtual ~Thread() = default;
 
-    void join();
-
-    void detach();
-
-    void exit();
-
-    void sleep(isize ms);
+    /// Wait for the thread to finish, dropping a thread
+    /// that was not joined detaches it.
+    virtual Res<> join() = 0;
 };
 
+/// Spawn a new thread running `entry`, platforms without
+/// threads support return `Error::notImplemented()`.
+Res<Strong<Thread>> spawn(Func<void()> entry);
+
 } // namespace Karm::Sys
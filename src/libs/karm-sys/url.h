@@ -1,5 +1,6 @@
 #pragma once
 
+#include <karm-base/hash.h>
 #include <karm-base/panic.h>
 #include <karm-base/string.h>
 #include <karm-base/vec.h>
@@ -44,6 +45,10 @@ struct Path {
                ::cmp(_parts, other._parts);
     }
 
+    u64 hash() const {
+        return hashCombine(Karm::hash(rooted), Karm::hash(_parts));
+    }
+
     auto iter() const {
         return ::iter(_parts);
     }
@@ -96,6 +101,16 @@ struct Url {
                ::cmp(fragment, other.fragment);
     }
 
+    u64 hash() const {
+        u64 h = Karm::hash(scheme);
+        h = hashCombine(h, Karm::hash(authority));
+        h = hashCombine(h, Karm::hash(host));
+        h = hashCombine(h, port ? Karm::hash(*port) : 0);
+        h = hashCombine(h, path.hash());
+        h = hashCombine(h, Karm::hash(query));
+        return hashCombine(h, Karm::hash(fragment));
+    }
+
     auto iter() const {
         return path.iter();
     }
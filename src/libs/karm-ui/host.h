@@ -95,6 +95,10 @@ struct PerfGraph {
         g.fillStyle(Gfx::WHITE);
         g.fill({8, 16}, text);
 
+        auto stats = frameArena().stats();
+        auto arena = Fmt::format("Frame arena: {}KiB peak", stats.peak / 1024).take();
+        g.fill({8, 32}, arena);
+
         g.restore();
     }
 };
@@ -179,6 +183,8 @@ struct Host : public Node {
 
         flip(_dirty);
         _dirty.clear();
+
+        frameArena().reset();
     }
 
     void event(Events::Event &e) override {
@@ -560,8 +560,6 @@ struct GridLayout : public GroupNode<GridLayout> {
     };
 
     GridStyle _style;
-    Vec<_Dim> _rows;
-    Vec<_Dim> _columns;
 
     GridLayout(GridStyle style, Children children)
         : GroupNode(children), _style(style) {}
@@ -610,16 +608,12 @@ struct GridLayout : public GroupNode<GridLayout> {
         return (growTotal) / max(1, grows);
     }
 
-    void place(Child child, Math::Vec2i pos) {
-        place(child, pos, pos);
-    }
-
-    void place(Child child, Math::Vec2i start, Math::Vec2i end) {
-        auto startRow = _rows[start.y];
-        auto startColumn = _columns[start.x];
+    static void place(Child child, Slice<_Dim> rows, Slice<_Dim> columns, Math::Vec2i start, Math::Vec2i end) {
+        auto startRow = rows[start.y];
+        auto startColumn = columns[start.x];
 
-        auto endRow = _rows[end.y];
-        auto endColumn = _columns[end.x];
+        auto endRow = rows[end.y];
+        auto endColumn = columns[end.x];
 
         auto childRect = Math::Recti{
             startColumn.start,
@@ -634,31 +628,35 @@ struct GridLayout : public GroupNode<GridLayout> {
     void layout(Math::Recti r) override {
         _bound = r;
 
+        // The dimensions only live for this pass, nested grids push theirs
+        // on top and everything is given back when we are done.
+        ArenaScope scope{frameArena()};
+
         // compute the dimensions of the grid
-        _rows.clear();
+        ArenaVec<_Dim> rows{ArenaBuf<_Dim>{frameArena(), _style.rows.len()}};
         isize growUnitRows = computeGrowUnitRows(r);
         isize row = _style.flow.getTop(r);
         for (auto &r : _style.rows) {
             if (r.unit == GridUnit::GROW) {
-                _rows.pushBack({_Dim{row, growUnitRows * r.value}});
+                rows.pushBack({_Dim{row, growUnitRows * r.value}});
                 row += growUnitRows * r.value;
             } else {
-                _rows.pushBack({_Dim{row, r.value}});
+                rows.pushBack({_Dim{row, r.value}});
                 row += r.value;
             }
 
             row += _style.gaps.y;
         }
 
-        _columns.clear();
+        ArenaVec<_Dim> columns{ArenaBuf<_Dim>{frameArena(), _style.columns.len()}};
         isize growUnitColumns = computeGrowUnitColumns(r);
         isize column = _style.flow.getStart(r);
         for (auto &c : _style.columns) {
             if (c.unit == GridUnit::GROW) {
-                _columns.pushBack({_Dim{column, growUnitColumns * c.value}});
+                columns.pushBack({_Dim{column, growUnitColumns * c.value}});
                 column += growUnitColumns * c.value;
             } else {
-                _columns.pushBack({_Dim{column, c.value}});
+                columns.pushBack({_Dim{column, c.value}});
                 column += c.value;
             }
 
@@ -672,13 +670,13 @@ struct GridLayout : public GroupNode<GridLayout> {
                 auto &cell = child.unwrap<Cell>();
                 auto start = cell.start();
                 auto end = cell.end();
-                place(child, start, end);
-                index = end.y * _columns.len() + end.x;
+                place(child, rows, columns, start, end);
+                index = end.y * columns.len() + end.x;
             } else {
-                isize row = index / _columns.len();
-                isize column = index % _columns.len();
+                isize row = index / columns.len();
+                isize column = index % columns.len();
 
-                place(child, {column, row});
+                place(child, rows, columns, {column, row}, {column, row});
             }
             index++;
         }
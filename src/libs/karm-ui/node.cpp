@@ -9,4 +9,9 @@ bool debugShowScrollBounds = false;
 bool debugShowPerfGraph = false;
 int debugNodeCount = 0;
 
+Arena &frameArena() {
+    static Arena arena;
+    return arena;
+}
+
 } // namespace Karm::Ui
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <karm-base/arena.h>
 #include <karm-base/func.h>
 #include <karm-base/rc.h>
 #include <karm-events/events.h>
@@ -18,6 +19,11 @@ extern bool debugShowScrollBounds;
 extern bool debugShowPerfGraph;
 extern int debugNodeCount;
 
+/// Scratch memory for the frame being laid out and painted, the host resets
+/// it once the frame is on screen, nothing allocated from it may outlive the
+/// paint.
+Arena &frameArena();
+
 struct Node;
 
 using Child = Strong<Node>;
@@ -27,6 +33,9 @@ using Visitor = Func<void(Node &)>;
 /* --- Node ----------------------------------------------------------------- */
 
 struct Node : public Meta::Static {
+    // Nodes are rebuilt on every state change, their cells come from slabs.
+    static constexpr bool SLAB = true;
+
     Node() {
         debugNodeCount++;
     }
@@ -1,5 +1,7 @@
 #include "view.h"
 
+#include "funcs.h"
+
 namespace Karm::Ui {
 
 /* --- Text ----------------------------------------------------------------- */
@@ -301,6 +303,105 @@ Child image(Media::Image image, Gfx::BorderRadius radius) {
     return makeStrong<Image>(image, radius);
 }
 
+struct AsyncImage : public View<AsyncImage> {
+    Sys::Url _url;
+    Math::Vec2i _size;
+    Opt<Gfx::BorderRadius> _radius;
+
+    Media::ImageHandle _handle;
+    Opt<Media::Image> _image;
+    bool _failed = false;
+    bool _painted = false;
+
+    AsyncImage(Sys::Url url, Math::Vec2i size, Opt<Gfx::BorderRadius> radius)
+        : _url(url), _size(size), _radius(radius) {}
+
+    void reconcile(AsyncImage &o) override {
+        if (Op::ne(o._url, _url) or Op::ne(o._size, _size)) {
+            _handle = {};
+            _image = NONE;
+            _failed = false;
+        }
+
+        _url = o._url;
+        _size = o._size;
+        _radius = o._radius;
+        View<AsyncImage>::reconcile(o);
+    }
+
+    bool _poll() {
+        auto res = _handle.poll();
+        if (not res)
+            return false;
+
+        if (*res)
+            _image = res->unwrap();
+        else
+            _failed = true;
+        return true;
+    }
+
+    void paint(Gfx::Context &g, Math::Recti) override {
+        _painted = true;
+
+        if (not _image and not _failed and not _handle.pending()) {
+            _handle = Media::imageService().load(_url, _size);
+
+            // Cache hits complete right away, otherwise keep ticking until
+            // the decode is done, we can't ask for a repaint while painting.
+            if (not _poll())
+                shouldAnimate(*this);
+        }
+
+        if (_image and _radius) {
+            g.fillStyle(*_image);
+            g.fill(bound(), *_radius);
+        } else if (_image) {
+            g.blit(bound(), *_image);
+        } else {
+            g.fillStyle(GRAY900);
+            g.fill(bound(), tryOr(_radius, 0));
+        }
+
+        if (debugShowLayoutBounds)
+            g.debugRect(bound(), Gfx::CYAN);
+    }
+
+    void event(Events::Event &e) override {
+        if (not e.is<Events::AnimateEvent>() or not _handle.pending())
+            return;
+
+        // Nodes that are out of view are not painted, if we didn't get
+        // painted since the last frame nobody is looking at us anymore.
+        if (not _painted) {
+            _handle.cancel();
+            return;
+        }
+
+        _painted = false;
+        if (_poll() and not _size.x and not _size.y)
+            shouldLayout(*this);
+        shouldRepaint(*this);
+
+        if (_handle.pending())
+            shouldAnimate(*this);
+    }
+
+    Math::Vec2i size(Math::Vec2i, Layout::Hint) override {
+        if (_size.x or _size.y or not _image)
+            return _size;
+        return _image->bound().size().cast<isize>();
+    }
+};
+
+Child image(Sys::Url url, Math::Vec2i size) {
+    return makeStrong<AsyncImage>(url, size, NONE);
+}
+
+Child image(Sys::Url url, Math::Vec2i size, Gfx::BorderRadius radius) {
+    return makeStrong<AsyncImage>(url, size, radius);
+}
+
 /* --- Canvas --------------------------------------------------------------- */
 
 struct Canvas : public View<Canvas> {
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <karm-media/service.h>
+
 #include "node.h"
 
 namespace Karm::Ui {
@@ -114,6 +116,13 @@ Child image(Media::Image image);
 
 Child image(Media::Image image, Gfx::BorderRadius radius);
 
+/// An image loaded in the background by the image service, a placeholder is
+/// shown until the decode completes. Requests are canceled when the node
+/// stops being painted, e.g. when it's scrolled out of view.
+Child image(Sys::Url url, Math::Vec2i size);
+
+Child image(Sys::Url url, Math::Vec2i size, Gfx::BorderRadius radius);
+
 /* --- Canvas --------------------------------------------------------------- */
 
 using OnPaint = Func<void(Gfx::Context &g, Math::Vec2i size)>;
@@ -226,4 +226,90 @@ struct Image {
     }
 };
 
+/* --- Encoder -------------------------------------------------------------- */
+
+/// Encode `pixels` as an uncompressed 32 bits per pixel top-down BMP image,
+/// the output is produced in small chunks through `writer`.
+static inline Res<> encode(Gfx::Pixels pixels, Io::Writer &writer) {
+    static constexpr usize HEADER_SIZE = 14 + 40;
+
+    Array<u8, 4096> buf;
+    usize len = 0;
+
+    auto flush = [&]() -> Res<> {
+        usize written = 0;
+        while (written < len) {
+            usize n = try$(writer.write(Bytes{buf.buf() + written, len - written}));
+            if (n == 0)
+                return Error::writeZero();
+            written += n;
+        }
+        len = 0;
+        return Ok();
+    };
+
+    auto emit = [&](u8 b) {
+        buf[len++] = b;
+    };
+
+    auto emitU16le = [&](u16 v) {
+        emit(v);
+        emit(v >> 8);
+    };
+
+    auto emitU32le = [&](u32 v) {
+        emit(v);
+        emit(v >> 8);
+        emit(v >> 16);
+        emit(v >> 24);
+    };
+
+    usize dataSize = pixels.width() * pixels.height() * 4;
+
+    // File header
+    emit(0x42);
+    emit(0x4D);
+    emitU32le(HEADER_SIZE + dataSize);
+    emitU32le(0); // reserved
+    emitU32le(HEADER_SIZE);
+
+    // Info header, a negative height stores the rows top to bottom
+    emitU32le(40);
+    emitU32le(pixels.width());
+    emitU32le(-pixels.height());
+    emitU16le(1);  // planes
+    emitU16le(32); // bpp
+    emitU32le(Image::RGB);
+    emitU32le(dataSize);
+    emitU32le(2835); // x pixels per meter, 72 dpi
+    emitU32le(2835); // y pixels per meter
+    emitU32le(0);    // colors
+    emitU32le(0);    // important colors
+
+    try$(pixels.fmt().visit([&](auto f) -> Res<> {
+        usize bpp = f.bpp();
+
+        for (isize y = 0; y < pixels.height(); y++) {
+            u8 const *row = static_cast<u8 const *>(pixels.scanline(y));
+
+            for (isize x = 0; x < pixels.width(); x++) {
+                if (len + 4 > buf.len())
+                    try$(flush());
+
+                // NOTE: The decoder reads the fourth byte as transparency,
+                //       so opaque pixels get the usual 0.
+                Gfx::Color pixel = f.load(row + x * bpp);
+                emit(pixel.blue);
+                emit(pixel.green);
+                emit(pixel.red);
+                emit(255 - pixel.alpha);
+            }
+        }
+
+        return Ok();
+    }));
+
+    return flush();
+}
+
 } // namespace Bmp
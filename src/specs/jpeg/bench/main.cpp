@@ -0,0 +1,65 @@
+#include <jpeg/spec.h>
+#include <karm-main/main.h>
+#include <karm-media/image.h>
+#include <karm-sys/file.h>
+#include <karm-sys/mmap.h>
+#include <karm-sys/time.h>
+#include <karm-text/scan.h>
+
+// Usage: jpeg-spec-bench <image> [max-threads] [rounds]
+//
+// Decodes the image with 1 up to max-threads threads and prints the mean
+// time per decode and the speedup over a single thread. Every output is
+// checked against the serial decode.
+
+static usize _argOr(ArgsHook &args, usize i, usize fallback) {
+    if (i >= args.len())
+        return fallback;
+    Text::Scan s{args[i]};
+    auto value = s.nextUint();
+    return value ? value.unwrap() : fallback;
+}
+
+static bool _same(Media::Image const &a, Media::Image const &b) {
+    return a._buf->len() == b._buf->len() and
+           memcmp(a._buf->buf(), b._buf->buf(), a._buf->len()) == 0;
+}
+
+Res<> entryPoint(Ctx &ctx) {
+    auto &args = useArgs(ctx);
+    if (args.len() < 1)
+        return Error::invalidInput("usage: jpeg-spec-bench <image> [max-threads] [rounds]");
+
+    usize maxThreads = max(_argOr(args, 1, 8), 1uz);
+    usize rounds = max(_argOr(args, 2, 16), 1uz);
+
+    auto url = try$(Sys::parseUrlOrPath(args[0]));
+    auto file = try$(Sys::File::open(url));
+    auto map = try$(Sys::mmap().map(file));
+    auto jpeg = try$(Jpeg::Image::load(map.bytes()));
+
+    auto reference = Media::Image::alloc({jpeg.width(), jpeg.height()});
+    try$(jpeg.decode(reference.mutPixels()));
+
+    Sys::println("{}x{}, {} segments, {} rounds", jpeg.width(), jpeg.height(), jpeg._segments.len(), rounds);
+
+    f64 serial = 0;
+    for (usize threads = 1; threads <= maxThreads; threads++) {
+        auto img = Media::Image::alloc({jpeg.width(), jpeg.height()});
+
+        auto start = Sys::now();
+        for (usize i = 0; i < rounds; i++)
+            try$(jpeg.decodeParallel(img.mutPixels(), threads));
+        f64 elapsed = (Sys::now() - start).toUSecs() / (f64)rounds / 1000.0;
+
+        if (threads == 1)
+            serial = elapsed;
+
+        if (not _same(img, reference))
+            return Error::other("parallel output differs from the serial decode");
+
+        Sys::println("{} threads: {}ms, {}x", threads, elapsed, serial / elapsed);
+    }
+
+    return Ok();
+}
@@ -12,6 +12,7 @@
 #include <karm-gfx/buffer.h>
 #include <karm-gfx/colors.h>
 #include <karm-logger/logger.h>
+#include <karm-sys/thread.h>
 #include <karm-text/emit.h>
 
 #include "../bscan.h"
@@ -229,7 +230,7 @@ struct Image {
                 try$(image.defineHuffmanTable(s));
             } else if (marker == SOS) {
                 try$(image.startOfScan(s));
-                try$(image.decodeHuffman(s));
+                try$(image.skipScan(s));
             } else if (marker == EOI) {
                 reachedEoi = true;
             } else if (marker == TEM) {
@@ -398,29 +399,27 @@ struct Image {
     struct HuffmanTable {
         Array<u8, 17> offs = {};
         Array<u8, 162> syms = {};
-        Opt<Array<usize, 256>> _codes = {};
-
-        Array<usize, 256> const &codes() {
-            if (not _codes) {
-                _codes.emplace();
-                usize code = 0;
-                for (usize i = 0; i < 16; ++i) {
-                    for (usize j = offs[i]; j < offs[i + 1]; ++j) {
-                        (*_codes)[j] = code;
-                        ++code;
-                    }
-                    code <<= 1;
+        Array<usize, 162> codes = {};
+
+        // Called once the table is read, lookups are then read-only and
+        // can be shared by the decode workers.
+        void buildCodes() {
+            usize code = 0;
+            for (usize i = 0; i < 16; ++i) {
+                for (usize j = offs[i]; j < offs[i + 1]; ++j) {
+                    codes[j] = code;
+                    ++code;
                 }
+                code <<= 1;
             }
-            return *_codes;
         }
 
-        Res<Byte> next(BitStream &bs) {
+        Res<Byte> next(BitStream &bs) const {
             usize code = 0;
             for (usize i = 0; i < 16; ++i) {
                 code = (code << 1) | try$(bs.nextBit());
                 for (usize j = offs[i]; j < offs[i + 1]; ++j) {
-                    if (code == codes()[j]) {
+                    if (code == codes[j]) {
                         return Ok(syms[j]);
                     }
                 }
@@ -466,6 +465,8 @@ struct Image {
             for (usize i = 0; i < sum; ++i) {
                 table.syms[i] = s.nextU8be();
             }
+
+            table.buildCodes();
         }
 
         return Ok();
@@ -568,103 +569,143 @@ struct Image {
 
     using Mcu = Array<i16, 64>;
 
-    Vec<Mcu> _mcus;
+    // NOTE: The entropy-coded data is only located here, it is decoded
+    //       lazily, one MCU row at a time, by decode().
+    Bytes _scan;
 
-    Res<> decodeHuffman(BScan &s) {
-        _mcus.resize(mcuWidth() * mcuHeight() * _componentCount);
+    // Entropy-coded segments delimited by RSTn markers, they can
+    // be decoded independently of each others.
+    Vec<Bytes> _segments;
 
-        Array<isize, 3> prevDc = {};
+    Res<> skipScan(BScan &s) {
+        BScan begin = s;
+        usize start = s.tell();
 
-        BitStream bs{s};
-
-        for (usize i = 0; i < _mcus.len(); ++i) {
-            Mcu &mcu = _mcus[i];
-            usize cid = i % _componentCount;
+        BScan segment = s;
+        usize segmentStart = start;
 
-            // logDebug("jpeg: decoding mcu {} of {} (cid: {})", i + 1, _mcus.len(), cid);
+        _segments.clear();
 
-            // handle restart interval
-            if (_restartInterval > 0 and (i / _componentCount) % _restartInterval == 0) {
-                prevDc = {};
-                bs.reset();
+        while (not s.ended()) {
+            if (s.peekU8be() != 0xFF) {
+                s.skip(1);
+                continue;
             }
 
-            if (not _scanComponents[cid]) {
-                logError("jpeg: undefined component id: {}", cid);
-                return Error::invalidData("undefined component id");
+            u8 marker = s.peek(1).peekU8be();
+            if (marker == 0x00) {
+                s.skip(2);
+            } else if (RST0 <= marker and marker <= RST7) {
+                _segments.pushBack(segment.nextBytes(s.tell() - segmentStart));
+                s.skip(2);
+                segment = s;
+                segmentStart = s.tell();
+            } else if (marker == 0xFF) {
+                s.skip(1);
+            } else {
+                break;
             }
+        }
 
-            auto &c = _scanComponents[cid].unwrap();
+        _segments.pushBack(segment.nextBytes(s.tell() - segmentStart));
+        _scan = begin.nextBytes(s.tell() - start);
+        return Ok();
+    }
 
-            // logDebug("jpeg: decoding using huffman table (dc: {}, ac: {})", c.dcHuffId, c.acHuffId);
+    Res<> decodeBlock(BitStream &bs, usize cid, isize &prevDc, Mcu &mcu) const {
+        if (not _scanComponents[cid]) {
+            logError("jpeg: undefined component id: {}", cid);
+            return Error::invalidData("undefined component id");
+        }
 
-            if (not _dcHuff[c.dcHuffId]) {
-                logError("jpeg: undefined dc huffman table id: {}", c.dcHuffId);
-                return Error::invalidData("undefined dc huffman table id");
-            }
+        auto const &c = _scanComponents[cid].unwrap();
+
+        if (not _dcHuff[c.dcHuffId]) {
+            logError("jpeg: undefined dc huffman table id: {}", c.dcHuffId);
+            return Error::invalidData("undefined dc huffman table id");
+        }
 
-            auto &dcHuff = _dcHuff[c.dcHuffId].unwrap();
+        auto const &dcHuff = _dcHuff[c.dcHuffId].unwrap();
 
-            if (not _acHuff[c.acHuffId]) {
-                logError("jpeg: undefined ac huffman table id: {}", c.acHuffId);
-                return Error::invalidData("undefined ac huffman table id");
-            }
+        if (not _acHuff[c.acHuffId]) {
+            logError("jpeg: undefined ac huffman table id: {}", c.acHuffId);
+            return Error::invalidData("undefined ac huffman table id");
+        }
+
+        auto const &acHuff = _acHuff[c.acHuffId].unwrap();
+
+        mcu = {};
+
+        Byte len = try$(dcHuff.next(bs));
 
-            auto &acHuff = _acHuff[c.acHuffId].unwrap();
+        if (len > 11) {
+            logError("jpeg: invalid dc huffman code length: {}", len);
+            return Error::invalidData("invalid dc huffman code length");
+        }
+
+        isize coeff = try$(bs.nextBits(len));
+
+        if (len != 0 and coeff < (1 << (len - 1))) {
+            coeff -= (1 << len) - 1;
+        }
+
+        mcu[0] = prevDc + coeff;
+        prevDc = mcu[0];
 
-            Byte len = try$(dcHuff.next(bs));
+        usize k = 1;
+        while (k < 64) {
+            Byte sym = try$(acHuff.next(bs));
 
-            if (len > 11) {
-                logError("jpeg: invalid dc huffman code length: {}", len);
-                return Error::invalidData("invalid dc huffman code length");
+            if (sym == 0) {
+                break;
             }
 
-            isize coeff = try$(bs.nextBits(len));
+            Byte numZeroes = sym >> 4;
 
-            if (len != 0 and coeff < (1 << (len - 1))) {
-                coeff -= (1 << len) - 1;
+            if (sym == 0xF0) {
+                numZeroes = 16;
             }
 
-            mcu[0] = prevDc[cid] + coeff;
-            prevDc[cid] = mcu[0];
+            if (k + numZeroes >= 64) {
+                logError("jpeg: zero run length exceeds block size: {}", k + numZeroes);
+                return Error::invalidData("zero run length exceeds block size");
+            }
 
-            usize k = 1;
-            while (k < 64) {
-                Byte sym = try$(acHuff.next(bs));
+            k += numZeroes;
 
-                if (sym == 0) {
-                    break;
-                }
+            Byte len = sym & 0xF;
 
-                Byte numZeroes = sym >> 4;
+            if (len > 10) {
+                logError("jpeg: invalid ac huffman code length: {}", len);
+                return Error::invalidData("invalid ac huffman code length");
+            }
 
-                if (sym == 0xF0) {
-                    numZeroes = 16;
-                }
+            if (len) {
+                coeff = try$(bs.nextBits(len));
 
-                if (k + numZeroes >= 64) {
-                    logError("jpeg: zero run length exceeds block size: {}", k + numZeroes);
-                    return Error::invalidData("zero run length exceeds block size");
+                if (coeff < (1 << (len - 1))) {
+                    coeff -= (1 << len) - 1;
                 }
 
-                k += numZeroes;
-
-                Byte len = sym & 0xF;
+                mcu[ZIGZAG[k++]] = coeff;
+            }
+        }
 
-                if (len > 10) {
-                    logError("jpeg: invalid ac huffman code length: {}", len);
-                    return Error::invalidData("invalid ac huffman code length");
-                }
+        return Ok();
+    }
 
-                if (len) {
-                    coeff = try$(bs.nextBits(len));
+    Res<> decodeMcuRow(BitStream &bs, Array<isize, 4> &prevDc, isize mcuY, MutSlice<Mcu> row) const {
+        for (isize x = 0; x < mcuWidth(); ++x) {
+            usize i = mcuY * mcuWidth() + x;
 
-                    if (coeff < (1 << (len - 1))) {
-                        coeff -= (1 << len) - 1;
-                    }
+            // handle restart interval
+            if (_restartInterval > 0 and i % _restartInterval == 0) {
+                prevDc = {};
+                bs.reset();
+            }
 
-                    mcu[ZIGZAG[k++]] = coeff;
-                }
+            for (usize cid = 0; cid < _componentCount; ++cid) {
+                try$(decodeBlock(bs, cid, prevDc[cid], row[x * _componentCount + cid]));
             }
         }
 
@@ -673,7 +714,7 @@ struct Image {
 
     /* --- Decoding --------------------------------------------------------- */
 
-    void idtc(Array<short, 64> &mcu) {
+    void idtc(Array<short, 64> &mcu) const {
         f32 m0 = 2.0 * Math::cos(1.0 / 16.0 * 2.0 * Math::PI);
         f32 m1 = 2.0 * Math::cos(2.0 / 16.0 * 2.0 * Math::PI);
         f32 m3 = 2.0 * Math::cos(2.0 / 16.0 * 2.0 * Math::PI);
@@ -827,43 +868,441 @@ struct Image {
         }
     }
 
-    Res<> decode(Gfx::MutPixels pixels) {
-        for (usize i = 0; i < _mcus.len(); i += _componentCount) {
-            usize x = (i / _componentCount) % mcuWidth();
-            usize y = (i / _componentCount) / mcuWidth();
+    /* --- Scaled Decoding -------------------------------------------------- */
 
-            for (usize j = 0; j < _componentCount; j++) {
-                auto &mcu = _mcus[i + j];
+    // NOTE: Scaled decoding only keeps the top-left NxN coefficients of each
+    //       block and runs an N-point inverse DCT on them, this is much
+    //       cheaper than decoding at full resolution and downscaling after.
 
-                if (not _quant[_components[j]->quantId]) {
-                    logError("jpeg: undefined quantization table id: {}", _components[j]->quantId);
-                    return Error::invalidData("undefined quantization table id");
+    struct Scaler {
+        usize denom = 1;
+        usize n = 8;
+
+        // cos[x * n + u] = C(u) / 2 * cos((2x + 1) * u * PI / 2n)
+        Array<f32, 16> cos = {};
+
+        static Res<Scaler> make(usize denom) {
+            if (denom != 1 and denom != 2 and denom != 4 and denom != 8) {
+                logError("jpeg: invalid scale: 1/{}", denom);
+                return Error::invalidInput("invalid scale");
+            }
+
+            Scaler scaler;
+            scaler.denom = denom;
+            scaler.n = 8 / denom;
+
+            if (scaler.n <= 4) {
+                usize n = scaler.n;
+                for (usize x = 0; x < n; ++x) {
+                    for (usize u = 0; u < n; ++u) {
+                        f64 c = u == 0 ? 1.0 / Math::sqrt(2.0) : 1.0;
+                        scaler.cos[x * n + u] = c / 2.0 * Math::cos((2.0 * x + 1.0) * u * Math::PI / (2.0 * n));
+                    }
                 }
+            }
+
+            return Ok(scaler);
+        }
+    };
+
+    /// Size of the image once decoded at 1/`denom` of its size.
+    Math::Vec2i scaledSize(usize denom) const {
+        return {
+            (_width + (isize)denom - 1) / (isize)denom,
+            (_height + (isize)denom - 1) / (isize)denom,
+        };
+    }
+
+    /// Pick the smallest scale (1, 1/2, 1/4 or 1/8) that still produces an
+    /// image at least as large as `size`, returns the scale denominator.
+    usize scaleFor(Math::Vec2i size) const {
+        for (usize denom = 8; denom > 1; denom /= 2) {
+            auto scaled = scaledSize(denom);
+            if (scaled.x >= size.x and scaled.y >= size.y)
+                return denom;
+        }
+        return 1;
+    }
+
+    /// Reduced inverse DCT, produces a NxN block (with a stride of 8)
+    /// from the top-left NxN coefficients of `mcu`.
+    void idtcReduced(Mcu &mcu, Scaler const &scaler) const {
+        usize n = scaler.n;
+
+        if (n == 1) {
+            mcu[0] = mcu[0] / 8;
+            return;
+        }
+
+        Array<f32, 16> tmp = {};
+
+        // Rows
+        for (usize v = 0; v < n; ++v) {
+            for (usize x = 0; x < n; ++x) {
+                f32 sum = 0;
+                for (usize u = 0; u < n; ++u)
+                    sum += scaler.cos[x * n + u] * mcu[v * 8 + u];
+                tmp[v * n + x] = sum;
+            }
+        }
+
+        // Columns
+        for (usize x = 0; x < n; ++x) {
+            for (usize y = 0; y < n; ++y) {
+                f32 sum = 0;
+                for (usize v = 0; v < n; ++v)
+                    sum += scaler.cos[y * n + v] * tmp[v * n + x];
+                mcu[y * 8 + x] = sum;
+            }
+        }
+    }
+
+    /* --- Decoding --------------------------------------------------------- */
+
+    Res<> checkQuant() {
+        for (usize j = 0; j < _componentCount; j++) {
+            if (not _components[j]) {
+                logError("jpeg: undefined component id: {}", j);
+                return Error::invalidData("undefined component id");
+            }
+
+            if (not _quant[_components[j]->quantId]) {
+                logError("jpeg: undefined quantization table id: {}", _components[j]->quantId);
+                return Error::invalidData("undefined quantization table id");
+            }
+        }
+
+        return Ok();
+    }
+
+    /// Dequantize, inverse transform and color convert one MCU,
+    /// `pos` is the position of its top-left corner in `pixels`.
+    void convertMcu(Mcu *mcus, Gfx::MutPixels pixels, Math::Vec2i pos, Scaler const &scaler) const {
+        isize n = scaler.n;
+
+        for (usize j = 0; j < _componentCount; j++) {
+            auto &mcu = mcus[j];
+            auto const &quant = _quant[_components[j]->quantId].unwrap();
 
-                auto &quant = _quant[_components[j]->quantId].unwrap();
+            if (n == 8) {
                 for (usize k = 0; k < 64; k++) {
                     mcu[k] *= quant[k];
                 }
 
                 idtc(mcu);
+            } else {
+                for (isize v = 0; v < n; v++) {
+                    for (isize u = 0; u < n; u++) {
+                        mcu[v * 8 + u] *= quant[v * 8 + u];
+                    }
+                }
+
+                idtcReduced(mcu, scaler);
+            }
+        }
+
+        isize w = min(pixels.width() - pos.x, n);
+        isize h = min(pixels.height() - pos.y, n);
+
+        for (isize py = 0; py < h; ++py) {
+            for (isize px = 0; px < w; ++px) {
+                usize k = py * 8 + px;
+
+                Gfx::YCbCr ycbcr = {(float)mcus[0][k], 0, 0};
+                if (_componentCount == 3) {
+                    ycbcr.cb = mcus[1][k];
+                    ycbcr.cr = mcus[2][k];
+                }
+
+                pixels.storeUnsafe({pos.x + px, pos.y + py}, Gfx::yCbCrToRgb(ycbcr));
+            }
+        }
+    }
+
+    /// Convert a whole MCU row, `strip` is the (at most) N lines
+    /// tall band of the image it covers.
+    void convertMcuRow(MutSlice<Mcu> row, Gfx::MutPixels strip, Scaler const &scaler) const {
+        for (isize x = 0; x < mcuWidth(); ++x) {
+            convertMcu(&row[x * _componentCount], strip, {x * (isize)scaler.n, 0}, scaler);
+        }
+    }
+
+    /// Decode the whole image at 1/`denom` of its size (1, 2, 4 or 8) into
+    /// `pixels`, which must be at least scaledSize(denom) large.
+    Res<> decode(Gfx::MutPixels pixels, usize denom = 1) {
+        try$(checkQuant());
+        auto scaler = try$(Scaler::make(denom));
+        auto size = scaledSize(denom);
+        isize n = scaler.n;
+
+        // The padding of the last MCU row and column is never written.
+        pixels = pixels.clip({0, 0, size.x, size.y});
+
+        Vec<Mcu> row;
+        row.resize(mcuWidth() * _componentCount);
+
+        BScan s{_scan};
+        BitStream bs{s};
+        Array<isize, 4> prevDc = {};
+
+        for (isize y = 0; y < mcuHeight(); ++y) {
+            try$(decodeMcuRow(bs, prevDc, y, row));
+            convertMcuRow(row, pixels.clip({0, y * n, size.x, n}), scaler);
+        }
+
+        return Ok();
+    }
+
+    /// Receives the decoded image one line at a time, from top to bottom.
+    struct Sink {
+        virtual ~Sink() = default;
+
+        virtual Res<> writeLine(isize y, Gfx::Pixels line) = 0;
+    };
+
+    /// Decode the image at 1/`denom` of its size into `sink` without ever
+    /// holding more than one MCU row worth of coefficients and pixels in memory.
+    Res<> decode(Sink &sink, usize denom = 1) {
+        try$(checkQuant());
+        auto scaler = try$(Scaler::make(denom));
+        auto size = scaledSize(denom);
+        isize n = scaler.n;
+
+        Vec<Mcu> row;
+        row.resize(mcuWidth() * _componentCount);
+
+        auto buf = Buf<u8>::init(size.x * n * Gfx::RGBA8888.bpp());
+        Gfx::MutPixels strip = {
+            buf.buf(),
+            {size.x, n},
+            size.x * Gfx::RGBA8888.bpp(),
+            Gfx::RGBA8888,
+        };
+
+        BScan s{_scan};
+        BitStream bs{s};
+        Array<isize, 4> prevDc = {};
+
+        for (isize y = 0; y < mcuHeight(); ++y) {
+            try$(decodeMcuRow(bs, prevDc, y, row));
+            convertMcuRow(row, strip, scaler);
+
+            isize lines = min(size.y - y * n, n);
+            for (isize l = 0; l < lines; ++l) {
+                try$(sink.writeLine(y * n + l, strip.clip({0, l, size.x, 1})));
             }
+        }
 
-            auto &yMcu = _mcus[i + 0];
-            auto &cbMcu = _mcus[i + 1];
-            auto &crMcu = _mcus[i + 2];
+        return Ok();
+    }
+
+    /* --- Parallel Decoding ------------------------------------------------ */
 
-            for (usize k = 0; k < 64; ++k) {
-                isize px = x * 8 + k % 8;
-                isize py = y * 8 + k / 8;
+    // NOTE: When the image uses restart intervals, the entropy-coded segments
+    //       are independent of each other and are decoded end to end by
+    //       the workers. Otherwise entropy decoding stays on the calling
+    //       thread and only the inverse DCT and color conversion of each MCU
+    //       row is handed off. Both paths run the exact same per-block code
+    //       as decode() so the output is identical.
+
+    Res<> decodeSegment(usize index, Gfx::MutPixels pixels, Scaler const &scaler) const {
+        usize total = mcuWidth() * mcuHeight();
+        usize first = index * _restartInterval;
+        usize last = min(first + _restartInterval, total);
+        isize n = scaler.n;
+
+        BScan s{_segments[index]};
+        BitStream bs{s};
+        Array<isize, 4> prevDc = {};
+        Array<Mcu, 4> mcus;
 
-                Gfx::YCbCr ycbcr{(float)yMcu[k], (float)cbMcu[k], (float)crMcu[k]};
-                pixels.storeUnsafe({px, py}, Gfx::yCbCrToRgb(ycbcr));
+        for (usize i = first; i < last; ++i) {
+            for (usize cid = 0; cid < _componentCount; ++cid) {
+                try$(decodeBlock(bs, cid, prevDc[cid], mcus[cid]));
             }
+
+            isize x = i % mcuWidth();
+            isize y = i / mcuWidth();
+            convertMcu(mcus.buf(), pixels, {x * n, y * n}, scaler);
         }
 
         return Ok();
     }
 
+    bool hasIndependentSegments() const {
+        if (_restartInterval == 0)
+            return false;
+
+        usize total = mcuWidth() * mcuHeight();
+        return _segments.len() == (total + _restartInterval - 1) / _restartInterval;
+    }
+
+    /// Run `worker` on the calling thread and on up to `threads - 1` extra
+    /// threads, if spawning fails the remaining work is done by fewer threads.
+    static Res<> runWorkers(usize threads, auto worker) {
+        Lock lock;
+        Res<> result = Ok();
+
+        auto run = [&] {
+            auto res = worker();
+            if (not res) {
+                LockScope scope(lock);
+                if (result)
+                    result = res;
+            }
+        };
+
+        Vec<Strong<Sys::Thread>> spawned;
+        for (usize i = 1; i < threads; ++i) {
+            auto thread = Sys::spawn([&] {
+                run();
+            });
+
+            if (not thread) {
+                logWarn("jpeg: could not spawn worker thread");
+                break;
+            }
+
+            spawned.pushBack(thread.take());
+        }
+
+        run();
+
+        // Every worker must be done before returning, they all use this
+        // stack frame.
+        Res<> joined = Ok();
+        for (auto &thread : spawned) {
+            auto res = thread->join();
+            if (not res and joined)
+                joined = res;
+        }
+
+        try$(result);
+        return joined;
+    }
+
+    Res<> decodeSegmentsParallel(Gfx::MutPixels pixels, Scaler const &scaler, usize threads) {
+        auto size = scaledSize(scaler.denom);
+        pixels = pixels.clip({0, 0, size.x, size.y});
+
+        Atomic<usize> next = 0;
+        Atomic<bool> failed = false;
+
+        return runWorkers(threads, [&]() -> Res<> {
+            while (not failed.load(RELAXED)) {
+                usize i = next.fetchInc();
+                if (i >= _segments.len())
+                    break;
+
+                auto res = decodeSegment(i, pixels, scaler);
+                if (not res) {
+                    failed.store(true);
+                    return res;
+                }
+            }
+            return Ok();
+        });
+    }
+
+    Res<> decodeRowsParallel(Gfx::MutPixels pixels, Scaler const &scaler, usize threads) {
+        auto size = scaledSize(scaler.denom);
+        pixels = pixels.clip({0, 0, size.x, size.y});
+        isize n = scaler.n;
+        usize rowLen = mcuWidth() * _componentCount;
+        usize slots = threads * 2;
+
+        // Rows of coefficients waiting to be converted, `ready[i]` holds
+        // the index of the MCU row stored in slot `i` or -1 if it's free.
+        Vec<Mcu> rows;
+        rows.resize(rowLen * slots);
+        Vec<Atomic<isize>> ready;
+        ready.resize(slots, -1);
+
+        Atomic<isize> next = 0;
+        Atomic<bool> producing = false;
+        Atomic<bool> failed = false;
+
+        auto slotOf = [&](isize y) {
+            usize slot = y % slots;
+            return mutSub(rows, slot * rowLen, (slot + 1) * rowLen);
+        };
+
+        auto convertRow = [&](isize y) {
+            convertMcuRow(slotOf(y), pixels.clip({0, y * n, size.x, n}), scaler);
+            ready[y % slots].store(-1, RELEASE);
+        };
+
+        auto convert = [&] {
+            while (not failed.load(RELAXED)) {
+                isize y = next.fetchInc();
+                if (y >= mcuHeight())
+                    break;
+
+                while (ready[y % slots].load(ACQUIRE) != y) {
+                    if (failed.load(RELAXED))
+                        return;
+                    Embed::relaxe();
+                }
+
+                convertRow(y);
+            }
+        };
+
+        auto produce = [&]() -> Res<> {
+            BScan s{_scan};
+            BitStream bs{s};
+            Array<isize, 4> prevDc = {};
+
+            for (isize y = 0; y < mcuHeight(); ++y) {
+                while (ready[y % slots].load(ACQUIRE) != -1) {
+                    // Help converting rows that are ready but not claimed
+                    // yet, so we never wait on workers that don't exist.
+                    isize r = next.load();
+                    if (r < y and next.cmpxchg(r, r + 1)) {
+                        convertRow(r);
+                    } else {
+                        Embed::relaxe();
+                    }
+                }
+
+                auto res = decodeMcuRow(bs, prevDc, y, slotOf(y));
+                if (not res) {
+                    failed.store(true);
+                    return res;
+                }
+
+                ready[y % slots].store(y, RELEASE);
+            }
+
+            return Ok();
+        };
+
+        return runWorkers(threads, [&]() -> Res<> {
+            // The first thread to get here becomes the producer, the others
+            // (and the producer once it's done) convert the rows.
+            if (not producing.xchg(true))
+                try$(produce());
+
+            convert();
+            return Ok();
+        });
+    }
+
+    /// Decode the image at 1/`denom` of its size using up to `threads` threads,
+    /// the output is identical to the one of decode().
+    Res<> decodeParallel(Gfx::MutPixels pixels, usize threads, usize denom = 1) {
+        if (threads <= 1)
+            return decode(pixels, denom);
+
+        try$(checkQuant());
+        auto scaler = try$(Scaler::make(denom));
+
+        if (hasIndependentSegments())
+            return decodeSegmentsParallel(pixels, scaler, threads);
+
+        return decodeRowsParallel(pixels, scaler, threads);
+    }
+
     /* --- Dumping ---------------------------------------------------------- */
 
     void dump(Text::Emit &e) {
@@ -1,6 +1,7 @@
 #pragma once
 
-#include <karm-base/map.h>
+#include <karm-base/atom.h>
+#include <karm-base/hashmap.h>
 #include <karm-base/string.h>
 #include <karm-base/var.h>
 #include <karm-base/vec.h>
@@ -15,7 +16,8 @@ struct Value;
 
 using Array = Vec<Value>;
 
-using Object = Map<String, Value>;
+// Keys are interned, documents tend to repeat the same handful of keys.
+using Object = HashMap<Atom, Value>;
 
 #ifdef __ck_freestanding__
 using Number = isize;
@@ -128,7 +130,7 @@ struct Value {
                 [](Vec<Value>) {
                     return "<array>";
                 },
-                [](Map<String, Value>) {
+                [](Object) {
                     return "<object>";
                 },
                 [](String s) {
@@ -184,7 +186,7 @@ struct Value {
                 [](Vec<Value> v) {
                     return v.len() > 0;
                 },
-                [](Map<String, Value> m) {
+                [](Object m) {
                     return m.len() > 0;
                 },
                 [](String s) {
@@ -222,7 +224,7 @@ struct Value {
                 [](Vec<Value> v) {
                     return v.len();
                 },
-                [](Map<String, Value> m) {
+                [](Object m) {
                     return m.len();
                 },
                 [](String s) {
@@ -6,7 +6,7 @@ namespace Json {
 
 Res<Value> parse(Text::Scan &s);
 
-Res<String> parseStr(Text::Scan &s) {
+Res<Str> parseStr(Text::Scan &s) {
     if (not s.skip('"')) {
         return Error::invalidData("expected '\"'");
     }
@@ -17,7 +17,7 @@ Res<String> parseStr(Text::Scan &s) {
         if (s.curr() == '"') {
             auto str = s.end();
             s.next();
-            return Ok(String{str});
+            return Ok(str);
         }
 
         if (s.skip('\\')) {
@@ -74,7 +74,7 @@ Res<Object> parseObject(Text::Scan &s) {
 
     while (true) {
         s.eat(Re::space());
-        auto key = try$(parseStr(s));
+        Atom key = try$(parseStr(s));
 
         s.eat(Re::space());
         if (not s.skip(':')) {
@@ -133,7 +133,7 @@ Res<Value> parse(Text::Scan &s) {
     } else if (s.peek() == '[') {
         return Ok(Value{try$(parseArray(s))});
     } else if (s.peek() == '"') {
-        return Ok(Value{try$(parseStr(s))});
+        return Ok(Value{String{try$(parseStr(s))}});
     } else if (s.skip("null")) {
         return Ok(Value{NONE});
     } else if (s.skip("true")) {
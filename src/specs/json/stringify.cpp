@@ -21,7 +21,7 @@ Res<> stringify(Text::Emit &emit, Value const &v) {
 
                 return Ok();
             },
-            [&](Map<String, Value> const &m) -> Res<> {
+            [&](Object const &m) -> Res<> {
                 emit('{');
                 bool first = true;
                 for (auto const &kv : m.iter()) {
@@ -31,7 +31,7 @@ Res<> stringify(Text::Emit &emit, Value const &v) {
                     first = false;
 
                     emit('"');
-                    emit(kv.car);
+                    emit(kv.car.str());
                     emit("\":");
                     try$(stringify(emit, kv.cdr));
                 }
@@ -0,0 +1,119 @@
+#include <bmp/spec.h>
+#include <karm-io/impls.h>
+#include <karm-main/main.h>
+#include <karm-media/image.h>
+#include <karm-sys/time.h>
+#include <karm-text/scan.h>
+#include <qoi/spec.h>
+
+// Usage: qoi-spec-bench [rounds]
+//
+// Encodes and decodes a 3840x2160 desktop-like framebuffer as qoi and as
+// bmp, and prints the mean time of each direction and the encoded size.
+// Every decode is checked against the framebuffer.
+
+static constexpr Math::Vec2i SIZE = {3840, 2160};
+
+static usize _argOr(ArgsHook &args, usize i, usize fallback) {
+    if (i >= args.len())
+        return fallback;
+    Text::Scan s{args[i]};
+    auto value = s.nextUint();
+    return value ? value.unwrap() : fallback;
+}
+
+static bool _same(Media::Image const &a, Media::Image const &b) {
+    return a._buf->len() == b._buf->len() and
+           memcmp(a._buf->buf(), b._buf->buf(), a._buf->len()) == 0;
+}
+
+// A flat background with a few windows, each with a gradient title bar and
+// a body of text-like noise, the kind of content a compositor captures.
+static Media::Image _framebuffer() {
+    auto img = Media::Image::alloc(SIZE, Gfx::BGRA8888);
+    auto pixels = img.mutPixels();
+    pixels.clear(Gfx::Color::fromRgba(32, 48, 64, 255));
+
+    u64 state = 0x2545f4914f6cdd1d;
+    for (isize i = 0; i < 6; i++) {
+        Math::Recti win = {100 + i * 560, 120 + i * 250, 1200, 900};
+        for (isize y = win.y; y < min(win.y + win.height, SIZE.y); y++) {
+            for (isize x = win.x; x < min(win.x + win.width, SIZE.x); x++) {
+                Gfx::Color color = Gfx::Color::fromRgba(240, 240, 240, 255);
+                if (y < win.y + 32) {
+                    u8 v = 96 + (y - win.y) * 2;
+                    color = Gfx::Color::fromRgba(v, v, v + 32, 255);
+                } else if ((y - win.y) % 20 < 12 and x > win.x + 16 and x < win.x + win.width - 16) {
+                    state ^= state << 13;
+                    state ^= state >> 7;
+                    state ^= state << 17;
+                    if (state % 3 == 0)
+                        color = Gfx::Color::fromRgba(32, 32, 32, 255);
+                }
+                pixels.storeUnsafe({x, y}, color);
+            }
+        }
+    }
+
+    return img;
+}
+
+template <typename Encode, typename Decode>
+static Res<> _bench(Str name, Media::Image const &fb, usize rounds, Encode encode, Decode decode) {
+    // Large enough for the worst case of both formats.
+    Buf<Byte> out{};
+    out.resize(SIZE.x * SIZE.y * 5 + 64);
+    usize len = 0;
+
+    auto start = Sys::now();
+    for (usize i = 0; i < rounds; i++) {
+        Io::BufWriter writer{mutSub(out)};
+        try$(encode(fb.pixels(), writer));
+        len = writer._pos;
+    }
+    f64 encodeMs = (Sys::now() - start).toUSecs() / (f64)rounds / 1000.0;
+
+    auto img = Media::Image::alloc(SIZE, Gfx::BGRA8888);
+    start = Sys::now();
+    for (usize i = 0; i < rounds; i++)
+        try$(decode(Bytes{out.buf(), len}, img.mutPixels()));
+    f64 decodeMs = (Sys::now() - start).toUSecs() / (f64)rounds / 1000.0;
+
+    if (not _same(img, fb))
+        return Error::other("decoded image differs from the framebuffer");
+
+    Sys::println("{}: encode {}ms, decode {}ms, {} KiB", name, encodeMs, decodeMs, len / 1024);
+    return Ok();
+}
+
+Res<> entryPoint(Ctx &ctx) {
+    auto &args = useArgs(ctx);
+    usize rounds = max(_argOr(args, 0, 8), 1uz);
+
+    auto fb = _framebuffer();
+    Sys::println("{}x{}, {} rounds", SIZE.x, SIZE.y, rounds);
+
+    try$(_bench(
+        "qoi", fb, rounds,
+        [](Gfx::Pixels pixels, Io::Writer &writer) {
+            return Qoi::encode(pixels, writer);
+        },
+        [](Bytes bytes, Gfx::MutPixels pixels) -> Res<> {
+            auto qoi = try$(Qoi::Image::load(bytes));
+            return qoi.decode(pixels);
+        }
+    ));
+
+    try$(_bench(
+        "bmp", fb, rounds,
+        [](Gfx::Pixels pixels, Io::Writer &writer) {
+            return Bmp::encode(pixels, writer);
+        },
+        [](Bytes bytes, Gfx::MutPixels pixels) -> Res<> {
+            auto bmp = try$(Bmp::Image::load(bytes));
+            return bmp.decode(pixels);
+        }
+    ));
+
+    return Ok();
+}
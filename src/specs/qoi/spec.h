@@ -70,68 +70,236 @@ struct Image : public BChunk {
         MASK = 0b11000000,
     };
 
-    usize hash(Gfx::Color c) {
+    static usize hash(Gfx::Color c) {
         return c.red * 3 + c.green * 5 + c.blue * 7 + c.alpha * 11;
     }
 
     [[gnu::flatten]] Res<> decode(Gfx::MutPixels dest) {
-        usize run = 0;
+        if (dest.width() < width() or dest.height() < height()) {
+            return Error::invalidInput("destination too small");
+        }
+
+        if (_slice.len() < 14 + END.len()) {
+            return Error::invalidData("unexpected end of file");
+        }
+
+        // NOTE: Chunks are at most 5 bytes long and the stream is terminated
+        //       by the 8 bytes end marker, so as long as a chunk starts
+        //       before the marker it can be read without further checks.
+        u8 const *p = _slice.buf() + 14;
+        u8 const *end = _slice.buf() + _slice.len() - END.len();
+
         Array<Gfx::Color, 64> index{};
         Gfx::Color pixel = Gfx::BLACK;
 
-        auto s = begin().skip(14);
+        try$(dest.fmt().visit([&](auto f) -> Res<> {
+            usize bpp = f.bpp();
+            usize run = 0;
+
+            for (isize y = 0; y < height(); y++) {
+                u8 *row = static_cast<u8 *>(dest.scanline(y));
+                isize x = 0;
+
+                while (x < width()) {
+                    if (run > 0) {
+                        // Every format is 4 bytes per pixel, so the run is
+                        // the packed pixel filled over a slice of the row.
+                        usize n = min(run, (usize)(width() - x));
+                        u32 packed;
+                        f.store(&packed, pixel);
+                        fill(MutSlice<u32>{reinterpret_cast<u32 *>(row) + x, n}, packed);
+                        x += n;
+                        run -= n;
+                        continue;
+                    }
+
+                    if (p >= end) {
+                        return Error::invalidData("unexpected end of file");
+                    }
+
+                    u8 b1 = *p++;
+                    if (b1 == Chunk::RGB) {
+                        pixel.red = p[0];
+                        pixel.green = p[1];
+                        pixel.blue = p[2];
+                        p += 3;
+                    } else if (b1 == Chunk::RGBA) {
+                        pixel.red = p[0];
+                        pixel.green = p[1];
+                        pixel.blue = p[2];
+                        pixel.alpha = p[3];
+                        p += 4;
+                    } else if ((b1 & Chunk::MASK) == Chunk::INDEX) {
+                        pixel = index[b1];
+                    } else if ((b1 & Chunk::MASK) == Chunk::DIFF) {
+                        pixel.red += ((b1 >> 4) & 0x03) - 2;
+                        pixel.green += ((b1 >> 2) & 0x03) - 2;
+                        pixel.blue += (b1 & 0x03) - 2;
+                    } else if ((b1 & Chunk::MASK) == Chunk::LUMA) {
+                        u8 b2 = *p++;
+                        auto vg = (b1 & 0x3f) - 32;
+                        pixel.red += vg - 8 + ((b2 >> 4) & 0x0f);
+                        pixel.green += vg;
+                        pixel.blue += vg - 8 + (b2 & 0x0f);
+                    } else {
+                        // Chunk::RUN, the first pixel is stored below
+                        run = b1 & ~Chunk::MASK;
+                    }
+
+                    index[hash(pixel) % index.len()] = pixel;
+                    f.store(row + x * bpp, pixel);
+                    x++;
+                }
+            }
+
+            return Ok();
+        }));
+
+        if (p + END.len() > _slice.buf() + _slice.len() or
+            Op::ne(Bytes{p, END.len()}, bytes(END))) {
+            return Error::invalidData("missing end marker");
+        }
+
+        return Ok();
+    }
+};
+
+/* --- Encoder -------------------------------------------------------------- */
+
+/// Encode `pixels` as a QOI image, the output is produced in small
+/// chunks through `writer` and nothing is allocated on the heap.
+[[gnu::flatten]] static inline Res<> encode(Gfx::Pixels pixels, Io::Writer &writer) {
+    Array<u8, 4096> buf;
+    usize len = 0;
+
+    auto flush = [&]() -> Res<> {
+        usize written = 0;
+        while (written < len) {
+            usize n = try$(writer.write(Bytes{buf.buf() + written, len - written}));
+            if (n == 0)
+                return Error::writeZero();
+            written += n;
+        }
+        len = 0;
+        return Ok();
+    };
+
+    auto emit = [&](u8 b) {
+        buf[len++] = b;
+    };
+
+    auto emitU32be = [&](u32 v) {
+        emit(v >> 24);
+        emit(v >> 16);
+        emit(v >> 8);
+        emit(v);
+    };
+
+    for (auto b : Image::MAGIC)
+        emit(b);
+    emitU32be(pixels.width());
+    emitU32be(pixels.height());
+    emit(4); // channels
+    emit(0); // colorspace, sRGB with linear alpha
+
+    Array<Gfx::Color, 64> index{};
+    Gfx::Color prev = Gfx::BLACK;
+    usize run = 0;
+
+    auto same = [](Gfx::Color a, Gfx::Color b) {
+        return a.red == b.red and
+               a.green == b.green and
+               a.blue == b.blue and
+               a.alpha == b.alpha;
+    };
+
+    auto emitRun = [&] {
+        emit(Image::RUN | (run - 1));
+        // NOTE: The decoder also stores the first pixel of a run in the index
+        index[Image::hash(prev) % index.len()] = prev;
+        run = 0;
+    };
+
+    try$(pixels.fmt().visit([&](auto f) -> Res<> {
+        usize bpp = f.bpp();
+
+        for (isize y = 0; y < pixels.height(); y++) {
+            u8 const *row = static_cast<u8 const *>(pixels.scanline(y));
+
+            for (isize x = 0; x < pixels.width(); x++) {
+                // Make sure the largest chunk (run + RGBA) always fits
+                if (len + 6 > buf.len())
+                    try$(flush());
+
+                Gfx::Color pixel = f.load(row + x * bpp);
+
+                if (same(pixel, prev)) {
+                    if (++run == 62)
+                        emitRun();
+                    continue;
+                }
+
+                if (run > 0)
+                    emitRun();
 
-        for (isize y = 0; y < height(); y++) {
-            for (isize x = 0; x < width(); x++) {
-                if (s.ended()) {
-                    return Error::invalidData("unexpected end of file");
+                usize h = Image::hash(pixel) % index.len();
+                if (same(index[h], pixel)) {
+                    emit(Image::INDEX | h);
+                    prev = pixel;
+                    continue;
                 }
 
-                if (run > 0) {
-                    run--;
-                    dest.store({x, y}, pixel);
+                index[h] = pixel;
+
+                if (pixel.alpha != prev.alpha) {
+                    emit(Image::RGBA);
+                    emit(pixel.red);
+                    emit(pixel.green);
+                    emit(pixel.blue);
+                    emit(pixel.alpha);
+                    prev = pixel;
                     continue;
                 }
 
-                auto b1 = s.nextU8be();
-                if (b1 == Chunk::RGB) {
-                    pixel.red = s.nextU8be();
-                    pixel.green = s.nextU8be();
-                    pixel.blue = s.nextU8be();
-                } else if (b1 == Chunk::RGBA) {
-                    pixel.red = s.nextU8be();
-                    pixel.green = s.nextU8be();
-                    pixel.blue = s.nextU8be();
-                    pixel.alpha = s.nextU8be();
-                } else if ((b1 & Chunk::MASK) == Chunk::INDEX) {
-                    pixel = index[b1];
-                } else if ((b1 & Chunk::MASK) == Chunk::DIFF) {
-                    pixel.red += ((b1 >> 4) & 0x03) - 2;
-                    pixel.green += ((b1 >> 2) & 0x03) - 2;
-                    pixel.blue += (b1 & 0x03) - 2;
-                } else if ((b1 & Chunk::MASK) == Chunk::LUMA) {
-                    auto b2 = s.nextU8be();
-                    auto vg = (b1 & 0x3f) - 32;
-                    pixel.red += vg - 8 + ((b2 >> 4) & 0x0f);
-                    pixel.green += vg;
-                    pixel.blue += vg - 8 + (b2 & 0x0f);
-                } else if ((b1 & Chunk::MASK) == Chunk::RUN) {
-                    run = b1 & (~Chunk::MASK);
+                i8 vr = pixel.red - prev.red;
+                i8 vg = pixel.green - prev.green;
+                i8 vb = pixel.blue - prev.blue;
+                i8 vgr = vr - vg;
+                i8 vgb = vb - vg;
+
+                if (vr > -3 and vr < 2 and
+                    vg > -3 and vg < 2 and
+                    vb > -3 and vb < 2) {
+                    emit(Image::DIFF | (vr + 2) << 4 | (vg + 2) << 2 | (vb + 2));
+                } else if (vgr > -9 and vgr < 8 and
+                           vg > -33 and vg < 32 and
+                           vgb > -9 and vgb < 8) {
+                    emit(Image::LUMA | (vg + 32));
+                    emit((vgr + 8) << 4 | (vgb + 8));
                 } else {
-                    return Error::invalidData("invalid chunk");
+                    emit(Image::RGB);
+                    emit(pixel.red);
+                    emit(pixel.green);
+                    emit(pixel.blue);
                 }
 
-                index[hash(pixel) % index.len()] = pixel;
-                dest.store({x, y}, pixel);
+                prev = pixel;
             }
         }
 
-        if (Op::ne(s.nextBytes(8), bytes(END))) {
-            return Error::invalidData("missing end marker");
-        }
-
         return Ok();
-    }
-};
+    }));
+
+    if (len + 6 + Image::END.len() > buf.len())
+        try$(flush());
+
+    if (run > 0)
+        emitRun();
+
+    for (auto b : Image::END)
+        emit(b);
+
+    return flush();
+}
 
 } // namespace Qoi
@@ -0,0 +1,90 @@
+#include <karm-fmt/base.h>
+#include <karm-io/impls.h>
+#include <karm-media/image.h>
+#include <karm-sys/file.h>
+#include <karm-sys/mmap.h>
+#include <karm-test/macros.h>
+#include <qoi/spec.h>
+
+namespace Qoi::Tests {
+
+static Res<Media::Image> _decode(Bytes bytes) {
+    auto qoi = try$(Image::load(bytes));
+    auto img = Media::Image::alloc({qoi.width(), qoi.height()});
+    try$(qoi.decode(img.mutPixels()));
+    return Ok(img);
+}
+
+static bool _same(Gfx::Pixels lhs, Gfx::Pixels rhs) {
+    if (lhs.width() != rhs.width() or lhs.height() != rhs.height())
+        return false;
+
+    for (isize y = 0; y < lhs.height(); y++) {
+        for (isize x = 0; x < lhs.width(); x++) {
+            auto a = lhs.loadUnsafe({x, y});
+            auto b = rhs.loadUnsafe({x, y});
+            if (a.red != b.red or
+                a.green != b.green or
+                a.blue != b.blue or
+                a.alpha != b.alpha)
+                return false;
+        }
+    }
+
+    return true;
+}
+
+static Res<Media::Image> _roundtrip(Gfx::Pixels pixels) {
+    Io::BufferWriter writer;
+    try$(encode(pixels, writer));
+    return _decode(writer.bytes());
+}
+
+static Res<> _roundtripFile(Test::Driver &_driver, Str name) {
+    auto url = Sys::Url::parse(try$(Fmt::format("bundle://qoi-spec-tests/{}.qoi", name)));
+    auto file = try$(Sys::File::open(url));
+    auto map = try$(Sys::mmap().map(file));
+
+    auto img = try$(_decode(map.bytes()));
+    auto out = try$(_roundtrip(img));
+    expect$(_same(img, out));
+
+    return Ok();
+}
+
+test$(qoiRoundtripFixtures) {
+    for (auto name : {"dice", "kodim10", "kodim23", "qoi_logo", "testcard", "testcard_rgba", "wikipedia_008"})
+        try$(_roundtripFile(_driver, name));
+
+    return Ok();
+}
+
+test$(qoiRoundtripLongRun) {
+    // A single color spans several maximum length (62) runs and rows.
+    auto img = Media::Image::alloc({200, 3});
+    img.mutPixels().clear(Gfx::Color::fromRgba(12, 34, 56, 78));
+
+    auto out = try$(_roundtrip(img));
+    expect$(_same(img, out));
+
+    return Ok();
+}
+
+test$(qoiRoundtripOddWidth) {
+    // Runs of 5 don't divide a width of 67, so they straddle row boundaries.
+    auto img = Media::Image::alloc({67, 9});
+    auto pixels = img.mutPixels();
+    for (isize y = 0; y < pixels.height(); y++) {
+        for (isize x = 0; x < pixels.width(); x++) {
+            u8 v = ((y * pixels.width() + x) / 5) * 37;
+            pixels.storeUnsafe({x, y}, Gfx::Color::fromRgba(v, v ^ 0x5a, 255 - v, x % 2 ? 255 : 128));
+        }
+    }
+
+    auto out = try$(_roundtrip(img));
+    expect$(_same(img, out));
+
+    return Ok();
+}
+
+} // namespace Qoi::Tests